@@ -0,0 +1,775 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_bench.c
+//  Description    : This is the micro-benchmark program for the ScatterGather
+//                   driver components.  Each benchmark is selected by name
+//                   on the command line and prints one line per data point.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include <sg_defs.h>
+#include <sg_cache.h>
+#include <sg_driver.h>
+#include <sg_local_service.h>
+
+// Defines
+#define SG_BENCH_ARGUMENTS "b:hj:l:n:o:"
+#define SG_BENCH_DEFAULT_OPS 1000000
+#define SG_BENCH_AIO_BLOCKS 4096 // File size of the aio benchmark (blocks)
+#define SG_BENCH_AIO_DEPTH 64    // Deepest queue of the aio benchmark
+#define SG_BENCH_THREADS 8       // Most threads of the threads benchmark
+#define SG_BENCH_THREAD_BLOCKS 256 // File size per thread (blocks)
+#define SG_BENCH_THREAD_IO 256   // Bytes per operation of the threads benchmark
+#define SG_BENCH_SHARING_BLOCKS 4096 // Resident set of the sharing benchmark
+#define SG_BENCH_STREAM_BLOCKS 1024 // File size of the stream benchmark (blocks)
+#define SG_BENCH_STREAM_IO 64       // Largest transfer of the stream benchmark (blocks)
+#define SG_BENCH_STREAM_CACHE "64"  // Cache of the stream benchmark, smaller than the file
+#define USAGE \
+    "USAGE: sg_bench [-h] [-b <MB/s>] [-j <usec>] [-l <usec>] [-n <max entries>]\n" \
+    "                [-o <ops>] <benchmark>\n" \
+    "\n" \
+    "where:\n" \
+    "    -b - bandwidth of the local service link (default 0, no limit)\n" \
+    "    -h - help mode (display this message)\n" \
+    "    -j - most jitter added to the local service latency (default 0 usec)\n" \
+    "    -l - latency of the local service (default 100 usec)\n" \
+    "    -n - largest cache size to measure (default 1048576)\n" \
+    "    -o - operations per data point (default 1000000)\n" \
+    "and\n" \
+    "    benchmark - one of:\n" \
+    "        cache - per-operation latency of the block cache as it grows\n" \
+    "        policy - hit rates of the replacement policies on a locality\n" \
+    "                 trace (hot set mixed with one-time scans)\n" \
+    "        aio - random block reads against the local service, blocking\n" \
+    "              and with 1 to 64 asynchronous requests in flight\n" \
+    "              (sg_blockd servers instead with SG_SERVICE=socket or shm)\n" \
+    "        threads - 1 to 8 threads each reading and writing its own file,\n" \
+    "                  checking every read against a copy of the file\n" \
+    "        sharing - 1 to 8 threads hitting the same cached blocks, with\n" \
+    "                  one locked shard, 16 locked shards and 16 shards\n" \
+    "                  read without locks (run under perf c2c to see the\n" \
+    "                  contended cache lines)\n" \
+    "        stream - one thread rewriting and reading a file sequentially\n" \
+    "                 in transfers of 1 to 64 blocks, missing the cache\n" \
+    "\n" \
+
+//
+// Global Data
+unsigned long SGServiceLevel; // Service log level
+unsigned long SGDriverLevel; // Controller log level
+unsigned long SGSimulatorLevel; // Simulation log level
+
+uint32_t benchMaxEntries = 1048576; // Largest cache measured
+uint32_t benchOps = SG_BENCH_DEFAULT_OPS; // Operations per data point
+__thread uint64_t benchRandState = 88172645463325252ULL; // xorshift state
+uint32_t benchLatency = 100; // Local service latency (usec)
+uint32_t benchBandwidth = 0; // Local service bandwidth (MB/s), 0 for no limit
+uint32_t benchJitter = 0;    // Local service jitter (usec)
+
+// A thread of the threads benchmark and its file
+typedef struct {
+    pthread_t thread;
+    SgFHandle fh;
+    uint32_t ops;  // Operations to run
+    int failed;    // A read or write failed or read bad data
+    char *shadow;  // What the file should hold
+} BenchThread;
+
+// A thread of the sharing benchmark
+typedef struct {
+    pthread_t thread;
+    uint32_t ops;  // Lookups to run
+    int lockFree;  // Use readSGDataBlock instead of getSGDataBlock
+    int failed;    // A resident block was missed
+} BenchReader;
+
+//
+// Functional Prototypes
+
+int benchCache( void ); // Cache latency benchmark
+int benchPolicy( void ); // Replacement policy comparison
+int benchAio( void ); // Asynchronous request overlap
+int benchThreads( void ); // Multi-threaded stress and scaling
+void *benchThreadRun( void *arg ); // One thread of benchThreads
+int benchSharing( void ); // Read hit scaling across cache shards
+int benchStream( void ); // Sequential transfer throughput
+void *benchSharingRun( void *arg ); // One thread of benchSharing
+void benchLocalService( void ); // Select the local service for the driver
+double benchNow( void ); // Monotonic time in seconds
+uint64_t benchRandom( void ); // Fast pseudo-random number
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : The main function for the ScatterGather benchmarks
+//
+// Inputs       : argc - the number of command line parameters
+//                argv - the parameters
+// Outputs      : 0 if successful test, -1 if failure
+
+int main( int argc, char *argv[] ) {
+
+    // Local variables
+    int ch;
+
+    // Process the command line parameters
+    while ((ch = getopt(argc, argv, SG_BENCH_ARGUMENTS)) != -1) {
+
+        switch (ch) {
+        case 'b': // Local service bandwidth
+            benchBandwidth = (uint32_t) strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'h': // Help, print usage
+            fprintf( stderr, USAGE );
+            return( -1 );
+
+        case 'j': // Local service jitter
+            benchJitter = (uint32_t) strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'l': // Local service latency
+            benchLatency = (uint32_t) strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'n': // Largest cache size
+            benchMaxEntries = (uint32_t) strtoul( optarg, NULL, 0 );
+            break;
+
+        case 'o': // Operations per point
+            benchOps = (uint32_t) strtoul( optarg, NULL, 0 );
+            break;
+
+        default:  // Default (unknown)
+            fprintf( stderr, "Unknown command line option (%c), aborting.\n", ch );
+            return( -1 );
+        }
+    }
+
+    // Setup the log, keep the driver levels quiet
+    initializeLogWithFilehandle( CMPSC311_LOG_STDERR );
+    SGServiceLevel = registerLogLevel("SG_SERVICE", 0);
+    SGDriverLevel = registerLogLevel("SG_DRIVER", 0);
+    SGSimulatorLevel = registerLogLevel("SG_SIMULATOR", 0);
+
+    if ( argv[optind] == NULL ) {
+        fprintf( stderr, "Missing benchmark name, use -h to see usage, aborting.\n" );
+        return( -1 );
+    }
+
+    // Run the selected benchmark
+    if ( strcmp(argv[optind], "cache") == 0 ) {
+        return( benchCache() );
+    }
+    if ( strcmp(argv[optind], "policy") == 0 ) {
+        return( benchPolicy() );
+    }
+    if ( strcmp(argv[optind], "aio") == 0 ) {
+        return( benchAio() );
+    }
+    if ( strcmp(argv[optind], "threads") == 0 ) {
+        return( benchThreads() );
+    }
+    if ( strcmp(argv[optind], "sharing") == 0 ) {
+        return( benchSharing() );
+    }
+    if ( strcmp(argv[optind], "stream") == 0 ) {
+        return( benchStream() );
+    }
+
+    fprintf( stderr, "Unknown benchmark [%s], aborting.\n", argv[optind] );
+    return( -1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchCache
+// Description  : Measure hit and miss/evict latency of the block cache for
+//                cache sizes from SG_MAX_CACHE_ELEMENTS to benchMaxEntries
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int benchCache( void ) {
+
+    SGDataBlock block;
+    double start, hotNs, hitNs, missNs;
+    uint32_t size, i;
+
+    memset( block, 'a', SG_BLOCK_SIZE );
+    printf( "%10s %12s %12s %12s\n", "entries", "hot ns/op", "hit ns/op", "miss ns/op" );
+
+    for ( size = SG_MAX_CACHE_ELEMENTS; size <= benchMaxEntries; size *= 2 ) {
+
+        if ( initSGCache(size) ) {
+            fprintf( stderr, "Cache init failed for %u entries.\n", size );
+            return( -1 );
+        }
+
+        // Fill the cache, block IDs spread over a few nodes (shards the hash
+        // fills unevenly borrow from the others, so every block stays)
+        for ( i = 0; i < size; i++ ) {
+            putSGDataBlock( (i % 8) + 1, i + 1, block );
+        }
+
+        // Hits over a fixed hot set, independent of the cache size
+        start = benchNow();
+        for ( i = 0; i < benchOps; i++ ) {
+            uint32_t k = (uint32_t) (benchRandom() % SG_MAX_CACHE_ELEMENTS);
+            if ( getSGDataBlock((k % 8) + 1, k + 1) == NULL ) {
+                fprintf( stderr, "Unexpected miss on resident block %u.\n", k + 1 );
+                return( -1 );
+            }
+        }
+        hotNs = (benchNow() - start) * 1e9 / benchOps;
+
+        // Random hits over the whole resident set (memory bound past the LLC)
+        start = benchNow();
+        for ( i = 0; i < benchOps; i++ ) {
+            uint32_t k = (uint32_t) (benchRandom() % size);
+            if ( getSGDataBlock((k % 8) + 1, k + 1) == NULL ) {
+                fprintf( stderr, "Unexpected miss on resident block %u.\n", k + 1 );
+                return( -1 );
+            }
+        }
+        hitNs = (benchNow() - start) * 1e9 / benchOps;
+
+        // Misses, each insert evicts the least recently used block of its shard
+        start = benchNow();
+        for ( i = 0; i < benchOps; i++ ) {
+            uint32_t k = size + i;
+            if ( getSGDataBlock((k % 8) + 1, k + 1) == NULL ) {
+                putSGDataBlock( (k % 8) + 1, k + 1, block );
+            }
+        }
+        missNs = (benchNow() - start) * 1e9 / benchOps;
+
+        printf( "%10u %12.1f %12.1f %12.1f\n", size, hotNs, hitNs, missNs );
+        closeSGCache();
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchPolicy
+// Description  : Replay the same locality trace against every replacement
+//                policy.  Most references go to a hot set that fits in the
+//                cache, the rest are long sequential scans of blocks that
+//                are never used again (the pattern that flushes LRU).
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int benchPolicy( void ) {
+
+    SGDataBlock block;
+    SGCacheStats stats;
+    uint32_t hotSize = SG_MAX_CACHE_ELEMENTS * 3 / 4, scanLeft, i, k;
+    uint64_t coldNext;
+    int policy;
+
+    memset( block, 'a', SG_BLOCK_SIZE );
+    printf( "%8s %10s %10s %10s %10s\n", "policy", "queries", "hit rate", "evictions", "ghost hits" );
+
+    for ( policy = 0; policy < SG_CACHE_MAX_POLICY; policy++ ) {
+
+        if ( initSGCacheWithPolicy(SG_MAX_CACHE_ELEMENTS, policy) ) {
+            fprintf( stderr, "Cache init failed for policy %d.\n", policy );
+            return( -1 );
+        }
+
+        // Same trace for every policy
+        benchRandState = 88172645463325252ULL;
+        coldNext = 1000000;
+        scanLeft = 0;
+
+        for ( i = 0; i < benchOps; i++ ) {
+
+            if ( scanLeft == 0 && benchRandom() % 100 < 2 ) {
+                scanLeft = SG_MAX_CACHE_ELEMENTS * 2;
+            }
+
+            // A zipf-like hot set: half the references go to an eighth of it
+            if ( scanLeft > 0 && benchRandom() % 2 ) {
+                k = (uint32_t) coldNext++;
+                scanLeft--;
+            } else if ( benchRandom() % 2 ) {
+                k = (uint32_t) (benchRandom() % (hotSize / 8)) + 1;
+            } else {
+                k = (uint32_t) (benchRandom() % hotSize) + 1;
+            }
+
+            if ( getSGDataBlock((k % 8) + 1, k) == NULL ) {
+                putSGDataBlock( (k % 8) + 1, k, block );
+            }
+        }
+
+        getSGCacheStats( &stats );
+        printf( "%8s %10lu %9.2f%% %10lu %10lu\n", stats.policy, stats.queries,
+                100.0 * stats.hits / stats.queries, stats.evictions, stats.ghostHits );
+        closeSGCache();
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchAio
+// Description  : Read random blocks of a file much larger than the cache
+//                through the local service, first blocking (sgread) and then
+//                keeping 1 to SG_BENCH_AIO_DEPTH requests in flight
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int benchAio( void ) {
+
+    char block[SG_BLOCK_SIZE * SG_BENCH_AIO_DEPTH];
+    SgAioRequest reqs[SG_BENCH_AIO_DEPTH];
+    SgAioCompletion comps[SG_BENCH_AIO_DEPTH];
+    uint32_t ops = benchOps / 100, i, done, sent;
+    double start, elapsed;
+    int depth, n;
+    SgFHandle fh;
+
+    // Run against the stand-in service with the default cache
+    benchLocalService();
+    if ( (fh = sgopen("sg_bench_aio")) == -1 ) {
+        fprintf( stderr, "Open failed.\n" );
+        return( -1 );
+    }
+
+    // Create the file, 64 blocks at a time
+    memset( block, 'a', sizeof(block) );
+    for ( i = 0; i < SG_BENCH_AIO_BLOCKS; i += SG_BENCH_AIO_DEPTH ) {
+        if ( sgwrite(fh, block, sizeof(block)) != sizeof(block) ) {
+            fprintf( stderr, "Write failed.\n" );
+            return( -1 );
+        }
+    }
+
+    printf( "%10s %12s %12s\n", "in flight", "reads/sec", "usec/read" );
+
+    // Blocking reads
+    start = benchNow();
+    for ( i = 0; i < ops; i++ ) {
+        sgseek( fh, (benchRandom() % SG_BENCH_AIO_BLOCKS) * SG_BLOCK_SIZE );
+        if ( sgread(fh, block, SG_BLOCK_SIZE) != SG_BLOCK_SIZE ) {
+            fprintf( stderr, "Read failed.\n" );
+            return( -1 );
+        }
+    }
+    elapsed = benchNow() - start;
+    printf( "%10s %12.0f %12.1f\n", "sgread", ops / elapsed, elapsed * 1e6 / ops );
+
+    // Asynchronous reads, each slot of block belongs to one request
+    for ( depth = 1; depth <= SG_BENCH_AIO_DEPTH; depth *= 4 ) {
+
+        start = benchNow();
+        sent = done = 0;
+        while ( done < ops ) {
+
+            // Refill the queue, the slot is passed as the user data
+            n = 0;
+            while ( sent - done + n < (uint32_t) depth && sent + n < ops ) {
+                int slot = (sent + n) % depth;
+                reqs[n].op = SG_AIO_READ;
+                reqs[n].fh = fh;
+                reqs[n].buf = &block[slot * SG_BLOCK_SIZE];
+                reqs[n].len = SG_BLOCK_SIZE;
+                reqs[n].off = (benchRandom() % SG_BENCH_AIO_BLOCKS) * SG_BLOCK_SIZE;
+                reqs[n].userData = NULL;
+                n++;
+            }
+            if ( n > 0 && sg_submit(reqs, n) != n ) {
+                fprintf( stderr, "Submit failed.\n" );
+                return( -1 );
+            }
+            sent += n;
+
+            n = sg_reap( comps, SG_BENCH_AIO_DEPTH, 1 );
+            for ( i = 0; i < (uint32_t) n; i++ ) {
+                if ( comps[i].result != SG_BLOCK_SIZE ) {
+                    fprintf( stderr, "Read failed.\n" );
+                    return( -1 );
+                }
+            }
+            done += n;
+        }
+        elapsed = benchNow() - start;
+        printf( "%10d %12.0f %12.1f\n", depth, ops / elapsed, elapsed * 1e6 / ops );
+    }
+
+    sgshutdown();
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchThreads
+// Description  : Run 1 to SG_BENCH_THREADS threads, each on its own file
+//                held in a write-back cache, with a fixed total number of
+//                small reads and writes.  Every read is checked against a
+//                copy of the file, so this is also a stress test of the
+//                driver's locking.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int benchThreads( void ) {
+
+    BenchThread threads[SG_BENCH_THREADS];
+    char cacheSize[16], name[32];
+    uint32_t size = SG_BENCH_THREAD_BLOCKS * SG_BLOCK_SIZE, ops = benchOps / 10, i;
+    double start, elapsed, base = 0;
+    int count, t;
+
+    // The files stay in the cache, writes are kept there until shutdown
+    snprintf( cacheSize, sizeof(cacheSize), "%u", SG_BENCH_THREADS * SG_BENCH_THREAD_BLOCKS * 2 );
+    benchLocalService();
+    setenv( SG_CACHE_SIZE_ENV, cacheSize, 1 );
+    setenv( SG_CACHE_WRITEBACK_ENV, "1", 1 );
+
+    for ( t = 0; t < SG_BENCH_THREADS; t++ ) {
+        snprintf( name, sizeof(name), "sg_bench_thread%d", t );
+        threads[t].shadow = (char *) malloc( size );
+        if ( threads[t].shadow == NULL || (threads[t].fh = sgopen(name)) == -1 ) {
+            fprintf( stderr, "Open failed.\n" );
+            return( -1 );
+        }
+        for ( i = 0; i < size; i++ ) {
+            threads[t].shadow[i] = (char) benchRandom();
+        }
+        if ( sgwrite(threads[t].fh, threads[t].shadow, size) != size ) {
+            fprintf( stderr, "Write failed.\n" );
+            return( -1 );
+        }
+    }
+
+    printf( "%10s %12s %12s %10s\n", "threads", "ops/sec", "usec/op", "speedup" );
+
+    for ( count = 1; count <= SG_BENCH_THREADS; count *= 2 ) {
+
+        start = benchNow();
+        for ( t = 0; t < count; t++ ) {
+            threads[t].ops = ops / count;
+            threads[t].failed = 0;
+            if ( pthread_create(&threads[t].thread, NULL, benchThreadRun, &threads[t]) ) {
+                fprintf( stderr, "Thread creation failed.\n" );
+                return( -1 );
+            }
+        }
+        for ( t = 0; t < count; t++ ) {
+            pthread_join( threads[t].thread, NULL );
+            if ( threads[t].failed ) {
+                fprintf( stderr, "Thread %d read bad data.\n", t );
+                return( -1 );
+            }
+        }
+        elapsed = benchNow() - start;
+        if ( count == 1 ) {
+            base = elapsed;
+        }
+        printf( "%10d %12.0f %12.2f %9.2fx\n", count, ops / elapsed, elapsed * 1e6 / ops, base / elapsed );
+    }
+
+    for ( t = 0; t < SG_BENCH_THREADS; t++ ) {
+        sgclose( threads[t].fh );
+        free( threads[t].shadow );
+    }
+    sgshutdown();
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchThreadRun
+// Description  : The work of one thread of benchThreads, nine reads to one
+//                write at random offsets of its file
+//
+// Inputs       : arg - the BenchThread
+// Outputs      : NULL
+
+void *benchThreadRun( void *arg ) {
+
+    BenchThread *bt = (BenchThread *) arg;
+    char buf[SG_BENCH_THREAD_IO];
+    uint32_t i, j, off;
+
+    // Each thread has its own random sequence
+    benchRandState = 88172645463325252ULL ^ (uint64_t) bt->fh << 32;
+
+    for ( i = 0; i < bt->ops && !bt->failed; i++ ) {
+
+        off = benchRandom() % (SG_BENCH_THREAD_BLOCKS * SG_BLOCK_SIZE - SG_BENCH_THREAD_IO);
+        if ( sgseek(bt->fh, off) != off ) {
+            bt->failed = 1;
+            break;
+        }
+
+        if ( i % 10 == 0 ) {
+            for ( j = 0; j < SG_BENCH_THREAD_IO; j++ ) {
+                buf[j] = (char) benchRandom();
+            }
+            if ( sgwrite(bt->fh, buf, SG_BENCH_THREAD_IO) != SG_BENCH_THREAD_IO ) {
+                bt->failed = 1;
+            }
+            memcpy( &bt->shadow[off], buf, SG_BENCH_THREAD_IO );
+        } else if ( sgread(bt->fh, buf, SG_BENCH_THREAD_IO) != SG_BENCH_THREAD_IO ||
+                    memcmp(buf, &bt->shadow[off], SG_BENCH_THREAD_IO) != 0 ) {
+            bt->failed = 1;
+        }
+    }
+
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchSharing
+// Description  : Run 1 to SG_BENCH_THREADS threads doing nothing but hits
+//                on the same resident blocks, the worst case for shared
+//                cache lines.  A single shard serializes every thread on
+//                one lock, sixteen shards spread the lock traffic, and the
+//                lock-free reads should write nothing shared at all.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int benchSharing( void ) {
+
+    BenchReader threads[SG_BENCH_THREADS];
+    SGDataBlock block;
+    SGCacheStats stats;
+    const char *modes[] = { "1 shard", "16 shards", "lock-free" };
+    uint32_t shards[] = { 1, 16, 16 };
+    double start, elapsed;
+    int mode, count, t;
+    uint32_t i;
+
+    memset( block, 'a', SG_BLOCK_SIZE );
+    printf( "%10s %10s %12s %12s %12s\n", "mode", "threads", "ops/sec", "ns/op", "locked" );
+
+    for ( mode = 0; mode < 3; mode++ ) {
+
+        // Room to spare, the blocks do not spread evenly over the shards
+        if ( initSGCacheWithShards(SG_BENCH_SHARING_BLOCKS * 2, SG_CACHE_LRU, shards[mode]) ) {
+            fprintf( stderr, "Cache init failed.\n" );
+            return( -1 );
+        }
+        for ( i = 0; i < SG_BENCH_SHARING_BLOCKS; i++ ) {
+            putSGDataBlock( (i % 8) + 1, i + 1, block );
+        }
+
+        for ( count = 1; count <= SG_BENCH_THREADS; count *= 2 ) {
+
+            getSGCacheStats( &stats );
+            uint64_t locked = stats.lockedReads;
+
+            start = benchNow();
+            for ( t = 0; t < count; t++ ) {
+                threads[t].ops = benchOps / count;
+                threads[t].lockFree = (mode == 2);
+                threads[t].failed = 0;
+                if ( pthread_create(&threads[t].thread, NULL, benchSharingRun, &threads[t]) ) {
+                    fprintf( stderr, "Thread creation failed.\n" );
+                    return( -1 );
+                }
+            }
+            for ( t = 0; t < count; t++ ) {
+                pthread_join( threads[t].thread, NULL );
+                if ( threads[t].failed ) {
+                    fprintf( stderr, "Thread %d missed a resident block.\n", t );
+                    return( -1 );
+                }
+            }
+            elapsed = benchNow() - start;
+
+            getSGCacheStats( &stats );
+            printf( "%10s %10d %12.0f %12.1f %12lu\n", modes[mode], count, benchOps / elapsed,
+                                        elapsed * 1e9 / benchOps, stats.lockedReads - locked );
+        }
+
+        closeSGCache();
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchSharingRun
+// Description  : The work of one thread of benchSharing, random hits over
+//                the resident blocks copying out the first bytes of each
+//
+// Inputs       : arg - the BenchReader
+// Outputs      : NULL
+
+void *benchSharingRun( void *arg ) {
+
+    BenchReader *br = (BenchReader *) arg;
+    char buf[SG_BENCH_THREAD_IO], *data;
+    uint32_t i, k;
+
+    // Each thread has its own random sequence
+    benchRandState = 88172645463325252ULL ^ (uint64_t) (uintptr_t) br;
+
+    for ( i = 0; i < br->ops && !br->failed; i++ ) {
+        k = (uint32_t) (benchRandom() % SG_BENCH_SHARING_BLOCKS);
+        if ( br->lockFree ) {
+            br->failed = readSGDataBlock( (k % 8) + 1, k + 1, buf, 0, SG_BENCH_THREAD_IO ) != 0;
+        } else if ( (data = getSGDataBlock((k % 8) + 1, k + 1)) != NULL ) {
+            memcpy( buf, data, SG_BENCH_THREAD_IO );
+        } else {
+            br->failed = 1;
+        }
+    }
+
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchStream
+// Description  : Measure one thread rewriting and reading back a file
+//                sequentially, in transfers of 1 to SG_BENCH_STREAM_IO
+//                blocks, with a cache too small to hold it (the blocks of a
+//                transfer are pipelined or batched to their nodes)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int benchStream( void ) {
+
+    static char data[SG_BLOCK_SIZE * SG_BENCH_STREAM_IO];
+    uint32_t io, i;
+    double start, writeSecs, readSecs;
+    SgFHandle fh;
+
+    // Run against the stand-in service, every read missing the cache
+    benchLocalService();
+    setenv( SG_CACHE_SIZE_ENV, SG_BENCH_STREAM_CACHE, 0 );
+    if ( (fh = sgopen("sg_bench_stream")) == -1 ) {
+        fprintf( stderr, "Open failed.\n" );
+        return( -1 );
+    }
+
+    // Create the file
+    memset( data, 'a', sizeof(data) );
+    for ( i = 0; i < SG_BENCH_STREAM_BLOCKS; i += SG_BENCH_STREAM_IO ) {
+        if ( sgwrite(fh, data, sizeof(data)) != sizeof(data) ) {
+            fprintf( stderr, "Write failed.\n" );
+            return( -1 );
+        }
+    }
+
+    printf( "%10s %12s %12s\n", "blocks/io", "write MB/s", "read MB/s" );
+    for ( io = 1; io <= SG_BENCH_STREAM_IO; io *= 4 ) {
+
+        int len = io * SG_BLOCK_SIZE;
+
+        // Rewrite the file, then read it back
+        sgseek( fh, 0 );
+        start = benchNow();
+        for ( i = 0; i < SG_BENCH_STREAM_BLOCKS; i += io ) {
+            if ( sgwrite(fh, data, len) != len ) {
+                fprintf( stderr, "Write failed.\n" );
+                return( -1 );
+            }
+        }
+        writeSecs = benchNow() - start;
+
+        sgseek( fh, 0 );
+        start = benchNow();
+        for ( i = 0; i < SG_BENCH_STREAM_BLOCKS; i += io ) {
+            if ( sgread(fh, data, len) != len || data[0] != 'a' || data[len - 1] != 'a' ) {
+                fprintf( stderr, "Read failed.\n" );
+                return( -1 );
+            }
+        }
+        readSecs = benchNow() - start;
+
+        printf( "%10u %12.1f %12.1f\n", io,
+                SG_BENCH_STREAM_BLOCKS * (double) SG_BLOCK_SIZE / writeSecs / 1e6,
+                SG_BENCH_STREAM_BLOCKS * (double) SG_BLOCK_SIZE / readSecs / 1e6 );
+    }
+
+    sgshutdown();
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchLocalService
+// Description  : Have the driver post to the stand-in service, with the
+//                link given on the command line, unless the environment
+//                already points it at sg_blockd servers
+//
+// Inputs       : none
+// Outputs      : none
+
+void benchLocalService( void ) {
+
+    char value[16];
+    char *service = getenv(SG_SERVICE_ENV);
+
+    if ( service != NULL && (strcmp(service, sgSocketTransport.name) == 0 ||
+                             strcmp(service, sgShmTransport.name) == 0) ) {
+        return;
+    }
+    setenv( SG_SERVICE_ENV, "local", 1 );
+    snprintf( value, sizeof(value), "%u", benchLatency );
+    setenv( SG_SERVICE_LATENCY_ENV, value, 1 );
+    snprintf( value, sizeof(value), "%u", benchBandwidth );
+    setenv( SG_SERVICE_BANDWIDTH_ENV, value, 1 );
+    snprintf( value, sizeof(value), "%u", benchJitter );
+    setenv( SG_SERVICE_JITTER_ENV, value, 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchNow
+// Description  : Read the monotonic clock
+//
+// Inputs       : none
+// Outputs      : the current time in seconds
+
+double benchNow( void ) {
+
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec + ts.tv_nsec / 1e9 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : benchRandom
+// Description  : Generate a pseudo-random number (xorshift64)
+//
+// Inputs       : none
+// Outputs      : the next random value
+
+uint64_t benchRandom( void ) {
+
+    benchRandState ^= benchRandState << 13;
+    benchRandState ^= benchRandState >> 7;
+    benchRandState ^= benchRandState << 17;
+    return( benchRandState );
+}
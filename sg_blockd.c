@@ -0,0 +1,377 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_blockd.c
+//  Description    : This is the ScatterGather block server, one remote node
+//                   serving the blocks it stores over a TCP or Unix domain
+//                   socket.  Requests arrive as frames of serialized
+//                   packets (see sg_socket.h) and are answered in the order
+//                   they arrive on each connection, so a driver may keep
+//                   many in flight.  Run several with distinct node IDs and
+//                   list them in SG_SERVICE_ADDRESS to spread the blocks.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include <sg_defs.h>
+#include <sg_driver.h>
+#include <sg_local_service.h>
+#include <sg_socket.h>
+#include <sg_shm.h>
+
+// Defines
+#define SG_BLOCKD_ARGUMENTS "hvzn:"
+#define SG_BLOCKD_MAX_CLIENTS 256 // Most connections served at once
+#define SG_BLOCKD_DEFAULT_NODE 0x5100
+#define USAGE \
+    "USAGE: sg_blockd [-h] [-v] [-z] [-n <node id>] <address>\n" \
+    "\n" \
+    "where:\n" \
+    "    -h - help mode (display this message)\n" \
+    "    -v - verbose output\n" \
+    "    -z - send blocks compressed where it pays\n" \
+    "    -n - node ID of the server (default 0x5100)\n" \
+    "and\n" \
+    "    address - where to listen, unix:<path> or <host>:<port>\n" \
+    "\n" \
+
+//
+// Type definitions
+
+// A connected driver
+typedef struct {
+    int fd;
+    SGSocketBuffer in;  // Requests received, not yet answered
+    SGSocketBuffer out; // Responses to send
+    SGShmRegion *ring;  // Rings shared by a driver on this host, or NULL
+    int doorbell;       // Rung by the driver when the server is idle
+    int wake;           // Rung to wake the driver
+} BlockdClient;
+
+//
+// Global Data
+unsigned long SGServiceLevel; // Service log level
+unsigned long SGDriverLevel; // Controller log level
+unsigned long SGSimulatorLevel; // Simulation log level
+volatile sig_atomic_t blockdStop = 0; // Set by SIGINT and SIGTERM
+
+//
+// Functional Prototypes
+
+int blockdServe( int listener ); // Serve clients until stopped
+int blockdReceive( BlockdClient *client ); // Read requests, or rings to attach
+int blockdAnswer( BlockdClient *client ); // Answer the requests received
+void blockdDrop( BlockdClient *client ); // Disconnect a driver
+void blockdSignal( int sig ); // Stop the server
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : The main function for the ScatterGather block server
+//
+// Inputs       : argc - the number of command line parameters
+//                argv - the parameters
+// Outputs      : 0 if successful, -1 if failure
+
+int main( int argc, char *argv[] ) {
+
+    // Local variables
+    int ch, verbose = 0, compress = 0, listener;
+    SG_Node_ID node = SG_BLOCKD_DEFAULT_NODE;
+
+    // Process the command line parameters
+    while ((ch = getopt(argc, argv, SG_BLOCKD_ARGUMENTS)) != -1) {
+
+        switch (ch) {
+        case 'h': // Help, print usage
+            fprintf( stderr, USAGE );
+            return( -1 );
+
+        case 'v': // Verbose Flag
+            verbose = 1;
+            break;
+
+        case 'z': // Compress the blocks answered
+            compress = 1;
+            break;
+
+        case 'n': // Node ID
+            node = (SG_Node_ID) strtoull( optarg, NULL, 0 );
+            break;
+
+        default:  // Default (unknown)
+            fprintf( stderr, "Unknown command line option (%c), aborting.\n", ch );
+            return( -1 );
+        }
+    }
+
+    // Setup the log, log levels
+    initializeLogWithFilehandle( CMPSC311_LOG_STDERR );
+    SGServiceLevel = registerLogLevel("SG_SERVICE", 0);
+    SGDriverLevel = registerLogLevel("SG_DRIVER", 0);
+    SGSimulatorLevel = registerLogLevel("SG_SIMULATOR", 0);
+    if ( verbose ) {
+        enableLogLevels( LOG_INFO_LEVEL );
+        enableLogLevels( SGServiceLevel );
+    }
+
+    if ( argv[optind] == NULL ) {
+        fprintf( stderr, "Missing listen address, use -h to see usage, aborting.\n" );
+        return( -1 );
+    }
+
+    // One node, the network does the waiting, and the drivers pipeline
+    // requests over several connections so seqnos arrive out of order
+    if ( initSGLocalService(0, 0, 0) || setSGLocalServiceNodes(node, 1) ) {
+        logMessage( LOG_ERROR_LEVEL, "sg_blockd: bad node ID %lu.", node );
+        return( -1 );
+    }
+    setSGLocalServiceSequenceCheck( 0 );
+    setSGPacketCompression( compress );
+
+    if ( (listener = sgSocketListen(argv[optind])) == -1 ) {
+        logMessage( LOG_ERROR_LEVEL, "sg_blockd: cannot listen on [%s].", argv[optind] );
+        closeSGLocalService();
+        return( -1 );
+    }
+    signal( SIGPIPE, SIG_IGN );
+    signal( SIGINT, blockdSignal );
+    signal( SIGTERM, blockdSignal );
+    logMessage( LOG_INFO_LEVEL, "sg_blockd: node %lu listening on [%s].", node, argv[optind] );
+
+    int ret = blockdServe(listener);
+
+    close( listener );
+    if ( strncmp(argv[optind], "unix:", 5) == 0 ) {
+        unlink( argv[optind] + 5 );
+    }
+    closeSGLocalService();
+    logMessage( LOG_INFO_LEVEL, "sg_blockd: node %lu stopped.", node );
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : blockdServe
+// Description  : Accept drivers and answer their requests until stopped,
+//                polling the rings of drivers on this host for a while
+//                after each request before sleeping
+//
+// Inputs       : listener - the listening socket
+// Outputs      : 0 if successful, -1 if failure
+
+int blockdServe( int listener ) {
+
+    struct pollfd fds[SG_BLOCKD_MAX_CLIENTS * 2 + 1];
+    BlockdClient *clients[SG_BLOCKD_MAX_CLIENTS];
+    int count = 0, spins = SG_SHM_SPIN, timeout, i;
+    uint64_t value;
+
+    while ( !blockdStop ) {
+
+        // Sleep only once every ring is marked idle and still empty
+        timeout = -1;
+        for ( i = 0; i < count; i++ ) {
+            if ( clients[i]->ring != NULL && (spins < SG_SHM_SPIN || sgShmSleep(clients[i]->ring)) ) {
+                timeout = 0;
+            }
+        }
+
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for ( i = 0; i < count; i++ ) {
+            fds[i * 2 + 1].fd = clients[i]->fd;
+            fds[i * 2 + 1].events = POLLIN;
+            fds[i * 2 + 2].fd = (clients[i]->ring != NULL) ? clients[i]->doorbell : -1;
+            fds[i * 2 + 2].events = POLLIN;
+        }
+        if ( poll(fds, count * 2 + 1, timeout) == -1 ) {
+            continue; // Interrupted, check the stop flag
+        }
+
+        // Answer what is in the rings
+        int busy = 0;
+        for ( i = 0; i < count; i++ ) {
+            if ( clients[i]->ring == NULL ) {
+                continue;
+            }
+            if ( fds[i * 2 + 2].revents != 0 &&
+                 read(clients[i]->doorbell, &value, sizeof(value)) == -1 && errno != EAGAIN ) {
+                logMessage( LOG_ERROR_LEVEL, "sg_blockd: cannot read doorbell of client %d.", clients[i]->fd );
+            }
+            busy += sgShmServe(clients[i]->ring, clients[i]->wake, sgLocalServicePost);
+        }
+        if ( busy > 0 ) {
+            spins = 0;
+        } else if ( spins < SG_SHM_SPIN ) {
+            spins++;
+            sched_yield();
+        }
+
+        // Answer the clients that sent something, drop the ones gone
+        for ( i = count - 1; i >= 0; i-- ) {
+            if ( fds[i * 2 + 1].revents == 0 ) {
+                continue;
+            }
+            if ( blockdReceive(clients[i]) || blockdAnswer(clients[i]) ) {
+                logMessage( SGServiceLevel, "sg_blockd: client %d disconnected.", clients[i]->fd );
+                blockdDrop( clients[i] );
+                clients[i] = clients[--count];
+            }
+        }
+
+        // A new driver connection
+        if ( fds[0].revents & POLLIN ) {
+            int fd = sgSocketAccept(listener);
+            if ( fd == -1 ) {
+                continue;
+            }
+            if ( count == SG_BLOCKD_MAX_CLIENTS ||
+                 (clients[count] = (BlockdClient *) malloc(sizeof(BlockdClient))) == NULL ) {
+                logMessage( LOG_ERROR_LEVEL, "sg_blockd: refusing client, too many connections." );
+                close( fd );
+                continue;
+            }
+            clients[count]->fd = fd;
+            clients[count]->in.used = 0;
+            clients[count]->out.used = 0;
+            clients[count]->ring = NULL;
+            clients[count]->doorbell = clients[count]->wake = -1;
+            logMessage( SGServiceLevel, "sg_blockd: client %d connected.", fd );
+            count++;
+        }
+    }
+
+    for ( i = 0; i < count; i++ ) {
+        blockdDrop( clients[i] );
+    }
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : blockdReceive
+// Description  : Read what a driver sent, attaching the rings it passes
+//                (the empty frame carrying them is answered like any other)
+//
+// Inputs       : client - the driver
+// Outputs      : 0 if successful, -1 if the connection must be dropped
+
+int blockdReceive( BlockdClient *client ) {
+
+    int fds[SG_SOCKET_MAX_FDS], nfds = SG_SOCKET_MAX_FDS;
+
+    if ( sgSocketFillFds(client->fd, &client->in, 0, fds, &nfds) ) {
+        return( -1 );
+    }
+    if ( nfds == 0 ) {
+        return( 0 );
+    }
+
+    if ( nfds == SG_SHM_FDS && client->ring == NULL ) {
+        if ( (client->ring = sgShmAttach(fds[0])) != NULL ) {
+            client->doorbell = fds[1];
+            client->wake = fds[2];
+            logMessage( SGServiceLevel, "sg_blockd: client %d attached its rings.", client->fd );
+            return( 0 );
+        }
+        fds[0] = -1; // Closed by sgShmAttach
+    }
+
+    logMessage( LOG_ERROR_LEVEL, "sg_blockd: bad rings from client %d.", client->fd );
+    for ( int i = 0; i < nfds; i++ ) {
+        if ( fds[i] != -1 ) {
+            close( fds[i] );
+        }
+    }
+    return( -1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : blockdAnswer
+// Description  : Answer every whole request received from a driver, the
+//                responses go out together
+//
+// Inputs       : client - the driver
+// Outputs      : 0 if successful, -1 if the connection must be dropped
+
+int blockdAnswer( BlockdClient *client ) {
+
+    char rpacket[SG_BATCH_PACKET_SIZE];
+    size_t pos = 0, len, rlen;
+    char *packet;
+
+    while ( (packet = sgSocketNextFrame(&client->in, &pos, &len)) != NULL ) {
+
+        // Refused packets get an empty frame, so the driver stays in step
+        // (an empty frame, as the one passing rings, is answered in kind)
+        rlen = SG_BATCH_PACKET_SIZE;
+        if ( len == 0 || len > SG_BATCH_PACKET_SIZE || sgLocalServicePost(packet, &len, rpacket, &rlen) ) {
+            rlen = 0;
+        }
+
+        // Send what is queued when the next response will not fit
+        if ( sgSocketAppendFrame(&client->out, rpacket, rlen) ) {
+            if ( sgSocketFlush(client->fd, &client->out) ||
+                 sgSocketAppendFrame(&client->out, rpacket, rlen) ) {
+                return( -1 );
+            }
+        }
+    }
+    sgSocketCompact( &client->in, pos );
+
+    // A frame larger than the buffer can never complete
+    if ( client->in.used == sizeof(client->in.data) ) {
+        logMessage( LOG_ERROR_LEVEL, "sg_blockd: oversized frame from client %d.", client->fd );
+        return( -1 );
+    }
+
+    return( sgSocketFlush(client->fd, &client->out) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : blockdDrop
+// Description  : Disconnect a driver, unmapping its rings
+//
+// Inputs       : client - the driver
+// Outputs      : none
+
+void blockdDrop( BlockdClient *client ) {
+
+    if ( client->ring != NULL ) {
+        sgShmDetach( client->ring );
+        close( client->doorbell );
+        close( client->wake );
+    }
+    close( client->fd );
+    free( client );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : blockdSignal
+// Description  : Ask the server to stop
+//
+// Inputs       : sig - the signal
+// Outputs      : none
+
+void blockdSignal( int sig ) {
+
+    blockdStop = 1;
+}
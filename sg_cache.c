@@ -13,27 +13,136 @@
 #include <stdlib.h>
 #include <cmpsc311_log.h>
 #include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <sched.h>
 
 // Project Includes
-#include <sg_cache.h>
+#include <sg_cache_policy.h>
+#include <sg_compress.h>
 
 // Defines
-typedef struct cache {
-    int lastUsed;
-    char Data[SG_BLOCK_SIZE];
-    SG_Block_ID cacheBlockId;
-    SG_Node_ID cacheRemNoteId;
-} Cache;
-
-Cache *myCache;
-
-int timeCount = 1;  // Count last used time
-int hitCount = 0;   // Count hit
-int missCount = 0;  // Count miss
-int line = 0;       // Count lines
-int getCount = 0;   // Count how many times getBlock is called
-int itemCount = 0;  // Count how many items are there
+#define SG_CACHE_SHARD_MIN 256   // Fewest blocks per shard when sized automatically
+#define SG_CACHE_MAX_READERS 64  // Threads that can read without locking at once
+#define SG_CACHE_READ_BUFFER 32  // Hits a thread records before replaying them
+#define SG_CACHE_READ_TRIES 4    // Optimistic lookups before taking the lock
+#define SG_CACHE_CHAIN_LIMIT 64  // Longest chain walked without the lock
+#define SG_CACHE_RECENT_SHARE 4  // Hits in the newest 1/4 of touches are not replayed
+#define SG_CACHE_TIER_SPREAD (SG_BLOCK_SIZE / 4) // Compressed bytes per tier bucket
+
+// An evicted block held compressed, on its shard's tier list (newest first)
+typedef struct cache_tier {
+    SG_Node_ID nde;
+    SG_Block_ID blk;
+    struct cache_tier *hashNext; // Next block in the same tier bucket
+    struct cache_tier *prev;     // Tier list neighbour (towards the head)
+    struct cache_tier *next;     // Tier list neighbour (towards the tail)
+    uint32_t len;                // Length of the compressed block
+    char data[];                 // The compressed block
+} CacheTier;
+
+// A shard of the cache, blocks are spread over the shards by their hash.  The
+// sequence number is odd while the table or a block of the shard is being
+// changed, readers that see it change retry (seqlock).
+typedef struct {
+    pthread_mutex_t lock;   // Held to change the shard
+    uint32_t seq;           // Change count, odd while changing
+    uint32_t touchClock;    // Hits and insertions seen by the policy
+    Cache **buckets;        // Hash table, indexed by hashSGCacheKey
+    uint64_t bucketMask;    // Number of buckets - 1 (power of two)
+    Cache *freeEntries;     // Allocated entries not holding a block
+    void *policyState;      // The state of the policy for the shard
+    uint32_t maxItems;      // Share of the capacity, exceeded while others leave room
+    uint32_t itemCount;     // Blocks in the shard
+    uint32_t dirtyCount;    // Dirty blocks in the shard
+    uint64_t insertCount;   // Blocks inserted
+    uint64_t evictCount;    // Blocks evicted
+    uint64_t writebackCount; // Dirty blocks written back
+    CacheTier **tierBuckets; // Blocks held compressed, by hashSGCacheKey
+    uint64_t tierMask;       // Number of tier buckets - 1 (power of two)
+    CacheTier *tierHead;     // Most recently evicted block held compressed
+    CacheTier *tierTail;     // The next one the tier drops
+    uint64_t tierBytes;      // Memory of the blocks held compressed
+    uint64_t tierLimit;      // Most memory they may take
+    uint32_t tierCount;      // Blocks held compressed
+    uint64_t tierHits;       // Blocks found compressed and taken back
+    uint64_t tierStores;     // Evicted blocks compressed
+    uint64_t tierSkips;      // Evicted blocks that compressed poorly
+} __attribute__((aligned(64))) CacheShard;
+
+// A thread reading without the lock, on its own cache line
+typedef struct {
+    int taken;  // Slot belongs to a thread
+    int active; // The thread is in a lookup
+} __attribute__((aligned(64))) CacheReader;
+
+// A hit not yet replayed to the policy
+typedef struct {
+    Cache *entry;
+    CacheShard *shard;
+    SG_Node_ID nde;
+    SG_Block_ID blk;
+} CacheRead;
+
+CacheShard *cacheShards = NULL; // The shards
+uint32_t shardMask = 0;          // Number of shards - 1 (power of two)
+
+const SGCachePolicyOps *cachePolicy; // The replacement policy
+SGCacheWriteback cacheWriteback;     // Writes dirty blocks to their node
+
+uint32_t maxItems = 0;      // Capacity of the cache
+uint32_t cacheTierShare = 0; // Percent of the capacity holding blocks compressed
+uint32_t cacheItemCount = 0; // Blocks in all the shards
+uint32_t cacheItemLimit = 0; // Blocks all the shards hold as they are
+uint64_t hitCount = 0;      // Count hit
+uint64_t getCount = 0;      // Count how many times a block is looked up
+uint64_t lockedReadCount = 0; // Reads that had to take a shard lock
+uint32_t cacheGeneration = 0; // Changed when entries may be freed
+
+CacheReader cacheReaders[SG_CACHE_MAX_READERS]; // Lock-free readers
+int cacheQuiescing = 0;      // Entries are about to be freed, readers lock
+pthread_once_t cacheReaderOnce = PTHREAD_ONCE_INIT;
+pthread_key_t cacheReaderKey; // Releases a thread's slot when it exits
+
+// Each thread records its hits and counts them, the policy sees the hits
+// (and the totals the counts) in batches
+__thread CacheRead cacheReads[SG_CACHE_READ_BUFFER];
+__thread int cacheReadCount = 0;
+__thread uint32_t cacheReadGeneration = 0;
+__thread uint64_t cacheReadHits = 0, cacheReadGets = 0;
+__thread int cacheReaderSlot = -1; // -1 none yet, -2 none free
+
 // Functional Prototypes
+CacheShard *findSGCacheShard( uint64_t hash ); // Shard of a hash
+Cache *findSGCacheEntry( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ); // Hash lookup
+void unhashSGCacheEntry( CacheShard *shard, Cache *entry ); // Remove from the hash table
+void touchSGCacheEntry( CacheShard *shard, Cache *entry ); // Tell the policy about a hit
+Cache *allocSGCacheEntry( CacheShard *shard ); // Get an entry for a new block
+Cache *evictSGCacheEntry( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ); // Make room
+Cache *reclaimSGCacheEntry( CacheShard *shard ); // Take back borrowed capacity
+int writebackSGCacheEntry( CacheShard *shard, Cache *entry ); // Clean a dirty entry
+int storeSGCacheEntry( SG_Node_ID nde, SG_Block_ID blk, char *block ); // Insert or update
+int rehashSGCache( CacheShard *shard, uint32_t maxElements ); // Size the hash table
+int resizeSGCacheShard( CacheShard *shard, uint32_t maxElements ); // Resize one shard
+uint32_t getSGCacheShardSize( uint32_t index ); // Blocks a shard holds as they are
+uint32_t getSGCacheShardBudget( uint32_t index ); // Capacity share of a shard
+uint64_t getSGCacheTierSize( uint32_t index ); // Memory a shard holds compressed
+int splitSGCache( void ); // Size every shard and its tier
+void stashSGCacheTier( CacheShard *shard, Cache *entry ); // Keep an evicted block compressed
+CacheTier *findSGCacheTier( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ); // Tier lookup
+void dropSGCacheTier( CacheShard *shard, CacheTier *tier ); // Free a block held compressed
+Cache *promoteSGCacheTier( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ); // Take a block back
+int rehashSGCacheTier( CacheShard *shard ); // Size the tier for its memory
+void beginSGCacheChange( CacheShard *shard ); // Make the sequence odd
+void endSGCacheChange( CacheShard *shard ); // Make the sequence even
+int readSGCacheOptimistic( CacheShard *shard, uint64_t hash, SG_Node_ID nde, SG_Block_ID blk,
+                           char *buf, uint32_t start, uint32_t len, Cache **found, uint32_t *stamp ); // Lock-free lookup
+void recordSGCacheRead( CacheShard *shard, Cache *entry, uint32_t stamp, SG_Node_ID nde, SG_Block_ID blk ); // Buffer a hit
+void drainSGCacheReads( void ); // Replay the buffered hits
+int claimSGCacheReader( void ); // Take a reader slot
+void initSGCacheReaders( void ); // Create the slot key
+void releaseSGCacheReader( void *slot ); // Give a slot back at thread exit
+void quiesceSGCacheReaders( void ); // Wait out the lock-free readers
 
 //
 // Functions
@@ -41,19 +150,119 @@ int itemCount = 0;  // Count how many items are there
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : initSGCache
+// Description  : Initialize the cache of block elements, the policy is taken
+//                from the SG_CACHE_POLICY environment variable (default LRU),
+//                the number of shards from SG_CACHE_SHARDS (default by
+//                size) and the share held compressed from
+//                SG_CACHE_COMPRESSED (default none)
+//
+// Inputs       : maxElements - maximum number of elements allowed
+// Outputs      : 0 if successful, -1 if failure
+
+int initSGCache( uint32_t maxElements ) {
+
+    int policy = SG_CACHE_LRU;
+    char *name = getenv(SG_CACHE_POLICY_ENV);
+    char *shards = getenv(SG_CACHE_SHARDS_ENV);
+    char *compressed = getenv(SG_CACHE_COMPRESSED_ENV);
+
+    if ( name != NULL && (policy = getSGCachePolicyByName(name)) == -1 ) {
+        logMessage(LOG_WARNING_LEVEL, "Unknown cache policy [%s], using LRU", name);
+        policy = SG_CACHE_LRU;
+    }
+
+    if ( initSGCacheWithShards(maxElements, policy, (shards != NULL) ? atoi(shards) : 0) ) {
+        return( -1 );
+    }
+
+    if ( compressed != NULL && setSGCacheCompression(atoi(compressed)) ) {
+        logMessage(LOG_WARNING_LEVEL, "Bad compressed cache share [%s], using none", compressed);
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : initSGCacheWithPolicy
 // Description  : Initialize the cache of block elements
 //
 // Inputs       : maxElements - maximum number of elements allowed
+//                policy - the replacement policy
+// Outputs      : 0 if successful, -1 if failure
+
+int initSGCacheWithPolicy( uint32_t maxElements, SGCachePolicy policy ) {
+
+    return( initSGCacheWithShards(maxElements, policy, 0) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : initSGCacheWithShards
+// Description  : Initialize the cache of block elements split into shards,
+//                each with its own lock, table and policy state
+//
+// Inputs       : maxElements - maximum number of elements allowed
+//                policy - the replacement policy
+//                shards - the number of shards (a power of two, at most
+//                         SG_CACHE_MAX_SHARDS), 0 to size by capacity
 // Outputs      : 0 if successful, -1 if failure
 
-int initSGCache( uint16_t maxElements ) {
+int initSGCacheWithShards( uint32_t maxElements, SGCachePolicy policy, uint32_t shards ) {
+
+    if ( maxElements == 0 || policy < 0 || policy >= SG_CACHE_MAX_POLICY || cacheShards != NULL ||
+         shards > SG_CACHE_MAX_SHARDS || (shards & (shards - 1)) != 0 ) {
+        return( -1 );
+    }
 
-    myCache = (Cache*) malloc(maxElements * sizeof(Cache));
+    // Small caches stay in one shard so the policy sees every block
+    if ( shards == 0 ) {
+        shards = 1;
+        while ( shards < SG_CACHE_MAX_SHARDS && shards * 2 * SG_CACHE_SHARD_MIN <= maxElements ) {
+            shards *= 2;
+        }
+    }
+    if ( shards > maxElements ) {
+        return( -1 );
+    }
 
-    // Initialization failed
-    if ( myCache == NULL ) {
+    if ( (cacheShards = (CacheShard*) aligned_alloc(64, sizeof(CacheShard) * shards)) == NULL ) {
         return( -1 );
     }
+    memset(cacheShards, 0, sizeof(CacheShard) * shards);
+    shardMask = shards - 1;
+    maxItems = maxElements;
+    cachePolicy = sgCachePolicies[policy];
+
+    // Entries are allocated as blocks arrive, only the tables are sized now
+    cacheItemCount = cacheItemLimit = 0;
+    for ( uint32_t i = 0; i < shards; i++ ) {
+        CacheShard *shard = &cacheShards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->maxItems = getSGCacheShardSize(i);
+        cacheItemLimit += shard->maxItems;
+        shard->policyState = cachePolicy->create(shard->maxItems);
+
+        // Initialization failed
+        if ( shard->policyState == NULL || rehashSGCache(shard, shard->maxItems) ) {
+            for ( uint32_t j = 0; j <= i; j++ ) {
+                if ( cacheShards[j].policyState != NULL ) {
+                    cachePolicy->destroy(cacheShards[j].policyState);
+                }
+                free(cacheShards[j].buckets);
+                pthread_mutex_destroy(&cacheShards[j].lock);
+            }
+            free(cacheShards);
+            cacheShards = NULL;
+            return( -1 );
+        }
+    }
+
+    hitCount = getCount = lockedReadCount = 0;
+    ghostHitCount = 0;
+    cacheReadCount = 0;
+    cacheReadHits = cacheReadGets = 0;
+    cacheGeneration++;
 
     // Return successfully
     return( 0 );
@@ -63,22 +272,75 @@ int initSGCache( uint16_t maxElements ) {
 //
 // Function     : closeSGCache
 // Description  : Close the cache of block elements, clean up remaining data
+//                (no other thread may be using the cache)
 //
 // Inputs       : none
 // Outputs      : 0 if successful, -1 if failure
 
 int closeSGCache( void ) {
 
-    float hitRate;
-    hitRate = (float) hitCount / getCount * 100;
+    SGCacheStats stats;
+    Cache *entry, *next;
+
+    if ( getSGCacheStats(&stats) ) {
+        return( -1 );
+    }
+
+    float hitRate = 0;
+    if ( stats.queries > 0 ) {
+        hitRate = (float) stats.hits / stats.queries * 100;
+    }
+
+    logMessage(SGDriverLevel, "Closing cache: %lu queries, %lu hits (%.2f%% hit rate).",
+                                                        stats.queries, stats.hits, hitRate);
+    logMessage(SGDriverLevel, "Cache policy %s: %lu inserts, %lu evictions, %lu ghost hits, %lu writebacks.",
+                        stats.policy, stats.inserts, stats.evictions, stats.ghostHits, stats.writebacks);
+    if ( cacheTierShare > 0 ) {
+        uint64_t stores = 0, skips = 0;
+        for ( uint32_t i = 0; i <= shardMask; i++ ) {
+            stores += cacheShards[i].tierStores;
+            skips += cacheShards[i].tierSkips;
+        }
+        logMessage(SGDriverLevel, "Cache compressed %u%%: %u blocks held, %lu hits, %lu stored, %lu not compressible.",
+                        cacheTierShare, stats.compressed, stats.compressedHits, stores, skips);
+    }
+    if ( stats.dirty > 0 ) {
+        logMessage(LOG_WARNING_LEVEL, "Closing cache with %u unflushed dirty blocks.", stats.dirty);
+    }
 
-    logMessage(SGDriverLevel, "Closing cache: %d queries, %d hits (%.2f%% hit rate).", 
-                                                        getCount, hitCount, hitRate);
+    logMessage(LOG_INFO_LEVEL, "Closed cmpsc311 cache, deleting %u items", stats.items);
 
-    logMessage(LOG_INFO_LEVEL, "Closed cmpsc311 cache, deleting %d items", itemCount);
+    // Free the cached blocks and the spare entries of every shard
+    quiesceSGCacheReaders();
+    for ( uint32_t i = 0; i <= shardMask; i++ ) {
+        CacheShard *shard = &cacheShards[i];
+        for ( uint64_t j = 0; j <= shard->bucketMask; j++ ) {
+            for ( entry = shard->buckets[j]; entry != NULL; entry = next ) {
+                next = entry->hashNext;
+                free(entry);
+            }
+        }
+        for ( entry = shard->freeEntries; entry != NULL; entry = next ) {
+            next = entry->hashNext;
+            free(entry);
+        }
+        while ( shard->tierHead != NULL ) {
+            dropSGCacheTier(shard, shard->tierHead);
+        }
+        free(shard->tierBuckets);
+        cachePolicy->destroy(shard->policyState);
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->lock);
+    }
 
-    free(myCache);
-    myCache = NULL;
+    free(cacheShards);
+    cacheShards = NULL;
+    shardMask = 0;
+    maxItems = 0;
+    cacheItemCount = cacheItemLimit = 0;
+    cacheTierShare = 0;
+    cacheGeneration++;
+    __atomic_store_n(&cacheQuiescing, 0, __ATOMIC_SEQ_CST);
 
     // Return successfully
     return( 0 );
@@ -87,7 +349,9 @@ int closeSGCache( void ) {
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : getSGDataBlock
-// Description  : Get the data block from the block cache
+// Description  : Get the data block from the block cache, the pointer is
+//                only good until the next call (use readSGDataBlock when
+//                other threads use the cache)
 //
 // Inputs       : nde - node ID to find
 //                blk - block ID to find
@@ -95,22 +359,30 @@ int closeSGCache( void ) {
 
 char * getSGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
 
-    getCount++;
+    if ( cacheShards == NULL ) {
+        return( NULL );
+    }
 
-    for ( int i = 0; i < line; i++ ){
-        
-        // If nde and blk match IDs
-        if ( nde == myCache[i].cacheRemNoteId && blk == myCache[i].cacheBlockId )
-        {
-            logMessage(LOG_INFO_LEVEL, "Getting found cache item");
-            myCache[i].lastUsed = timeCount;
-            hitCount++;
-            timeCount++;
+    drainSGCacheReads();
+    cacheReadGets++;
 
-            // Return successfully
-            return( myCache[i].Data );
-        }
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL ) {
+        touchSGCacheEntry(shard, entry);
+    } else {
+        entry = promoteSGCacheTier(shard, nde, blk);
+    }
+    if ( entry != NULL ) {
+        logMessage(LOG_INFO_LEVEL, "Getting found cache item");
+        cacheReadHits++;
+        pthread_mutex_unlock(&shard->lock);
+
+        // Return successfully
+        return( entry->Data );
     }
+    pthread_mutex_unlock(&shard->lock);
 
     // Did not found correspoding IDs
     logMessage(LOG_INFO_LEVEL, "Getting cache item (not found!)");
@@ -119,10 +391,140 @@ char * getSGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
     return( NULL );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : readSGDataBlock
+// Description  : Copy a range of a block out of the block cache, counted
+//                as a query like getSGDataBlock.  Hits do not take the
+//                shard lock, the policy is told about them in batches.
+//
+// Inputs       : nde - node ID to find
+//                blk - block ID to find
+//                buf - place to put the range (NULL to only look)
+//                start - the start of the range in the block
+//                len - the length of the range
+// Outputs      : 0 if found, -1 if not cached
+
+int readSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, char *buf, uint32_t start, uint32_t len ) {
+
+    Cache *entry;
+    uint32_t stamp;
+    int ret;
+
+    if ( cacheShards == NULL ) {
+        return( -1 );
+    }
+
+    uint64_t hash = hashSGCacheKey(nde, blk);
+    CacheShard *shard = findSGCacheShard(hash);
+    cacheReadGets++;
+
+    // Most lookups complete without writing anything shared
+    if ( (ret = readSGCacheOptimistic(shard, hash, nde, blk, buf, start, len, &entry, &stamp)) == 0 ) {
+        cacheReadHits++;
+        recordSGCacheRead(shard, entry, stamp, nde, blk);
+        return( 0 );
+    }
+    if ( ret == -1 && __atomic_load_n(&shard->tierCount, __ATOMIC_RELAXED) == 0 ) {
+        return( -1 );
+    }
+
+    // The shard kept changing, or the block may be held compressed, look it
+    // up under the lock
+    if ( ret == 1 ) {
+        __atomic_fetch_add(&lockedReadCount, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_lock(&shard->lock);
+    entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL ) {
+        touchSGCacheEntry(shard, entry);
+    } else if ( (entry = promoteSGCacheTier(shard, nde, blk)) == NULL ) {
+        pthread_mutex_unlock(&shard->lock);
+        return( -1 );
+    }
+
+    cacheReadHits++;
+    if ( buf != NULL ) {
+        memcpy(buf, &entry->Data[start], len);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : pinSGDataBlock
+// Description  : Get a counted reference to a cached block, counted as a
+//                query like getSGDataBlock.  The block stays where it is
+//                until the reference is released, but writers of the same
+//                block still change its contents.
+//
+// Inputs       : nde - node ID to find
+//                blk - block ID to find
+//                ref - the reference to fill in
+// Outputs      : 0 if found, -1 if not cached
+
+int pinSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, SGBlockRef *ref ) {
+
+    if ( cacheShards == NULL || ref == NULL ) {
+        return( -1 );
+    }
+
+    drainSGCacheReads();
+    cacheReadGets++;
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL ) {
+        touchSGCacheEntry(shard, entry);
+    } else if ( (entry = promoteSGCacheTier(shard, nde, blk)) == NULL ) {
+        pthread_mutex_unlock(&shard->lock);
+        return( -1 );
+    }
+
+    entry->pins++;
+    cacheReadHits++;
+    pthread_mutex_unlock(&shard->lock);
+
+    ref->data = entry->Data;
+    ref->entry = entry;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : unpinSGDataBlock
+// Description  : Release a reference taken by pinSGDataBlock, the block can
+//                be evicted again once it has none
+//
+// Inputs       : ref - the reference
+// Outputs      : none
+
+void unpinSGDataBlock( SGBlockRef *ref ) {
+
+    Cache *entry = (ref != NULL) ? (Cache *) ref->entry : NULL;
+    if ( entry == NULL || cacheShards == NULL ) {
+        return;
+    }
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(entry->cacheRemNoteId, entry->cacheBlockId));
+    pthread_mutex_lock(&shard->lock);
+    if ( entry->pins > 0 ) {
+        entry->pins--;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    ref->data = NULL;
+    ref->entry = NULL;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : putSGDataBlock
-// Description  : Get the data block from the block cache
+// Description  : Get the data block from the block cache, a cached copy
+//                keeps its dirty state
 //
 // Inputs       : nde - node ID to find
 //                blk - block ID to find
@@ -131,52 +533,1381 @@ char * getSGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
 
 int putSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, char *block ) {
 
-    missCount++;
-
     // Check if nde or blk are legal
-    if ( nde == 0 || blk == 0 ) {
+    if ( nde == 0 || blk == 0 || cacheShards == NULL ) {
         return( -1 );
     }
 
-    // If nde and blk match, update
-    for ( int i = 0; i < line; i++ ) {
-        if( nde == myCache[i].cacheRemNoteId && blk == myCache[i].cacheBlockId ){ 
-            memcpy(myCache[i].Data, block, SG_BLOCK_SIZE); 
-            myCache[i].lastUsed = timeCount;
-            timeCount++;
-            return ( 0 );
+    // The policy sees this thread's hits before the insertion
+    drainSGCacheReads();
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    int ret = storeSGCacheEntry(nde, blk, block);
+    pthread_mutex_unlock(&shard->lock);
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : resizeSGCache
+// Description  : Change the capacity of a running cache, evicting blocks in
+//                policy order (and releasing their memory) when it shrinks.
+//                The capacity is split over the same shards.
+//
+// Inputs       : maxElements - new maximum number of elements
+// Outputs      : 0 if successful, -1 if failure
+
+int resizeSGCache( uint32_t maxElements ) {
+
+    int ret = 0;
+
+    if ( cacheShards == NULL || maxElements <= shardMask ) {
+        return( -1 );
+    }
+
+    // Entries are freed, no thread may be walking the tables without a lock
+    drainSGCacheReads();
+    quiesceSGCacheReaders();
+    for ( uint32_t i = 0; i <= shardMask; i++ ) {
+        pthread_mutex_lock(&cacheShards[i].lock);
+    }
+
+    // A shard that cannot shrink (its blocks pinned) puts every shard back
+    uint32_t oldItems = maxItems;
+    maxItems = maxElements;
+    ret = splitSGCache();
+    if ( ret == 0 ) {
+        logMessage(SGDriverLevel, "Resized cache from %u to %u blocks.", oldItems, maxElements);
+    } else {
+        logMessage(LOG_ERROR_LEVEL, "Cache resize from %u to %u blocks failed, kept %u.",
+                                                        oldItems, maxElements, oldItems);
+        maxItems = oldItems;
+        splitSGCache();
+    }
+    cacheGeneration++;
+
+    for ( uint32_t i = 0; i <= shardMask; i++ ) {
+        pthread_mutex_unlock(&cacheShards[i].lock);
+    }
+    __atomic_store_n(&cacheQuiescing, 0, __ATOMIC_SEQ_CST);
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : setSGCacheCompression
+// Description  : Give a share of the cache's memory to evicted blocks held
+//                compressed.  The policy's blocks get the rest, so the same
+//                memory holds more blocks when they compress well; blocks
+//                that do not are dropped as before.
+//
+// Inputs       : percent - the share of the capacity (0 for none, at most
+//                          SG_CACHE_MAX_COMPRESSED)
+// Outputs      : 0 if successful, -1 if failure
+
+int setSGCacheCompression( uint32_t percent ) {
+
+    int ret;
+
+    if ( cacheShards == NULL || percent > SG_CACHE_MAX_COMPRESSED ) {
+        return( -1 );
+    }
+
+    // Entries are freed, no thread may be walking the tables without a lock
+    drainSGCacheReads();
+    quiesceSGCacheReaders();
+    for ( uint32_t i = 0; i <= shardMask; i++ ) {
+        pthread_mutex_lock(&cacheShards[i].lock);
+    }
+
+    uint32_t oldShare = cacheTierShare;
+    cacheTierShare = percent;
+    if ( (ret = splitSGCache()) != 0 ) {
+        cacheTierShare = oldShare;
+        splitSGCache();
+    }
+    cacheGeneration++;
+
+    for ( uint32_t i = 0; i <= shardMask; i++ ) {
+        pthread_mutex_unlock(&cacheShards[i].lock);
+    }
+    __atomic_store_n(&cacheQuiescing, 0, __ATOMIC_SEQ_CST);
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : setSGCacheWriteback
+// Description  : Set the function used to write dirty blocks back to their
+//                node (on eviction and flush)
+//
+// Inputs       : writeback - the function, NULL for none
+// Outputs      : 0 if successful, -1 if failure
+
+int setSGCacheWriteback( SGCacheWriteback writeback ) {
+
+    cacheWriteback = writeback;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : dirtySGDataBlock
+// Description  : Mark a cached block as modified, it is written back when
+//                it is evicted or flushed
+//
+// Inputs       : nde - node ID of the block
+//                blk - block ID of the block
+// Outputs      : 0 if successful, -1 if the block is not cached
+
+int dirtySGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
+
+    if ( cacheShards == NULL ) {
+        return( -1 );
+    }
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry == NULL ) {
+        pthread_mutex_unlock(&shard->lock);
+        return( -1 );
+    }
+
+    if ( !entry->dirty ) {
+        entry->dirty = 1;
+        shard->dirtyCount++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : flushSGDataBlock
+// Description  : Write a block back if it is cached and dirty
+//
+// Inputs       : nde - node ID of the block
+//                blk - block ID of the block
+// Outputs      : 0 if successful (or nothing to do), -1 if failure
+
+int flushSGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
+
+    int ret = 0;
+
+    if ( cacheShards == NULL ) {
+        return( 0 );
+    }
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL && entry->dirty ) {
+        ret = writebackSGCacheEntry(shard, entry);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cleanSGDataBlock
+// Description  : Copy out a block that is cached and dirty and mark it clean,
+//                the caller writes it back (with others, in one packet)
+//
+// Inputs       : nde - node ID of the block
+//                blk - block ID of the block
+//                buf - place to put the block (SG_BLOCK_SIZE)
+// Outputs      : 0 if copied, -1 if the block is not cached or clean
+
+int cleanSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, char *buf ) {
+
+    int ret = -1;
+
+    if ( cacheShards == NULL ) {
+        return( -1 );
+    }
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL && entry->dirty ) {
+        memcpy(buf, entry->Data, SG_BLOCK_SIZE);
+        entry->dirty = 0;
+        shard->dirtyCount--;
+        shard->writebackCount++;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : probeSGDataBlock
+// Description  : Check whether a block is cached, without counting a lookup
+//                or touching the block (it keeps its place for the policy)
+//
+// Inputs       : nde - node ID of the block
+//                blk - block ID of the block
+// Outputs      : 0 if cached, -1 if not
+
+int probeSGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
+
+    if ( cacheShards == NULL ) {
+        return( -1 );
+    }
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    int cached = (findSGCacheEntry(shard, nde, blk) != NULL ||
+                  findSGCacheTier(shard, nde, blk) != NULL);
+    pthread_mutex_unlock(&shard->lock);
+
+    return( cached ? 0 : -1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : demoteSGDataBlock
+// Description  : Move a cached block to where the policy evicts next, for a
+//                block that is not used again soon
+//
+// Inputs       : nde - node ID of the block
+//                blk - block ID of the block
+// Outputs      : 0 if successful, -1 if the block is not cached
+
+int demoteSGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
+
+    if ( cacheShards == NULL ) {
+        return( -1 );
+    }
+
+    // A hit this thread has not replayed yet would move it back
+    drainSGCacheReads();
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL && cachePolicy->demote != NULL ) {
+        cachePolicy->demote(shard->policyState, entry);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return( (entry != NULL) ? 0 : -1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : dropSGDataBlock
+// Description  : Remove a block from the cache, writing it back first if it
+//                is dirty.  The entry is kept for the next block of the shard.
+//
+// Inputs       : nde - node ID of the block
+//                blk - block ID of the block
+// Outputs      : 0 if removed (or not cached), -1 if kept
+
+int dropSGDataBlock( SG_Node_ID nde, SG_Block_ID blk ) {
+
+    int ret = 0;
+
+    if ( cacheShards == NULL ) {
+        return( 0 );
+    }
+
+    // The policy sees this thread's hits before the entry goes
+    drainSGCacheReads();
+
+    CacheShard *shard = findSGCacheShard(hashSGCacheKey(nde, blk));
+    pthread_mutex_lock(&shard->lock);
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL ) {
+        if ( entry->pins > 0 || (entry->dirty && writebackSGCacheEntry(shard, entry)) ) {
+            ret = -1;
+        } else {
+
+            // Hits other threads still hold must not find it
+            cachePolicy->remove(shard->policyState, entry);
+            unhashSGCacheEntry(shard, entry);
+            __atomic_store_n(&entry->cacheRemNoteId, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&entry->cacheBlockId, 0, __ATOMIC_RELAXED);
+            entry->hashNext = shard->freeEntries;
+            shard->freeEntries = entry;
+            shard->itemCount--;
+            __atomic_fetch_sub(&cacheItemCount, 1, __ATOMIC_RELAXED);
         }
+    } else {
+        dropSGCacheTier(shard, findSGCacheTier(shard, nde, blk));
     }
+    pthread_mutex_unlock(&shard->lock);
 
-    if ( line < SG_MAX_CACHE_ELEMENTS) {    // Before reaching maximum line
+    return( ret );
+}
 
-        myCache[line].cacheRemNoteId = nde;
-        myCache[line].cacheBlockId = blk;
-        memcpy(myCache[line].Data, block, SG_BLOCK_SIZE); 
-        myCache[line].lastUsed = timeCount;
-        itemCount++;
-        line++;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : flushSGCache
+// Description  : Write back every dirty block in the cache
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if any block failed
 
-    } else {    // Reach maximum line
+int flushSGCache( void ) {
 
-        int smallestCount = 0;
+    Cache *entry;
+    int ret = 0;
 
-        // Find the least recent data block
-        for ( int i = 0; i < line; i++ ) {
-            if ( myCache[i].lastUsed < myCache[smallestCount].lastUsed ) {
-                smallestCount = i;
+    for ( uint32_t i = 0; cacheShards != NULL && i <= shardMask; i++ ) {
+        CacheShard *shard = &cacheShards[i];
+        pthread_mutex_lock(&shard->lock);
+        for ( uint64_t j = 0; shard->dirtyCount > 0 && j <= shard->bucketMask; j++ ) {
+            for ( entry = shard->buckets[j]; entry != NULL; entry = entry->hashNext ) {
+                if ( entry->dirty && writebackSGCacheEntry(shard, entry) ) {
+                    ret = -1;
+                }
             }
         }
-
-        // Place least recent(lastUsed) one with the new one
-        myCache[smallestCount].cacheRemNoteId = nde;
-        myCache[smallestCount].cacheBlockId = blk;
-        memcpy(myCache[smallestCount].Data, block, SG_BLOCK_SIZE); 
-        myCache[smallestCount].lastUsed = timeCount;
+        pthread_mutex_unlock(&shard->lock);
     }
 
-    timeCount++;
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : parseSGCacheSize
+// Description  : Convert a cache size specification to a number of blocks.
+//                A plain number is a block count, a K/M/G suffix makes it
+//                a number of bytes of block storage.
+//
+// Inputs       : spec - the specification (e.g. "4096" or "64M")
+// Outputs      : the number of blocks, 0 if the specification is bad
+
+uint32_t parseSGCacheSize( const char *spec ) {
+
+    char *end;
+    unsigned long long value = strtoull(spec, &end, 10);
+    unsigned long long scale = 0;
+
+    if ( end == spec ) {
+        return( 0 );
+    }
+
+    switch ( *end ) {
+    case 'k': case 'K': scale = 1ULL << 10; end++; break;
+    case 'm': case 'M': scale = 1ULL << 20; end++; break;
+    case 'g': case 'G': scale = 1ULL << 30; end++; break;
+    }
+    if ( *end != '\0' ) {
+        return( 0 );
+    }
+    if ( scale != 0 ) {
+        value = value * scale / SG_BLOCK_SIZE;
+    }
+
+    return( value > UINT32_MAX ? UINT32_MAX : (uint32_t) value );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : getSGCachePolicyByName
+// Description  : Look up a policy by name (case insensitive)
+//
+// Inputs       : name - the policy name ("LRU", "CLOCK", "2Q", "ARC", "LFU")
+// Outputs      : the policy or -1 if unknown
+
+int getSGCachePolicyByName( const char *name ) {
+
+    for ( int i = 0; i < SG_CACHE_MAX_POLICY; i++ ) {
+        if ( strcasecmp(name, sgCachePolicies[i]->name) == 0 ) {
+            return( i );
+        }
+    }
+
+    return( -1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : getSGCacheStats
+// Description  : Get the counters of the cache, summed over the shards (the
+//                queries of other threads are added when they replay their
+//                hits)
+//
+// Inputs       : stats - the structure to fill in
+// Outputs      : 0 if successful, -1 if failure
+
+int getSGCacheStats( SGCacheStats *stats ) {
+
+    if ( stats == NULL || cacheShards == NULL ) {
+        return( -1 );
+    }
+    drainSGCacheReads();
+
+    memset(stats, 0, sizeof(SGCacheStats));
+    stats->policy = cachePolicy->name;
+    stats->capacity = maxItems;
+    stats->shards = shardMask + 1;
+    stats->queries = __atomic_load_n(&getCount, __ATOMIC_RELAXED);
+    stats->hits = __atomic_load_n(&hitCount, __ATOMIC_RELAXED);
+    stats->misses = stats->queries - stats->hits;
+    stats->ghostHits = __atomic_load_n(&ghostHitCount, __ATOMIC_RELAXED);
+    stats->lockedReads = __atomic_load_n(&lockedReadCount, __ATOMIC_RELAXED);
+
+    for ( uint32_t i = 0; i <= shardMask; i++ ) {
+        CacheShard *shard = &cacheShards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->items += shard->itemCount;
+        stats->inserts += shard->insertCount;
+        stats->evictions += shard->evictCount;
+        stats->dirty += shard->dirtyCount;
+        stats->writebacks += shard->writebackCount;
+        stats->compressed += shard->tierCount;
+        stats->compressedHits += shard->tierHits;
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    return( 0 );
+}
+
+//
+// Cache support functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : hashSGCacheKey
+// Description  : Hash a node/block pair
+//
+// Inputs       : nde - node ID
+//                blk - block ID
+// Outputs      : the hash, callers mask it to their table size
+
+uint64_t hashSGCacheKey( SG_Node_ID nde, SG_Block_ID blk ) {
+
+    // Mix both IDs through a 64-bit finalizer so that sequential block IDs
+    // on the same node still spread across the buckets
+    uint64_t h = (nde * 0x9e3779b97f4a7c15ULL) ^ blk;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+
+    return( h );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : findSGCacheShard
+// Description  : Find the shard of a hash (the top bits, the buckets use
+//                the bottom ones)
+//
+// Inputs       : hash - the hash of the node/block pair
+// Outputs      : the shard
+
+CacheShard *findSGCacheShard( uint64_t hash ) {
+
+    return( &cacheShards[(hash >> 48) & shardMask] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : findSGCacheEntry
+// Description  : Look up the entry holding a node/block pair (the shard
+//                lock is held)
+//
+// Inputs       : shard - the shard of the pair
+//                nde - node ID to find
+//                blk - block ID to find
+// Outputs      : the entry or NULL if not cached
+
+Cache *findSGCacheEntry( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    Cache *entry = shard->buckets[hashSGCacheKey(nde, blk) & shard->bucketMask];
+    while ( entry != NULL ) {
+        if ( entry->cacheRemNoteId == nde && entry->cacheBlockId == blk ) {
+            return( entry );
+        }
+        entry = entry->hashNext;
+    }
+
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : unhashSGCacheEntry
+// Description  : Remove an entry from its hash bucket
+//
+// Inputs       : shard - the shard of the entry
+//                entry - the entry to remove
+// Outputs      : none
+
+void unhashSGCacheEntry( CacheShard *shard, Cache *entry ) {
+
+    Cache **link = &shard->buckets[hashSGCacheKey(entry->cacheRemNoteId, entry->cacheBlockId) & shard->bucketMask];
+
+    beginSGCacheChange(shard);
+    while ( *link != NULL ) {
+        if ( *link == entry ) {
+            __atomic_store_n(link, entry->hashNext, __ATOMIC_RELAXED);
+            break;
+        }
+        link = &(*link)->hashNext;
+    }
+    __atomic_store_n(&entry->hashNext, NULL, __ATOMIC_RELAXED);
+    endSGCacheChange(shard);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : touchSGCacheEntry
+// Description  : Tell the policy about a hit and stamp the entry with the
+//                shard's touch count (the shard lock is held)
+//
+// Inputs       : shard - the shard of the entry
+//                entry - the entry hit
+// Outputs      : none
+
+void touchSGCacheEntry( CacheShard *shard, Cache *entry ) {
+
+    cachePolicy->touch(shard->policyState, entry);
+    __atomic_store_n(&shard->touchClock, shard->touchClock + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->touchStamp, shard->touchClock, __ATOMIC_RELAXED);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : allocSGCacheEntry
+// Description  : Get an entry for a new block, reusing a spare one if any
+//
+// Inputs       : shard - the shard the block goes in
+// Outputs      : the entry or NULL if out of memory
+
+Cache *allocSGCacheEntry( CacheShard *shard ) {
+
+    Cache *entry = shard->freeEntries;
+    if ( entry != NULL ) {
+        shard->freeEntries = entry->hashNext;
+        return( entry );
+    }
+
+    // The block follows the entry in the same allocation
+    if ( (entry = (Cache*) calloc(1, sizeof(Cache) + SG_BLOCK_SIZE)) == NULL ) {
+        return( NULL );
+    }
+    entry->Data = (char*) (entry + 1);
+
+    return( entry );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : evictSGCacheEntry
+// Description  : Take the policy's victim out of the cache, writing it back
+//                first if it is dirty (and keeping it compressed if the
+//                cache holds blocks compressed)
+//
+// Inputs       : shard - the shard to make room in
+//                nde - node ID of the block that needs room (0 if none)
+//                blk - block ID of the block that needs room (0 if none)
+// Outputs      : the detached entry or NULL if failure
+
+Cache *evictSGCacheEntry( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    Cache *entry = cachePolicy->evict(shard->policyState, nde, blk);
+    if ( entry == NULL ) {
+        return( NULL );
+    }
+
+    // Never drop a modification, keep the block if it cannot be written
+    if ( entry->dirty && writebackSGCacheEntry(shard, entry) ) {
+        cachePolicy->insert(shard->policyState, entry);
+        return( NULL );
+    }
+
+    unhashSGCacheEntry(shard, entry);
+    stashSGCacheTier(shard, entry);
+    shard->evictCount++;
+    return( entry );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : reclaimSGCacheEntry
+// Description  : Take back capacity another shard borrowed, evicting one of
+//                its blocks in its policy order.  A shard whose lock is
+//                busy is passed over (waiting could deadlock), so the cache
+//                may briefly hold a few blocks over its capacity.
+//
+// Inputs       : shard - the shard that needs an entry (its lock is held)
+// Outputs      : the detached entry or NULL if none
+
+Cache *reclaimSGCacheEntry( CacheShard *shard ) {
+
+    Cache *entry = NULL;
+
+    for ( uint32_t i = 0; i <= shardMask && entry == NULL; i++ ) {
+        CacheShard *other = &cacheShards[i];
+        if ( other == shard || __atomic_load_n(&other->itemCount, __ATOMIC_RELAXED) <= other->maxItems ||
+             pthread_mutex_trylock(&other->lock) ) {
+            continue;
+        }
+
+        // The entry changes shard, its readers see the sequence change
+        if ( other->itemCount > other->maxItems && (entry = evictSGCacheEntry(other, 0, 0)) != NULL ) {
+            other->itemCount--;
+        }
+        pthread_mutex_unlock(&other->lock);
+    }
+
+    return( entry );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : writebackSGCacheEntry
+// Description  : Write a dirty entry to its node and mark it clean
+//
+// Inputs       : shard - the shard of the entry
+//                entry - the dirty entry
+// Outputs      : 0 if successful, -1 if failure
+
+int writebackSGCacheEntry( CacheShard *shard, Cache *entry ) {
+
+    if ( cacheWriteback == NULL ||
+         cacheWriteback(entry->cacheRemNoteId, entry->cacheBlockId, entry->Data) ) {
+        logMessage(LOG_ERROR_LEVEL, "Cache failed writing back block [%lu] on node [%lu].",
+                                            entry->cacheBlockId, entry->cacheRemNoteId);
+        return( -1 );
+    }
+
+    entry->dirty = 0;
+    shard->dirtyCount--;
+    shard->writebackCount++;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : storeSGCacheEntry
+// Description  : Insert or update a block, evicting to make room (called
+//                with the shard lock held)
+//
+// Inputs       : nde - node ID of the block
+//                blk - block ID of the block
+//                block - the block data
+// Outputs      : 0 if successful, -1 if failure
+
+int storeSGCacheEntry( SG_Node_ID nde, SG_Block_ID blk, char *block ) {
+
+    uint64_t hash = hashSGCacheKey(nde, blk);
+    CacheShard *shard = findSGCacheShard(hash);
+
+    // If nde and blk match, update
+    Cache *entry = findSGCacheEntry(shard, nde, blk);
+    if ( entry != NULL ) {
+        if ( entry->Data != block ) {
+            beginSGCacheChange(shard);
+            memcpy(entry->Data, block, SG_BLOCK_SIZE);
+            endSGCacheChange(shard);
+        }
+        touchSGCacheEntry(shard, entry);
+        return( 0 );
+    }
+
+    if ( cachePolicy->miss != NULL ) {
+        cachePolicy->miss(shard->policyState, nde, blk);
+    }
+
+    // Below its share, or borrowing the capacity other shards leave unused,
+    // so a skewed hash does not evict while the cache has room
+    if ( shard->itemCount < shard->maxItems ||
+         __atomic_load_n(&cacheItemCount, __ATOMIC_RELAXED) < cacheItemLimit ) {
+
+        // A full cache takes back what other shards borrowed
+        if ( __atomic_load_n(&cacheItemCount, __ATOMIC_RELAXED) < cacheItemLimit ||
+             (entry = reclaimSGCacheEntry(shard)) == NULL ) {
+            if ( (entry = allocSGCacheEntry(shard)) == NULL ) {
+                return( -1 );
+            }
+            __atomic_fetch_add(&cacheItemCount, 1, __ATOMIC_RELAXED);
+        }
+        shard->itemCount++;
+
+    } else {    // Reach maximum line, the policy picks the victim
+
+        if ( (entry = evictSGCacheEntry(shard, nde, blk)) == NULL ) {
+            return( -1 );
+        }
+    }
+
+    // A copy held compressed is older than the block
+    dropSGCacheTier(shard, findSGCacheTier(shard, nde, blk));
+
+    // Fill in the entry and link it into the table and the policy
+    uint64_t bucket = hash & shard->bucketMask;
+    beginSGCacheChange(shard);
+    __atomic_store_n(&entry->cacheRemNoteId, nde, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->cacheBlockId, blk, __ATOMIC_RELAXED);
+    entry->dirty = 0;
+    memcpy(entry->Data, block, SG_BLOCK_SIZE);
+    __atomic_store_n(&entry->hashNext, shard->buckets[bucket], __ATOMIC_RELAXED);
+    __atomic_store_n(&shard->buckets[bucket], entry, __ATOMIC_RELAXED);
+    endSGCacheChange(shard);
+    cachePolicy->insert(shard->policyState, entry);
+    __atomic_store_n(&shard->touchClock, shard->touchClock + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->touchStamp, shard->touchClock, __ATOMIC_RELAXED);
+    shard->insertCount++;
+
+    // Return successfully
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : rehashSGCache
+// Description  : Size the hash table of a shard for a capacity, moving
+//                resident entries (no reader may be walking it)
+//
+// Inputs       : shard - the shard
+//                maxElements - the capacity to size for
+// Outputs      : 0 if successful, -1 if failure
+
+int rehashSGCache( CacheShard *shard, uint32_t maxElements ) {
+
+    Cache **buckets, *entry, *next;
+    uint64_t count = 1;
+
+    // Keep the load factor at or below one entry per bucket
+    while ( count < maxElements ) {
+        count <<= 1;
+    }
+    if ( shard->buckets != NULL && count == shard->bucketMask + 1 ) {
+        return( 0 );
+    }
+    if ( (buckets = (Cache**) calloc(count, sizeof(Cache*))) == NULL ) {
+        return( -1 );
+    }
+
+    for ( uint64_t i = 0; shard->buckets != NULL && i <= shard->bucketMask; i++ ) {
+        for ( entry = shard->buckets[i]; entry != NULL; entry = next ) {
+            next = entry->hashNext;
+            uint64_t bucket = hashSGCacheKey(entry->cacheRemNoteId, entry->cacheBlockId) & (count - 1);
+            entry->hashNext = buckets[bucket];
+            buckets[bucket] = entry;
+        }
+    }
+
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->bucketMask = count - 1;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : resizeSGCacheShard
+// Description  : Change the capacity of a shard, evicting in policy order
+//                and freeing the memory (all locks held, readers quiesced)
+//
+// Inputs       : shard - the shard
+//                maxElements - the new capacity of the shard
+// Outputs      : 0 if successful, -1 if failure
+
+int resizeSGCacheShard( CacheShard *shard, uint32_t maxElements ) {
+
+    Cache *entry;
+
+    // Let the policy adjust its targets and history first
+    if ( cachePolicy->resize != NULL && cachePolicy->resize(shard->policyState, maxElements) ) {
+        return( -1 );
+    }
+
+    while ( shard->itemCount > maxElements ) {
+        if ( (entry = evictSGCacheEntry(shard, 0, 0)) == NULL ) {
+
+            // The policy goes back to the capacity the shard keeps
+            if ( cachePolicy->resize != NULL ) {
+                cachePolicy->resize(shard->policyState, shard->maxItems);
+            }
+            return( -1 );
+        }
+        free(entry);
+        shard->itemCount--;
+        __atomic_fetch_sub(&cacheItemCount, 1, __ATOMIC_RELAXED);
+    }
+
+    // Drop the spare entries too, the memory goes back right away
+    while ( shard->freeEntries != NULL ) {
+        entry = shard->freeEntries;
+        shard->freeEntries = entry->hashNext;
+        free(entry);
+    }
+
+    if ( rehashSGCache(shard, maxElements) ) {
+        return( -1 );
+    }
+    shard->maxItems = maxElements;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : getSGCacheShardSize
+// Description  : The blocks a shard holds as they are, its share of the
+//                capacity less the part held compressed
+//
+// Inputs       : index - the shard
+// Outputs      : the capacity of the shard (at least one block)
+
+uint32_t getSGCacheShardSize( uint32_t index ) {
+
+    uint32_t budget = getSGCacheShardBudget(index);
+    uint32_t packed = (uint32_t) ((uint64_t) budget * cacheTierShare / 100);
+    return( (budget > packed) ? budget - packed : 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : getSGCacheShardBudget
+// Description  : Split the capacity of the cache over the shards
+//
+// Inputs       : index - the shard
+// Outputs      : the share of the shard, in blocks
+
+uint32_t getSGCacheShardBudget( uint32_t index ) {
+
+    uint32_t shards = shardMask + 1;
+    return( maxItems / shards + (index < maxItems % shards ? 1 : 0) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : getSGCacheTierSize
+// Description  : The memory a shard holds compressed blocks in, the rest of
+//                its share of the capacity
+//
+// Inputs       : index - the shard
+// Outputs      : the memory, in bytes
+
+uint64_t getSGCacheTierSize( uint32_t index ) {
+
+    uint32_t budget = getSGCacheShardBudget(index), size = getSGCacheShardSize(index);
+    return( (budget > size) ? (uint64_t) (budget - size) * SG_BLOCK_SIZE : 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : splitSGCache
+// Description  : Size every shard and the memory it holds compressed blocks
+//                in, for the capacity and the compressed share (every shard
+//                lock is held and no reader walks the tables)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int splitSGCache( void ) {
+
+    int ret = 0;
+
+    cacheItemLimit = 0;
+    for ( uint32_t i = 0; i <= shardMask; i++ ) {
+        CacheShard *shard = &cacheShards[i];
+        cacheItemLimit += getSGCacheShardSize(i);
+
+        // The tier first, so blocks the shard evicts to shrink are kept
+        shard->tierLimit = getSGCacheTierSize(i);
+        while ( shard->tierBytes > shard->tierLimit ) {
+            dropSGCacheTier(shard, shard->tierTail);
+        }
+        if ( rehashSGCacheTier(shard) || resizeSGCacheShard(shard, getSGCacheShardSize(i)) ) {
+            ret = -1;
+        }
+    }
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : stashSGCacheTier
+// Description  : Keep an evicted (clean) block compressed, dropping the
+//                oldest blocks held compressed to make room.  A block that
+//                compresses poorly is not kept.
+//
+// Inputs       : shard - the shard of the block (its lock is held)
+//                entry - the evicted entry, still holding the block
+// Outputs      : none
+
+void stashSGCacheTier( CacheShard *shard, Cache *entry ) {
+
+    char packed[SG_COMPRESS_LIMIT];
+    CacheTier *tier;
+    int len;
+
+    if ( shard->tierLimit == 0 ) {
+        return;
+    }
+
+    if ( (len = sgCompress(entry->Data, SG_BLOCK_SIZE, packed, SG_COMPRESS_LIMIT)) == 0 ||
+         (tier = (CacheTier *) malloc(sizeof(CacheTier) + len)) == NULL ) {
+        shard->tierSkips++;
+        return;
+    }
+    tier->nde = entry->cacheRemNoteId;
+    tier->blk = entry->cacheBlockId;
+    tier->len = len;
+    memcpy(tier->data, packed, len);
+
+    // Hashed for lookups, newest at the head of the list
+    uint64_t bucket = hashSGCacheKey(tier->nde, tier->blk) & shard->tierMask;
+    tier->hashNext = shard->tierBuckets[bucket];
+    shard->tierBuckets[bucket] = tier;
+    tier->prev = NULL;
+    tier->next = shard->tierHead;
+    if ( shard->tierHead != NULL ) {
+        shard->tierHead->prev = tier;
+    } else {
+        shard->tierTail = tier;
+    }
+    shard->tierHead = tier;
+    shard->tierBytes += sizeof(CacheTier) + len;
+    shard->tierCount++;
+    shard->tierStores++;
+
+    while ( shard->tierBytes > shard->tierLimit ) {
+        dropSGCacheTier(shard, shard->tierTail);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : findSGCacheTier
+// Description  : Find a block held compressed
+//
+// Inputs       : shard - the shard of the block (its lock is held)
+//                nde - node ID of the block
+//                blk - block ID of the block
+// Outputs      : the block held compressed, NULL if none
+
+CacheTier *findSGCacheTier( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    CacheTier *tier;
+
+    if ( shard->tierCount == 0 ) {
+        return( NULL );
+    }
+
+    tier = shard->tierBuckets[hashSGCacheKey(nde, blk) & shard->tierMask];
+    while ( tier != NULL && (tier->nde != nde || tier->blk != blk) ) {
+        tier = tier->hashNext;
+    }
+    return( tier );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : dropSGCacheTier
+// Description  : Unlink a block held compressed and free it
+//
+// Inputs       : shard - the shard of the block (its lock is held)
+//                tier - the block held compressed, or NULL for none
+// Outputs      : none
+
+void dropSGCacheTier( CacheShard *shard, CacheTier *tier ) {
+
+    if ( tier == NULL ) {
+        return;
+    }
+
+    CacheTier **prev = &shard->tierBuckets[hashSGCacheKey(tier->nde, tier->blk) & shard->tierMask];
+    while ( *prev != tier ) {
+        prev = &(*prev)->hashNext;
+    }
+    *prev = tier->hashNext;
+
+    if ( tier->prev != NULL ) {
+        tier->prev->next = tier->next;
+    } else {
+        shard->tierHead = tier->next;
+    }
+    if ( tier->next != NULL ) {
+        tier->next->prev = tier->prev;
+    } else {
+        shard->tierTail = tier->prev;
+    }
+
+    shard->tierBytes -= sizeof(CacheTier) + tier->len;
+    shard->tierCount--;
+    free(tier);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : promoteSGCacheTier
+// Description  : Take a block held compressed back among the policy's
+//                blocks, another making room as for any insertion
+//
+// Inputs       : shard - the shard of the block (its lock is held)
+//                nde - node ID of the block
+//                blk - block ID of the block
+// Outputs      : the entry now holding the block, NULL if it is not held
+
+Cache *promoteSGCacheTier( CacheShard *shard, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    SGDataBlock block;
+
+    CacheTier *tier = findSGCacheTier(shard, nde, blk);
+    if ( tier == NULL ) {
+        return( NULL );
+    }
+    if ( sgDecompress(tier->data, tier->len, block, SG_BLOCK_SIZE) != SG_BLOCK_SIZE ) {
+        logMessage(LOG_ERROR_LEVEL, "Cache dropping corrupt compressed block [%lu] on node [%lu].", blk, nde);
+        dropSGCacheTier(shard, tier);
+        return( NULL );
+    }
+
+    // The insertion drops the compressed copy
+    if ( storeSGCacheEntry(nde, blk, block) ) {
+        return( NULL );
+    }
+    shard->tierHits++;
+
+    return( findSGCacheEntry(shard, nde, blk) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : rehashSGCacheTier
+// Description  : Size the tier's hash table for its memory, moving the
+//                blocks it holds
+//
+// Inputs       : shard - the shard (its lock is held)
+// Outputs      : 0 if successful, -1 if failure
+
+int rehashSGCacheTier( CacheShard *shard ) {
+
+    CacheTier **buckets = NULL, *tier;
+    uint64_t count = 1;
+
+    if ( shard->tierLimit > 0 ) {
+        while ( count < shard->tierLimit / SG_CACHE_TIER_SPREAD ) {
+            count <<= 1;
+        }
+        if ( (buckets = (CacheTier **) calloc(count, sizeof(CacheTier *))) == NULL ) {
+            return( -1 );
+        }
+        for ( tier = shard->tierHead; tier != NULL; tier = tier->next ) {
+            uint64_t bucket = hashSGCacheKey(tier->nde, tier->blk) & (count - 1);
+            tier->hashNext = buckets[bucket];
+            buckets[bucket] = tier;
+        }
+    }
+
+    free(shard->tierBuckets);
+    shard->tierBuckets = buckets;
+    shard->tierMask = count - 1;
 
-    // Return successfully
     return( 0 );
 }
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : beginSGCacheChange
+// Description  : Start changing the table or a block of a shard, lock-free
+//                readers that overlap retry
+//
+// Inputs       : shard - the shard (its lock is held)
+// Outputs      : none
+
+void beginSGCacheChange( CacheShard *shard ) {
+
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : endSGCacheChange
+// Description  : Finish changing a shard
+//
+// Inputs       : shard - the shard (its lock is held)
+// Outputs      : none
+
+void endSGCacheChange( CacheShard *shard ) {
+
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : readSGCacheOptimistic
+// Description  : Look up a block and copy a range of it without the shard
+//                lock.  The result only counts if the shard's sequence did
+//                not change meanwhile; entries are never freed while a
+//                reader is active, so a stale walk is harmless.
+//
+// Inputs       : shard - the shard of the block
+//                hash - the hash of the block
+//                nde - node ID to find
+//                blk - block ID to find
+//                buf - place to put the range (NULL to only look)
+//                start - the start of the range in the block
+//                len - the length of the range
+//                found - set to the entry on a hit
+//                stamp - set to its touch stamp on a hit (the entry may be
+//                        freed once the reader is no longer active)
+// Outputs      : 0 if found, -1 if not cached, 1 if it must be locked
+
+int readSGCacheOptimistic( CacheShard *shard, uint64_t hash, SG_Node_ID nde, SG_Block_ID blk,
+                           char *buf, uint32_t start, uint32_t len, Cache **found, uint32_t *stamp ) {
+
+    int slot = claimSGCacheReader();
+    int ret = 1;
+
+    if ( slot < 0 ) {
+        return( 1 );
+    }
+
+    // Announce the reader before looking at the flag, resize and close
+    // set the flag before looking at the readers
+    CacheReader *reader = &cacheReaders[slot];
+    __atomic_store_n(&reader->active, 1, __ATOMIC_SEQ_CST);
+    if ( __atomic_load_n(&cacheQuiescing, __ATOMIC_SEQ_CST) ) {
+        __atomic_store_n(&reader->active, 0, __ATOMIC_RELEASE);
+        return( 1 );
+    }
+
+    for ( int tries = 0; tries < SG_CACHE_READ_TRIES && ret == 1; tries++ ) {
+
+        uint32_t seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+        if ( seq & 1 ) {
+            sched_yield();
+            continue;
+        }
+
+        // Walk the chain, a bounded number of steps (a changing chain may
+        // lead anywhere in the shard)
+        Cache *entry = __atomic_load_n(&shard->buckets[hash & shard->bucketMask], __ATOMIC_RELAXED);
+        int steps = 0;
+        while ( entry != NULL && steps++ < SG_CACHE_CHAIN_LIMIT ) {
+            if ( __atomic_load_n(&entry->cacheRemNoteId, __ATOMIC_RELAXED) == nde &&
+                 __atomic_load_n(&entry->cacheBlockId, __ATOMIC_RELAXED) == blk ) {
+                break;
+            }
+            entry = __atomic_load_n(&entry->hashNext, __ATOMIC_RELAXED);
+        }
+        if ( entry != NULL && steps > SG_CACHE_CHAIN_LIMIT ) {
+            continue;
+        }
+        if ( entry != NULL && buf != NULL ) {
+            memcpy(buf, &entry->Data[start], len);
+        }
+        uint32_t touched = (entry != NULL) ? __atomic_load_n(&entry->touchStamp, __ATOMIC_RELAXED) : 0;
+
+        // Nothing changed while reading, the result stands
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ( __atomic_load_n(&shard->seq, __ATOMIC_RELAXED) == seq ) {
+            *found = entry;
+            *stamp = touched;
+            ret = (entry != NULL) ? 0 : -1;
+        }
+    }
+
+    __atomic_store_n(&reader->active, 0, __ATOMIC_RELEASE);
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : recordSGCacheRead
+// Description  : Remember a lock-free hit for the policy, replaying the
+//                recorded hits when the buffer is full.  Hits on blocks the
+//                policy saw recently are dropped.
+//
+// Inputs       : shard - the shard of the entry
+//                entry - the entry hit (only kept, it may have been freed)
+//                stamp - its touch stamp, read during the lookup
+//                nde - its node ID
+//                blk - its block ID
+// Outputs      : none
+
+void recordSGCacheRead( CacheShard *shard, Cache *entry, uint32_t stamp, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    // A block touched recently is near the front already, moving it again
+    // is not worth a lock (the stamps may be stale, this is only a hint)
+    uint32_t age = __atomic_load_n(&shard->touchClock, __ATOMIC_RELAXED) - stamp;
+    if ( age < shard->maxItems / SG_CACHE_RECENT_SHARE ) {
+        return;
+    }
+
+    if ( cacheReadCount > 0 && cacheReadGeneration != cacheGeneration ) {
+        cacheReadCount = 0;
+    }
+    if ( cacheReadCount == 0 ) {
+        cacheReadGeneration = cacheGeneration;
+    }
+
+    cacheReads[cacheReadCount].entry = entry;
+    cacheReads[cacheReadCount].shard = shard;
+    cacheReads[cacheReadCount].nde = nde;
+    cacheReads[cacheReadCount].blk = blk;
+    if ( ++cacheReadCount == SG_CACHE_READ_BUFFER ) {
+        drainSGCacheReads();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : drainSGCacheReads
+// Description  : Add this thread's counts to the totals and replay its hits
+//                to the policy, one lock per shard.  A shard that is busy
+//                is skipped (its hits are lost, as a sampled policy would).
+//
+// Inputs       : none
+// Outputs      : none
+
+void drainSGCacheReads( void ) {
+
+    uint64_t done = 0;
+
+    if ( cacheReadGets > 0 ) {
+        __atomic_fetch_add(&getCount, cacheReadGets, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&hitCount, cacheReadHits, __ATOMIC_RELAXED);
+        cacheReadGets = cacheReadHits = 0;
+    }
+
+    // Hits from before a resize or a close may name freed entries and
+    // shards, drop them before touching any shard
+    if ( cacheReadCount > 0 && cacheReadGeneration != __atomic_load_n(&cacheGeneration, __ATOMIC_ACQUIRE) ) {
+        cacheReadCount = 0;
+    }
+
+    for ( int i = 0; i < cacheReadCount && cacheShards != NULL; i++ ) {
+
+        if ( done & (1ULL << i) ) {
+            continue;
+        }
+
+        // Replay every hit of the same shard, in order, under one lock
+        CacheShard *shard = cacheReads[i].shard;
+        int locked = (pthread_mutex_trylock(&shard->lock) == 0);
+
+        // A resize changes the generation with every shard locked
+        if ( locked && cacheReadGeneration != cacheGeneration ) {
+            pthread_mutex_unlock(&shard->lock);
+            break;
+        }
+        for ( int j = i; j < cacheReadCount; j++ ) {
+            CacheRead *read = &cacheReads[j];
+            if ( (done & (1ULL << j)) || read->shard != shard ) {
+                continue;
+            }
+            done |= 1ULL << j;
+
+            // The entry may hold another block by now
+            if ( locked && read->entry->cacheRemNoteId == read->nde && read->entry->cacheBlockId == read->blk ) {
+                touchSGCacheEntry(shard, read->entry);
+            }
+        }
+        if ( locked ) {
+            pthread_mutex_unlock(&shard->lock);
+        }
+    }
+
+    cacheReadCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : claimSGCacheReader
+// Description  : Get this thread's reader slot, taking a free one the first
+//                time (given back when the thread exits)
+//
+// Inputs       : none
+// Outputs      : the slot, -1 if none is free
+
+int claimSGCacheReader( void ) {
+
+    if ( cacheReaderSlot >= 0 ) {
+        return( cacheReaderSlot );
+    }
+    if ( cacheReaderSlot == -2 ) {
+        return( -1 );
+    }
+
+    pthread_once(&cacheReaderOnce, initSGCacheReaders);
+    for ( int i = 0; i < SG_CACHE_MAX_READERS; i++ ) {
+        int expected = 0;
+        if ( __atomic_compare_exchange_n(&cacheReaders[i].taken, &expected, 1, 0,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) ) {
+            cacheReaderSlot = i;
+            pthread_setspecific(cacheReaderKey, &cacheReaders[i]);
+            return( i );
+        }
+    }
+
+    // More threads than slots, this one always locks
+    cacheReaderSlot = -2;
+    return( -1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : initSGCacheReaders
+// Description  : Create the key that gives reader slots back
+//
+// Inputs       : none
+// Outputs      : none
+
+void initSGCacheReaders( void ) {
+
+    pthread_key_create(&cacheReaderKey, releaseSGCacheReader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : releaseSGCacheReader
+// Description  : Give an exiting thread's reader slot back, keeping its
+//                counts
+//
+// Inputs       : slot - the CacheReader of the thread
+// Outputs      : none
+
+void releaseSGCacheReader( void *slot ) {
+
+    __atomic_fetch_add(&getCount, cacheReadGets, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hitCount, cacheReadHits, __ATOMIC_RELAXED);
+    cacheReadGets = cacheReadHits = 0;
+    cacheReadCount = 0;
+
+    __atomic_store_n(&((CacheReader *) slot)->taken, 0, __ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : quiesceSGCacheReaders
+// Description  : Send new readers to the locks and wait for the lock-free
+//                readers in progress, entries can be freed after this
+//                (cacheQuiescing is cleared by the caller when done)
+//
+// Inputs       : none
+// Outputs      : none
+
+void quiesceSGCacheReaders( void ) {
+
+    __atomic_store_n(&cacheQuiescing, 1, __ATOMIC_SEQ_CST);
+    for ( int i = 0; i < SG_CACHE_MAX_READERS; i++ ) {
+        while ( __atomic_load_n(&cacheReaders[i].active, __ATOMIC_SEQ_CST) ) {
+            sched_yield();
+        }
+    }
+}
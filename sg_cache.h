@@ -17,18 +17,125 @@
 //
 // Defines
 #define SG_MAX_CACHE_ELEMENTS 128
+#define SG_CACHE_POLICY_ENV "SG_CACHE_POLICY" // Environment policy selector
+#define SG_CACHE_SIZE_ENV "SG_CACHE_SIZE"     // Environment cache size
+#define SG_CACHE_WRITEBACK_ENV "SG_CACHE_WRITEBACK" // Environment write-back mode
+#define SG_CACHE_SHARDS_ENV "SG_CACHE_SHARDS" // Environment number of shards
+#define SG_CACHE_COMPRESSED_ENV "SG_CACHE_COMPRESSED" // Environment share held compressed (%)
+#define SG_CACHE_MAX_COMPRESSED 90            // Most of the cache held compressed (%)
+#define SG_CACHE_MAX_SHARDS 64                // Most shards a cache can have
+
+//
+// Type definitions
+
+// Replacement policies
+typedef enum {
+    SG_CACHE_LRU        = 0, // Least recently used
+    SG_CACHE_CLOCK      = 1, // Second chance (reference bit)
+    SG_CACHE_2Q         = 2, // Two queue (FIFO probation, LRU main, ghost)
+    SG_CACHE_ARC        = 3, // Adaptive replacement cache
+    SG_CACHE_LFU        = 4, // Least frequently used (LRU among equals)
+    SG_CACHE_MAX_POLICY = 5  // Maximum value of the policy
+} SGCachePolicy;
+
+// Cache counters, kept for the active policy
+typedef struct {
+    const char *policy;  // The policy name
+    uint32_t capacity;   // Maximum number of blocks
+    uint32_t shards;     // Independently locked parts of the cache
+    uint32_t items;      // Blocks currently cached
+    uint64_t queries;    // Calls to getSGDataBlock/readSGDataBlock
+    uint64_t hits;       // Queries that found the block
+    uint64_t misses;     // Queries that did not
+    uint64_t inserts;    // Blocks added to the cache
+    uint64_t evictions;  // Blocks removed to make room
+    uint64_t ghostHits;  // Misses on recently evicted blocks (2Q, ARC)
+    uint32_t dirty;      // Modified blocks not yet written back
+    uint64_t writebacks; // Dirty blocks written back
+    uint64_t lockedReads; // Reads that fell back to the shard lock
+    uint32_t compressed; // Evicted blocks held compressed
+    uint64_t compressedHits; // Hits on blocks held compressed
+} SGCacheStats;
+
+// A cached block held in place by pinSGDataBlock
+typedef struct {
+    char *data;  // The block (SG_BLOCK_SIZE bytes), valid until unpinned
+    void *entry; // The cache entry holding it
+} SGBlockRef;
+
+// Writes a dirty block back to its node, 0 if successful (it must not call
+// back into the cache, it runs with a shard lock held)
+typedef int (*SGCacheWriteback)( SG_Node_ID nde, SG_Block_ID blk, char *block );
 
 // 
 // Cache functions
 
-int initSGCache( uint16_t maxElements );
-    // Initialize the cache of block elements
+int initSGCache( uint32_t maxElements );
+    // Initialize the cache of block elements (policy from SG_CACHE_POLICY)
+
+int initSGCacheWithPolicy( uint32_t maxElements, SGCachePolicy policy );
+    // Initialize the cache of block elements with a replacement policy
+
+int initSGCacheWithShards( uint32_t maxElements, SGCachePolicy policy, uint32_t shards );
+    // Initialize the cache split into shards (0 to size them by capacity)
+
+int resizeSGCache( uint32_t maxElements );
+    // Change the capacity of the cache, evicting in policy order to shrink
+
+int setSGCacheCompression( uint32_t percent );
+    // Hold evicted blocks compressed in a share of the cache's memory (0 for
+    // none, at most SG_CACHE_MAX_COMPRESSED), the rest holding them as they are
+
+uint32_t parseSGCacheSize( const char *spec );
+    // Convert a size ("4096" blocks, or bytes with a K/M/G suffix) to blocks
+
+int setSGCacheWriteback( SGCacheWriteback writeback );
+    // Set the function that writes dirty blocks back to their node
+
+int dirtySGDataBlock( SG_Node_ID nde, SG_Block_ID blk );
+    // Mark a cached block as modified (written back on eviction or flush)
+
+int flushSGDataBlock( SG_Node_ID nde, SG_Block_ID blk );
+    // Write a block back if it is cached and dirty
+
+int cleanSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, char *buf );
+    // Copy out a cached dirty block and mark it clean, for a caller writing
+    // it back itself (-1 if there is nothing to write back)
+
+int flushSGCache( void );
+    // Write back every dirty block
+
+int getSGCachePolicyByName( const char *name );
+    // Look up a policy by name (case insensitive), -1 if unknown
+
+int getSGCacheStats( SGCacheStats *stats );
+    // Get the counters of the cache
 
 int closeSGCache( void );
     // Close the cache of block elements, clean up remaining data
 
 char *getSGDataBlock( SG_Node_ID nde, SG_Block_ID blk );
-    // Get the data block from the block cache
+    // Get the data block from the block cache (good until the next call)
+
+int readSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, char *buf, uint32_t start, uint32_t len );
+    // Copy a range of a cached block, -1 if not cached (safe across threads)
+
+int probeSGDataBlock( SG_Node_ID nde, SG_Block_ID blk );
+    // Check a block is cached, -1 if not (not counted as a lookup)
+
+int demoteSGDataBlock( SG_Node_ID nde, SG_Block_ID blk );
+    // Make a cached block the next one the policy evicts, -1 if not cached
+
+int dropSGDataBlock( SG_Node_ID nde, SG_Block_ID blk );
+    // Remove a block from the cache, written back first if dirty (-1 if it
+    // is pinned or cannot be written back)
+
+int pinSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, SGBlockRef *ref );
+    // Reference a cached block without copying it, -1 if not cached (it is
+    // not evicted until every reference is released)
+
+void unpinSGDataBlock( SGBlockRef *ref );
+    // Release a reference taken by pinSGDataBlock
 
 int putSGDataBlock( SG_Node_ID nde, SG_Block_ID blk, char *block );
     // Get the data block from the block cache
@@ -0,0 +1,970 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_cache_policy.c
+//  Description    : This file contains the replacement policies of the block
+//                   cache (LRU, CLOCK, 2Q, ARC and LFU).  Every operation is
+//                   constant time; 2Q and ARC keep their ghost history in
+//                   data-less cache entries with a hash table of their own.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+
+// Project Includes
+#include <sg_cache_policy.h>
+
+// Defines
+#define SG_QUEUE_NONE 0
+#define SG_QUEUE_A1IN 1  // 2Q probation FIFO
+#define SG_QUEUE_AM   2  // 2Q main LRU
+#define SG_QUEUE_A1OUT 3 // 2Q ghost FIFO
+#define SG_QUEUE_T1   4  // ARC recency list
+#define SG_QUEUE_T2   5  // ARC frequency list
+#define SG_QUEUE_B1   6  // ARC recency ghosts
+#define SG_QUEUE_B2   7  // ARC frequency ghosts
+
+// Ghost history, data-less entries hashed by node/block
+typedef struct {
+    Cache **buckets;
+    Cache *free;      // Dropped ghosts kept for reuse
+    uint64_t mask;
+    uint32_t count;   // Ghosts currently remembered
+    uint32_t limit;   // Maximum number of ghosts
+} GhostTable;
+
+// LRU state
+typedef struct {
+    CacheList list;
+} LruState;
+
+// CLOCK state, entries form a ring through lruPrev/lruNext
+typedef struct {
+    Cache *hand;
+    uint32_t size; // Entries in the ring
+} ClockState;
+
+// 2Q state
+typedef struct {
+    CacheList a1in;
+    CacheList am;
+    CacheList a1out;
+    uint32_t kin;     // Target size of A1in
+    uint32_t kout;    // Maximum size of A1out
+    int promote;      // The pending insert was found in A1out
+    GhostTable ghosts;
+} TwoQState;
+
+// ARC state
+typedef struct {
+    CacheList t1;
+    CacheList t2;
+    CacheList b1;
+    CacheList b2;
+    uint32_t c;       // Capacity
+    uint32_t p;       // Target size of T1
+    int target;       // List for the pending insert
+    int inB2;         // The pending insert was found in B2
+    int dropT1;       // Case IV(A) with an empty B1, evict T1 without history
+    GhostTable ghosts;
+} ArcState;
+
+// LFU frequency node, holds all entries with the same count
+typedef struct lfu_node {
+    uint64_t count;
+    struct lfu_node *prev;
+    struct lfu_node *next;
+    CacheList entries;
+} LfuNode;
+
+// LFU state
+typedef struct {
+    LfuNode *head;    // Lowest frequency
+    LfuNode *free;    // Released nodes kept for reuse
+} LfuState;
+
+int ghostHitCount = 0; // Misses found in the ghost history
+
+// Functional Prototypes
+int initGhostTable( GhostTable *table, uint32_t limit ); // Allocate ghosts
+void closeGhostTable( GhostTable *table ); // Free the ghosts
+int resizeGhostTable( GhostTable *table, uint32_t limit ); // Change the limit
+Cache *findGhost( GhostTable *table, SG_Node_ID nde, SG_Block_ID blk ); // Lookup
+int addGhost( GhostTable *table, CacheList *list, uint8_t queue, Cache *entry ); // Remember an eviction
+void dropGhost( GhostTable *table, CacheList *list, Cache *ghost ); // Forget a ghost
+
+//
+// Functions
+
+//
+// List support
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : pushCacheList
+// Description  : Insert an entry at the head of a list
+//
+// Inputs       : list - the list
+//                entry - the entry to insert
+// Outputs      : none
+
+void pushCacheList( CacheList *list, Cache *entry ) {
+
+    entry->lruPrev = NULL;
+    entry->lruNext = list->head;
+    if ( list->head != NULL ) {
+        list->head->lruPrev = entry;
+    } else {
+        list->tail = entry;
+    }
+    list->head = entry;
+    list->size++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : appendCacheList
+// Description  : Insert an entry at the tail of a list
+//
+// Inputs       : list - the list
+//                entry - the entry to insert
+// Outputs      : none
+
+void appendCacheList( CacheList *list, Cache *entry ) {
+
+    entry->lruNext = NULL;
+    entry->lruPrev = list->tail;
+    if ( list->tail != NULL ) {
+        list->tail->lruNext = entry;
+    } else {
+        list->head = entry;
+    }
+    list->tail = entry;
+    list->size++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : unlinkCacheList
+// Description  : Remove an entry from a list
+//
+// Inputs       : list - the list
+//                entry - the entry to remove
+// Outputs      : none
+
+void unlinkCacheList( CacheList *list, Cache *entry ) {
+
+    if ( entry->lruPrev != NULL ) {
+        entry->lruPrev->lruNext = entry->lruNext;
+    } else {
+        list->head = entry->lruNext;
+    }
+
+    if ( entry->lruNext != NULL ) {
+        entry->lruNext->lruPrev = entry->lruPrev;
+    } else {
+        list->tail = entry->lruPrev;
+    }
+
+    entry->lruPrev = entry->lruNext = NULL;
+    list->size--;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : findUnpinnedCacheList
+// Description  : Find the entry nearest the tail of a list that is not
+//                pinned, the one a policy evicts from that list
+//
+// Inputs       : list - the list
+// Outputs      : the entry or NULL if every entry is pinned (or none)
+
+Cache *findUnpinnedCacheList( CacheList *list ) {
+
+    Cache *entry = list->tail;
+    while ( entry != NULL && entry->pins > 0 ) {
+        entry = entry->lruPrev;
+    }
+
+    return( entry );
+}
+
+//
+// Ghost history support
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : initGhostTable
+// Description  : Allocate a ghost table, ghosts are allocated as needed
+//
+// Inputs       : table - the table to initialize
+//                limit - the maximum number of ghosts
+// Outputs      : 0 if successful, -1 if failure
+
+int initGhostTable( GhostTable *table, uint32_t limit ) {
+
+    uint64_t buckets = 1;
+    while ( buckets < limit ) {
+        buckets <<= 1;
+    }
+
+    table->buckets = (Cache**) calloc(buckets, sizeof(Cache*));
+    if ( table->buckets == NULL ) {
+        return( -1 );
+    }
+
+    table->free = NULL;
+    table->mask = buckets - 1;
+    table->count = 0;
+    table->limit = limit;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : closeGhostTable
+// Description  : Free a ghost table
+//
+// Inputs       : table - the table to free
+// Outputs      : none
+
+void closeGhostTable( GhostTable *table ) {
+
+    Cache *ghost, *next;
+
+    for ( uint64_t i = 0; table->buckets != NULL && i <= table->mask; i++ ) {
+        for ( ghost = table->buckets[i]; ghost != NULL; ghost = next ) {
+            next = ghost->hashNext;
+            free(ghost);
+        }
+    }
+    for ( ghost = table->free; ghost != NULL; ghost = next ) {
+        next = ghost->hashNext;
+        free(ghost);
+    }
+
+    free(table->buckets);
+    table->buckets = NULL;
+    table->free = NULL;
+    table->count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : resizeGhostTable
+// Description  : Change the ghost limit and rehash, callers drop any ghosts
+//                over the new limit first
+//
+// Inputs       : table - the ghost table
+//                limit - the new maximum number of ghosts
+// Outputs      : 0 if successful, -1 if failure
+
+int resizeGhostTable( GhostTable *table, uint32_t limit ) {
+
+    Cache **buckets, *ghost, *next;
+    uint64_t count = 1, i;
+
+    while ( count < limit ) {
+        count <<= 1;
+    }
+    if ( (buckets = (Cache**) calloc(count, sizeof(Cache*))) == NULL ) {
+        return( -1 );
+    }
+
+    for ( i = 0; i <= table->mask; i++ ) {
+        for ( ghost = table->buckets[i]; ghost != NULL; ghost = next ) {
+            next = ghost->hashNext;
+            uint64_t bucket = hashSGCacheKey(ghost->cacheRemNoteId, ghost->cacheBlockId) & (count - 1);
+            ghost->hashNext = buckets[bucket];
+            buckets[bucket] = ghost;
+        }
+    }
+
+    // Give back the memory of ghosts that were dropped
+    for ( ghost = table->free; ghost != NULL; ghost = next ) {
+        next = ghost->hashNext;
+        free(ghost);
+    }
+
+    free(table->buckets);
+    table->buckets = buckets;
+    table->free = NULL;
+    table->mask = count - 1;
+    table->limit = limit;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : findGhost
+// Description  : Look up the ghost of a node/block pair
+//
+// Inputs       : table - the ghost table
+//                nde - node ID to find
+//                blk - block ID to find
+// Outputs      : the ghost or NULL if not remembered
+
+Cache *findGhost( GhostTable *table, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    Cache *ghost = table->buckets[hashSGCacheKey(nde, blk) & table->mask];
+    while ( ghost != NULL ) {
+        if ( ghost->cacheRemNoteId == nde && ghost->cacheBlockId == blk ) {
+            return( ghost );
+        }
+        ghost = ghost->hashNext;
+    }
+
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : addGhost
+// Description  : Remember an evicted entry at the head of a ghost list
+//
+// Inputs       : table - the ghost table
+//                list - the ghost list
+//                queue - the queue tag of the ghost list
+//                entry - the entry being evicted
+// Outputs      : 0 if successful, -1 if the table is full
+
+int addGhost( GhostTable *table, CacheList *list, uint8_t queue, Cache *entry ) {
+
+    Cache *ghost = table->free;
+    if ( table->count >= table->limit ) {
+        return( -1 );
+    }
+    if ( ghost != NULL ) {
+        table->free = ghost->hashNext;
+    } else if ( (ghost = (Cache*) calloc(1, sizeof(Cache))) == NULL ) {
+        return( -1 );
+    }
+    table->count++;
+
+    uint64_t bucket = hashSGCacheKey(entry->cacheRemNoteId, entry->cacheBlockId) & table->mask;
+    ghost->cacheRemNoteId = entry->cacheRemNoteId;
+    ghost->cacheBlockId = entry->cacheBlockId;
+    ghost->queue = queue;
+    ghost->hashNext = table->buckets[bucket];
+    table->buckets[bucket] = ghost;
+    pushCacheList(list, ghost);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : dropGhost
+// Description  : Forget a ghost, returning it to the free pool
+//
+// Inputs       : table - the ghost table
+//                list - the ghost list holding it
+//                ghost - the ghost to drop
+// Outputs      : none
+
+void dropGhost( GhostTable *table, CacheList *list, Cache *ghost ) {
+
+    Cache **link = &table->buckets[hashSGCacheKey(ghost->cacheRemNoteId, ghost->cacheBlockId) & table->mask];
+    while ( *link != NULL ) {
+        if ( *link == ghost ) {
+            *link = ghost->hashNext;
+            break;
+        }
+        link = &(*link)->hashNext;
+    }
+
+    unlinkCacheList(list, ghost);
+    ghost->queue = SG_QUEUE_NONE;
+    ghost->hashNext = table->free;
+    table->free = ghost;
+    table->count--;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Policy       : LRU
+// Description  : Least recently used, a single list ordered by recency.
+//                Hits move the entry to the head, the tail is evicted.
+
+void *lruCreate( uint32_t capacity ) {
+    return( calloc(1, sizeof(LruState)) );
+}
+
+void lruDestroy( void *state ) {
+    free(state);
+}
+
+Cache *lruEvict( void *state, SG_Node_ID nde, SG_Block_ID blk ) {
+    LruState *lru = state;
+    Cache *victim = findUnpinnedCacheList(&lru->list);
+    if ( victim != NULL ) {
+        unlinkCacheList(&lru->list, victim);
+    }
+    return( victim );
+}
+
+void lruInsert( void *state, Cache *entry ) {
+    pushCacheList(&((LruState*) state)->list, entry);
+}
+
+void lruTouch( void *state, Cache *entry ) {
+    LruState *lru = state;
+    unlinkCacheList(&lru->list, entry);
+    pushCacheList(&lru->list, entry);
+}
+
+void lruRemove( void *state, Cache *entry ) {
+    unlinkCacheList(&((LruState*) state)->list, entry);
+}
+
+void lruDemote( void *state, Cache *entry ) {
+    LruState *lru = state;
+    unlinkCacheList(&lru->list, entry);
+    appendCacheList(&lru->list, entry);
+}
+
+const SGCachePolicyOps lruPolicy = {
+    "LRU", lruCreate, lruDestroy, NULL, NULL, lruEvict, lruInsert, lruTouch, lruRemove, lruDemote
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Policy       : CLOCK
+// Description  : Second chance.  Entries form a ring and a hit only sets the
+//                reference bit; the hand clears set bits until it finds a victim.
+
+void *clockCreate( uint32_t capacity ) {
+    return( calloc(1, sizeof(ClockState)) );
+}
+
+void clockDestroy( void *state ) {
+    free(state);
+}
+
+void clockRemove( void *state, Cache *entry ) {
+    ClockState *clk = state;
+    clk->size--;
+    if ( entry->lruNext == entry ) {
+        clk->hand = NULL;
+    } else {
+        if ( clk->hand == entry ) {
+            clk->hand = entry->lruNext;
+        }
+        entry->lruPrev->lruNext = entry->lruNext;
+        entry->lruNext->lruPrev = entry->lruPrev;
+    }
+    entry->lruPrev = entry->lruNext = NULL;
+}
+
+Cache *clockEvict( void *state, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    ClockState *clk = state;
+    if ( clk->hand == NULL ) {
+        return( NULL );
+    }
+
+    // Sweep, giving referenced entries a second chance and passing over
+    // pinned ones (after two turns every entry is pinned)
+    uint32_t steps = 0;
+    while ( clk->hand->referenced || clk->hand->pins > 0 ) {
+        if ( ++steps > 2 * clk->size ) {
+            return( NULL );
+        }
+        clk->hand->referenced = 0;
+        clk->hand = clk->hand->lruNext;
+    }
+
+    Cache *victim = clk->hand;
+    clockRemove(state, victim);
+    return( victim );
+}
+
+void clockInsert( void *state, Cache *entry ) {
+
+    // New entries go just behind the hand, a full sweep away from eviction
+    ClockState *clk = state;
+    entry->referenced = 0;
+    clk->size++;
+    if ( clk->hand == NULL ) {
+        entry->lruPrev = entry->lruNext = entry;
+        clk->hand = entry;
+    } else {
+        entry->lruNext = clk->hand;
+        entry->lruPrev = clk->hand->lruPrev;
+        clk->hand->lruPrev->lruNext = entry;
+        clk->hand->lruPrev = entry;
+    }
+}
+
+void clockTouch( void *state, Cache *entry ) {
+    entry->referenced = 1;
+}
+
+void clockDemote( void *state, Cache *entry ) {
+
+    // Under the hand without a reference, the next victim
+    ClockState *clk = state;
+    clockRemove(state, entry);
+    clockInsert(state, entry);
+    clk->hand = entry;
+}
+
+const SGCachePolicyOps clockPolicy = {
+    "CLOCK", clockCreate, clockDestroy, NULL, NULL, clockEvict, clockInsert, clockTouch, clockRemove,
+    clockDemote
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Policy       : 2Q
+// Description  : Two queue (Johnson and Shasha, full version).  New blocks
+//                enter the A1in FIFO, blocks evicted from A1in are remembered
+//                in A1out and go to the Am LRU if they are missed again, so a
+//                scan only flushes A1in.
+
+void twoQDestroy( void *state ) {
+    if ( state != NULL ) {
+        closeGhostTable(&((TwoQState*) state)->ghosts);
+    }
+    free(state);
+}
+
+void *twoQCreate( uint32_t capacity ) {
+
+    TwoQState *tq = calloc(1, sizeof(TwoQState));
+    if ( tq == NULL ) {
+        return( NULL );
+    }
+
+    // The tuning recommended by the paper: Kin = 25%, Kout = 50%
+    tq->kin = capacity / 4 > 0 ? capacity / 4 : 1;
+    tq->kout = capacity / 2 > 0 ? capacity / 2 : 1;
+    if ( initGhostTable(&tq->ghosts, tq->kout) ) {
+        twoQDestroy(tq);
+        return( NULL );
+    }
+
+    return( tq );
+}
+
+int twoQResize( void *state, uint32_t capacity ) {
+
+    TwoQState *tq = state;
+    tq->kin = capacity / 4 > 0 ? capacity / 4 : 1;
+    tq->kout = capacity / 2 > 0 ? capacity / 2 : 1;
+
+    // Forget the oldest history beyond the new A1out size
+    while ( tq->a1out.size > tq->kout ) {
+        dropGhost(&tq->ghosts, &tq->a1out, tq->a1out.tail);
+    }
+    return( resizeGhostTable(&tq->ghosts, tq->kout) );
+}
+
+void twoQMiss( void *state, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    TwoQState *tq = state;
+    Cache *ghost = findGhost(&tq->ghosts, nde, blk);
+
+    // Recently evicted from probation, goes straight to the main queue
+    tq->promote = (ghost != NULL);
+    if ( ghost != NULL ) {
+        dropGhost(&tq->ghosts, &tq->a1out, ghost);
+        __atomic_fetch_add(&ghostHitCount, 1, __ATOMIC_RELAXED);
+    }
+}
+
+Cache *twoQEvict( void *state, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    TwoQState *tq = state;
+    Cache *victim = NULL, *probation = findUnpinnedCacheList(&tq->a1in);
+
+    // Take from the main queue when probation is small (or all pinned)
+    if ( (tq->a1in.size <= tq->kin && tq->am.size > 0) || probation == NULL ) {
+        victim = findUnpinnedCacheList(&tq->am);
+    }
+
+    if ( victim == NULL ) {
+
+        // Evict from probation, remembering the block in A1out
+        if ( (victim = probation) == NULL ) {
+            return( NULL );
+        }
+        unlinkCacheList(&tq->a1in, victim);
+        if ( tq->a1out.size >= tq->kout ) {
+            dropGhost(&tq->ghosts, &tq->a1out, tq->a1out.tail);
+        }
+        addGhost(&tq->ghosts, &tq->a1out, SG_QUEUE_A1OUT, victim);
+
+    } else {
+        unlinkCacheList(&tq->am, victim);
+    }
+
+    victim->queue = SG_QUEUE_NONE;
+    return( victim );
+}
+
+void twoQInsert( void *state, Cache *entry ) {
+
+    TwoQState *tq = state;
+    if ( tq->promote ) {
+        entry->queue = SG_QUEUE_AM;
+        pushCacheList(&tq->am, entry);
+    } else {
+        entry->queue = SG_QUEUE_A1IN;
+        pushCacheList(&tq->a1in, entry);
+    }
+    tq->promote = 0;
+}
+
+void twoQTouch( void *state, Cache *entry ) {
+
+    // Hits in A1in are correlated references, leave them in FIFO order
+    TwoQState *tq = state;
+    if ( entry->queue == SG_QUEUE_AM ) {
+        unlinkCacheList(&tq->am, entry);
+        pushCacheList(&tq->am, entry);
+    }
+}
+
+void twoQRemove( void *state, Cache *entry ) {
+
+    TwoQState *tq = state;
+    unlinkCacheList(entry->queue == SG_QUEUE_AM ? &tq->am : &tq->a1in, entry);
+    entry->queue = SG_QUEUE_NONE;
+}
+
+void twoQDemote( void *state, Cache *entry ) {
+
+    // Back to the end of probation, as for a block of a scan
+    TwoQState *tq = state;
+    twoQRemove(state, entry);
+    entry->queue = SG_QUEUE_A1IN;
+    appendCacheList(&tq->a1in, entry);
+}
+
+const SGCachePolicyOps twoQPolicy = {
+    "2Q", twoQCreate, twoQDestroy, twoQResize, twoQMiss, twoQEvict, twoQInsert, twoQTouch, twoQRemove,
+    twoQDemote
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Policy       : ARC
+// Description  : Adaptive replacement cache (Megiddo and Modha).  T1 holds
+//                blocks seen once, T2 blocks seen again; the ghost lists B1/B2
+//                steer the target size p of T1 between recency and frequency.
+
+void arcDestroy( void *state ) {
+    if ( state != NULL ) {
+        closeGhostTable(&((ArcState*) state)->ghosts);
+    }
+    free(state);
+}
+
+void *arcCreate( uint32_t capacity ) {
+
+    ArcState *arc = calloc(1, sizeof(ArcState));
+    if ( arc == NULL ) {
+        return( NULL );
+    }
+
+    // |B1| + |B2| never exceeds the capacity
+    arc->c = capacity;
+    arc->target = SG_QUEUE_T1;
+    if ( initGhostTable(&arc->ghosts, capacity) ) {
+        arcDestroy(arc);
+        return( NULL );
+    }
+
+    return( arc );
+}
+
+int arcResize( void *state, uint32_t capacity ) {
+
+    ArcState *arc = state;
+    arc->c = capacity;
+    if ( arc->p > capacity ) {
+        arc->p = capacity;
+    }
+
+    // Forget the oldest history of the longer ghost list
+    while ( arc->b1.size + arc->b2.size > capacity ) {
+        if ( arc->b1.size > arc->b2.size ) {
+            dropGhost(&arc->ghosts, &arc->b1, arc->b1.tail);
+        } else {
+            dropGhost(&arc->ghosts, &arc->b2, arc->b2.tail);
+        }
+    }
+    return( resizeGhostTable(&arc->ghosts, capacity) );
+}
+
+void arcMiss( void *state, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    ArcState *arc = state;
+    Cache *ghost = findGhost(&arc->ghosts, nde, blk);
+    uint32_t delta;
+
+    arc->inB2 = 0;
+    arc->dropT1 = 0;
+
+    if ( ghost != NULL && ghost->queue == SG_QUEUE_B1 ) {
+
+        // Case II, recency history hit: grow the T1 target
+        delta = arc->b2.size > arc->b1.size ? arc->b2.size / arc->b1.size : 1;
+        arc->p = (arc->p + delta < arc->c) ? arc->p + delta : arc->c;
+        dropGhost(&arc->ghosts, &arc->b1, ghost);
+        arc->target = SG_QUEUE_T2;
+        __atomic_fetch_add(&ghostHitCount, 1, __ATOMIC_RELAXED);
+
+    } else if ( ghost != NULL ) {
+
+        // Case III, frequency history hit: shrink the T1 target
+        delta = arc->b1.size > arc->b2.size ? arc->b1.size / arc->b2.size : 1;
+        arc->p = (arc->p > delta) ? arc->p - delta : 0;
+        dropGhost(&arc->ghosts, &arc->b2, ghost);
+        arc->target = SG_QUEUE_T2;
+        arc->inB2 = 1;
+        __atomic_fetch_add(&ghostHitCount, 1, __ATOMIC_RELAXED);
+
+    } else {
+
+        // Case IV, a new block: keep the directory within 2c
+        arc->target = SG_QUEUE_T1;
+        if ( arc->t1.size + arc->b1.size >= arc->c ) {
+            if ( arc->t1.size < arc->c ) {
+                dropGhost(&arc->ghosts, &arc->b1, arc->b1.tail);
+            } else {
+                arc->dropT1 = 1;
+            }
+        } else if ( arc->t1.size + arc->t2.size + arc->b1.size + arc->b2.size >= 2 * arc->c &&
+                    arc->b2.tail != NULL ) {
+            dropGhost(&arc->ghosts, &arc->b2, arc->b2.tail);
+        }
+    }
+}
+
+Cache *arcEvict( void *state, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    ArcState *arc = state;
+    Cache *victim;
+    int fromT1;
+
+    // REPLACE(x, p)
+    fromT1 = arc->t1.size > 0 &&
+        (arc->dropT1 || arc->t2.size == 0 || arc->t1.size > arc->p ||
+         (arc->inB2 && arc->t1.size == arc->p));
+    victim = findUnpinnedCacheList(fromT1 ? &arc->t1 : &arc->t2);
+    if ( victim == NULL ) {
+        fromT1 = !fromT1;
+        victim = findUnpinnedCacheList(fromT1 ? &arc->t1 : &arc->t2);
+    }
+    if ( victim == NULL ) {
+        return( NULL );
+    }
+    unlinkCacheList(fromT1 ? &arc->t1 : &arc->t2, victim);
+
+    // Keep the history, making room in the ghost table if an earlier
+    // removal left the lists unbalanced
+    if ( !arc->dropT1 ) {
+        if ( arc->ghosts.count >= arc->ghosts.limit ) {
+            if ( arc->b1.size > arc->b2.size ) {
+                dropGhost(&arc->ghosts, &arc->b1, arc->b1.tail);
+            } else {
+                dropGhost(&arc->ghosts, &arc->b2, arc->b2.tail);
+            }
+        }
+        addGhost(&arc->ghosts, fromT1 ? &arc->b1 : &arc->b2,
+                 fromT1 ? SG_QUEUE_B1 : SG_QUEUE_B2, victim);
+    }
+
+    arc->dropT1 = 0;
+    arc->inB2 = 0;
+    victim->queue = SG_QUEUE_NONE;
+    return( victim );
+}
+
+void arcInsert( void *state, Cache *entry ) {
+
+    ArcState *arc = state;
+    entry->queue = arc->target;
+    pushCacheList(arc->target == SG_QUEUE_T2 ? &arc->t2 : &arc->t1, entry);
+    arc->target = SG_QUEUE_T1;
+}
+
+void arcTouch( void *state, Cache *entry ) {
+
+    // Case I, any hit moves the entry to the head of T2
+    ArcState *arc = state;
+    unlinkCacheList(entry->queue == SG_QUEUE_T2 ? &arc->t2 : &arc->t1, entry);
+    entry->queue = SG_QUEUE_T2;
+    pushCacheList(&arc->t2, entry);
+}
+
+void arcRemove( void *state, Cache *entry ) {
+
+    ArcState *arc = state;
+    unlinkCacheList(entry->queue == SG_QUEUE_T2 ? &arc->t2 : &arc->t1, entry);
+    entry->queue = SG_QUEUE_NONE;
+}
+
+void arcDemote( void *state, Cache *entry ) {
+
+    // To the LRU end of T1, as a block seen only once
+    ArcState *arc = state;
+    arcRemove(state, entry);
+    entry->queue = SG_QUEUE_T1;
+    appendCacheList(&arc->t1, entry);
+}
+
+const SGCachePolicyOps arcPolicy = {
+    "ARC", arcCreate, arcDestroy, arcResize, arcMiss, arcEvict, arcInsert, arcTouch, arcRemove,
+    arcDemote
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Policy       : LFU
+// Description  : Least frequently used, ties broken by recency.  A list of
+//                frequency nodes, each with the list of entries at that count,
+//                keeps every operation constant time.
+
+void *lfuCreate( uint32_t capacity ) {
+    return( calloc(1, sizeof(LfuState)) );
+}
+
+void lfuDestroy( void *state ) {
+
+    LfuState *lfu = state;
+    LfuNode *node, *next;
+
+    for ( node = lfu->head; node != NULL; node = next ) {
+        next = node->next;
+        free(node);
+    }
+    for ( node = lfu->free; node != NULL; node = next ) {
+        next = node->next;
+        free(node);
+    }
+    free(lfu);
+}
+
+LfuNode *lfuNewNode( LfuState *lfu, uint64_t count, LfuNode *after ) {
+
+    // At most one node per distinct count (plus one while an entry moves
+    // up) is ever live, released nodes are recycled
+    LfuNode *node = lfu->free;
+    if ( node != NULL ) {
+        lfu->free = node->next;
+    } else if ( (node = malloc(sizeof(LfuNode))) == NULL ) {
+        return( NULL );
+    }
+    memset(node, 0, sizeof(LfuNode));
+    node->count = count;
+
+    node->prev = after;
+    if ( after != NULL ) {
+        node->next = after->next;
+        after->next = node;
+    } else {
+        node->next = lfu->head;
+        lfu->head = node;
+    }
+    if ( node->next != NULL ) {
+        node->next->prev = node;
+    }
+
+    return( node );
+}
+
+void lfuUnlink( LfuState *lfu, Cache *entry ) {
+
+    LfuNode *node = entry->policyData;
+    unlinkCacheList(&node->entries, entry);
+    entry->policyData = NULL;
+
+    // Release empty frequency nodes
+    if ( node->entries.size == 0 ) {
+        if ( node->prev != NULL ) {
+            node->prev->next = node->next;
+        } else {
+            lfu->head = node->next;
+        }
+        if ( node->next != NULL ) {
+            node->next->prev = node->prev;
+        }
+        node->next = lfu->free;
+        lfu->free = node;
+    }
+}
+
+Cache *lfuEvict( void *state, SG_Node_ID nde, SG_Block_ID blk ) {
+
+    // Least frequent, least recent among equals
+    LfuState *lfu = state;
+    Cache *victim = NULL;
+    for ( LfuNode *node = lfu->head; node != NULL && victim == NULL; node = node->next ) {
+        victim = findUnpinnedCacheList(&node->entries);
+    }
+    if ( victim != NULL ) {
+        lfuUnlink(lfu, victim);
+    }
+    return( victim );
+}
+
+void lfuInsert( void *state, Cache *entry ) {
+
+    LfuState *lfu = state;
+    LfuNode *node = lfu->head;
+    if ( node == NULL || node->count != 1 ) {
+        LfuNode *first = lfuNewNode(lfu, 1, NULL);
+        node = (first != NULL) ? first : node;
+    }
+    entry->policyData = node;
+    pushCacheList(&node->entries, entry);
+}
+
+void lfuTouch( void *state, Cache *entry ) {
+
+    LfuState *lfu = state;
+    LfuNode *node = entry->policyData;
+    LfuNode *next = node->next;
+
+    if ( next == NULL || next->count != node->count + 1 ) {
+        if ( (next = lfuNewNode(lfu, node->count + 1, node)) == NULL ) {
+            return;
+        }
+    }
+    lfuUnlink(lfu, entry);
+    entry->policyData = next;
+    pushCacheList(&next->entries, entry);
+}
+
+void lfuRemove( void *state, Cache *entry ) {
+    lfuUnlink(state, entry);
+}
+
+void lfuDemote( void *state, Cache *entry ) {
+
+    // Back to a count of one, the least recent of them
+    LfuState *lfu = state;
+    lfuUnlink(lfu, entry);
+    lfuInsert(state, entry);
+    LfuNode *node = entry->policyData;
+    unlinkCacheList(&node->entries, entry);
+    appendCacheList(&node->entries, entry);
+}
+
+const SGCachePolicyOps lfuPolicy = {
+    "LFU", lfuCreate, lfuDestroy, NULL, NULL, lfuEvict, lfuInsert, lfuTouch, lfuRemove, lfuDemote
+};
+
+//
+// The policy table, indexed by SGCachePolicy
+const SGCachePolicyOps *sgCachePolicies[SG_CACHE_MAX_POLICY] = {
+    &lruPolicy, &clockPolicy, &twoQPolicy, &arcPolicy, &lfuPolicy
+};
@@ -0,0 +1,92 @@
+#ifndef SG_CACHE_POLICY_INCLUDED
+#define SG_CACHE_POLICY_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_cache_policy.h
+//  Description    : This is the internal interface between the block cache
+//                   and its replacement policies.  The cache owns the hash
+//                   table and block storage, the policy owns the ordering
+//                   of the resident entries (and any ghost history).
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Includes
+#include <sg_cache.h>
+
+//
+// Type definitions
+
+// A cache entry, also used (without data) for the ghost lists of policies
+typedef struct cache {
+    SG_Node_ID cacheRemNoteId;
+    SG_Block_ID cacheBlockId;
+    struct cache *hashNext; // Next entry in the same hash bucket (or free list)
+    struct cache *lruPrev;  // Policy list neighbour (towards the head)
+    struct cache *lruNext;  // Policy list neighbour (towards the tail)
+    void *policyData;       // Policy private pointer (LFU frequency node)
+    uint8_t queue;          // Policy list the entry is on
+    uint8_t referenced;     // Reference bit (CLOCK)
+    uint8_t dirty;          // Modified since it was last written to its node
+    uint32_t touchStamp;    // Shard touch count at the last hit or insertion
+    uint32_t pins;          // References held by pinSGDataBlock, never evicted while set
+    char *Data;             // The block, kept apart so lookups stay compact
+} Cache;
+
+// An intrusive list of entries, head is the most recent insertion
+typedef struct {
+    Cache *head;
+    Cache *tail;
+    uint32_t size;
+} CacheList;
+
+// The replacement policy operations
+typedef struct {
+    const char *name;
+    void *(*create)( uint32_t capacity );
+        // Allocate the policy state for a cache of capacity entries
+    void (*destroy)( void *state );
+        // Release the policy state
+    int (*resize)( void *state, uint32_t capacity );
+        // Adjust to a new capacity before the cache evicts down to it (may be NULL)
+    void (*miss)( void *state, SG_Node_ID nde, SG_Block_ID blk );
+        // A block not in the cache is about to be inserted (may be NULL)
+    Cache *(*evict)( void *state, SG_Node_ID nde, SG_Block_ID blk );
+        // Choose and detach an unpinned victim to make room for the block
+    void (*insert)( void *state, Cache *entry );
+        // Start tracking a newly filled entry
+    void (*touch)( void *state, Cache *entry );
+        // Record a hit on a resident entry
+    void (*remove)( void *state, Cache *entry );
+        // Stop tracking an entry without keeping any history
+    void (*demote)( void *state, Cache *entry );
+        // Move a resident entry to where the policy evicts next (may be NULL)
+} SGCachePolicyOps;
+
+// The policy implementations, indexed by SGCachePolicy
+extern const SGCachePolicyOps *sgCachePolicies[SG_CACHE_MAX_POLICY];
+
+// Ghost hits are counted by the policies, reported by the cache
+extern int ghostHitCount;
+
+//
+// Support functions
+
+uint64_t hashSGCacheKey( SG_Node_ID nde, SG_Block_ID blk );
+    // Hash a node/block pair
+
+void pushCacheList( CacheList *list, Cache *entry );
+    // Insert an entry at the head of a list
+
+void appendCacheList( CacheList *list, Cache *entry );
+    // Insert an entry at the tail of a list
+
+void unlinkCacheList( CacheList *list, Cache *entry );
+    // Remove an entry from a list
+
+Cache *findUnpinnedCacheList( CacheList *list );
+    // Find the entry nearest the tail that is not pinned (NULL if none)
+
+#endif
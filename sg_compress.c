@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_compress.c
+//  Description    : This file contains the block compressor.  Output is in
+//                   the LZ4 block format: sequences of a token (literal
+//                   length and match length, 4 bits each), the literals, a
+//                   2 byte offset back to the match, with longer lengths
+//                   continued in bytes of 255.  Matches are found through
+//                   a single-entry hash of the next 4 bytes, so one pass
+//                   over a block costs a few microseconds.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#include <stdint.h>
+#include <string.h>
+
+// Project Includes
+#include <sg_compress.h>
+
+// Defines
+#define SG_LZ_HASH_BITS 12   // Positions remembered by the match finder
+#define SG_LZ_MIN_MATCH 4    // Shortest match encoded
+#define SG_LZ_LAST_LITERALS 5 // The last bytes are always literals
+#define SG_LZ_MATCH_LIMIT 12 // No match starts this close to the end
+#define SG_LZ_MAX_OFFSET 65535 // Farthest match reachable
+#define SG_LZ_SKIP_TRIGGER 5 // Misses before the search steps further
+
+//
+// Functional Prototypes
+uint32_t sgLzRead32( const unsigned char *p ); // Load 4 unaligned bytes
+uint32_t sgLzHash( uint32_t sequence ); // Hash of 4 bytes
+int sgLzPutLength( unsigned char *op, unsigned char *oend, int len ); // Continue a length
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgCompress
+// Description  : Compress a range of bytes, giving up as soon as the output
+//                would not fit
+//
+// Inputs       : src - the bytes to compress
+//                len - their length
+//                dst - where the compressed bytes go
+//                room - the most compressed bytes wanted
+// Outputs      : the compressed length, 0 if it does not fit in room
+
+int sgCompress( const char *src, int len, char *dst, int room ) {
+
+    const unsigned char *in = (const unsigned char *) src;
+    unsigned char *op = (unsigned char *) dst, *oend = op + room;
+    uint16_t table[1 << SG_LZ_HASH_BITS];
+    int ip = 0, anchor = 0, misses = 0, n;
+
+    memset(table, 0, sizeof(table));
+    while ( len > SG_LZ_MATCH_LIMIT && ip < len - SG_LZ_MATCH_LIMIT ) {
+
+        // Look up the last position with the same 4 bytes, stepping further
+        // the longer nothing matches (data that does not compress is passed
+        // over quickly), and give up once the literals alone do not fit
+        uint32_t sequence = sgLzRead32(&in[ip]);
+        uint32_t h = sgLzHash(sequence);
+        int ref = table[h];
+        table[h] = (uint16_t) ip;
+        if ( ref >= ip || ip - ref > SG_LZ_MAX_OFFSET || sgLzRead32(&in[ref]) != sequence ) {
+            ip += 1 + (misses++ >> SG_LZ_SKIP_TRIGGER);
+            if ( op + (ip - anchor) > oend ) {
+                return( 0 );
+            }
+            continue;
+        }
+        misses = 0;
+
+        // Extend the match, the last literals stay out of it
+        int match = SG_LZ_MIN_MATCH;
+        while ( ip + match < len - SG_LZ_LAST_LITERALS && in[ref + match] == in[ip + match] ) {
+            match++;
+        }
+
+        // Token, literals, offset then the rest of the match length
+        int literals = ip - anchor;
+        if ( op + 1 + literals + 2 > oend ) {
+            return( 0 );
+        }
+        unsigned char *token = op++;
+        *token = (unsigned char) (((literals < 15) ? literals : 15) << 4);
+        if ( literals >= 15 && (n = sgLzPutLength(op, oend, literals - 15)) < 0 ) {
+            return( 0 );
+        }
+        op += (literals >= 15) ? n : 0;
+        if ( op + literals + 2 > oend ) {
+            return( 0 );
+        }
+        memcpy(op, &in[anchor], literals);
+        op += literals;
+        *op++ = (unsigned char) ((ip - ref) & 0xff);
+        *op++ = (unsigned char) ((ip - ref) >> 8);
+        match -= SG_LZ_MIN_MATCH;
+        *token |= (unsigned char) ((match < 15) ? match : 15);
+        if ( match >= 15 ) {
+            if ( (n = sgLzPutLength(op, oend, match - 15)) < 0 ) {
+                return( 0 );
+            }
+            op += n;
+        }
+
+        ip += match + SG_LZ_MIN_MATCH;
+        anchor = ip;
+    }
+
+    // The rest goes out as literals
+    int literals = len - anchor;
+    if ( op + 1 > oend ) {
+        return( 0 );
+    }
+    *op = (unsigned char) (((literals < 15) ? literals : 15) << 4);
+    op++;
+    if ( literals >= 15 ) {
+        if ( (n = sgLzPutLength(op, oend, literals - 15)) < 0 ) {
+            return( 0 );
+        }
+        op += n;
+    }
+    if ( op + literals > oend ) {
+        return( 0 );
+    }
+    memcpy(op, &in[anchor], literals);
+    op += literals;
+
+    return( (int) (op - (unsigned char *) dst) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgDecompress
+// Description  : Expand compressed bytes, checking every length and offset
+//                against both buffers
+//
+// Inputs       : src - the compressed bytes
+//                len - their length
+//                dst - where the expanded bytes go
+//                room - the size of dst
+// Outputs      : the expanded length, -1 if the input is corrupt
+
+int sgDecompress( const char *src, int len, char *dst, int room ) {
+
+    const unsigned char *in = (const unsigned char *) src;
+    unsigned char *out = (unsigned char *) dst;
+    int ip = 0, op = 0;
+    unsigned char b;
+
+    while ( ip < len ) {
+
+        // The literals
+        int token = in[ip++];
+        int literals = token >> 4;
+        if ( literals == 15 ) {
+            do {
+                if ( ip >= len ) {
+                    return( -1 );
+                }
+                b = in[ip++];
+                literals += b;
+            } while ( b == 255 );
+        }
+        if ( literals > len - ip || literals > room - op ) {
+            return( -1 );
+        }
+        memcpy(&out[op], &in[ip], literals);
+        ip += literals;
+        op += literals;
+
+        // The last sequence has no match
+        if ( ip == len ) {
+            break;
+        }
+
+        // The match, copied a byte at a time as it may overlap itself
+        if ( len - ip < 2 ) {
+            return( -1 );
+        }
+        int offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        if ( offset == 0 || offset > op ) {
+            return( -1 );
+        }
+        int match = token & 15;
+        if ( match == 15 ) {
+            do {
+                if ( ip >= len ) {
+                    return( -1 );
+                }
+                b = in[ip++];
+                match += b;
+            } while ( b == 255 );
+        }
+        match += SG_LZ_MIN_MATCH;
+        if ( match > room - op ) {
+            return( -1 );
+        }
+        for ( int i = 0; i < match; i++, op++ ) {
+            out[op] = out[op - offset];
+        }
+    }
+
+    return( op );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLzRead32
+// Description  : Load 4 bytes from any alignment
+//
+// Inputs       : p - the bytes
+// Outputs      : their value
+
+uint32_t sgLzRead32( const unsigned char *p ) {
+
+    uint32_t value;
+    memcpy(&value, p, sizeof(uint32_t));
+    return( value );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLzHash
+// Description  : Hash 4 bytes into the match finder's table
+//
+// Inputs       : sequence - the bytes
+// Outputs      : the table index
+
+uint32_t sgLzHash( uint32_t sequence ) {
+
+    return( (sequence * 2654435761U) >> (32 - SG_LZ_HASH_BITS) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLzPutLength
+// Description  : Write the part of a length over 15, in bytes of 255 then
+//                the remainder
+//
+// Inputs       : op - where the bytes go
+//                oend - the end of the output
+//                len - the length left over
+// Outputs      : the bytes written, -1 if they do not fit
+
+int sgLzPutLength( unsigned char *op, unsigned char *oend, int len ) {
+
+    int n = 0;
+
+    while ( len >= 255 ) {
+        if ( op + n >= oend ) {
+            return( -1 );
+        }
+        op[n++] = 255;
+        len -= 255;
+    }
+    if ( op + n >= oend ) {
+        return( -1 );
+    }
+    op[n++] = (unsigned char) len;
+
+    return( n );
+}
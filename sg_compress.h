@@ -0,0 +1,36 @@
+#ifndef SG_COMPRESS_INCLUDED
+#define SG_COMPRESS_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_compress.h
+//  Description    : This is the interface of the block compressor, a small
+//                   LZ4 block format coder used for block payloads on the
+//                   wire and in the compressed tier of the block cache.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Includes
+#include <sg_defs.h>
+
+//
+// Defines
+
+// Largest compressed block kept, a block that does not shrink to this is
+// left as it is (so compression saves at least a quarter when used)
+#define SG_COMPRESS_LIMIT (SG_BLOCK_SIZE * 3 / 4)
+
+//
+// Compression functions
+
+int sgCompress( const char *src, int len, char *dst, int room );
+    // Compress len bytes (at most 64K) into at most room bytes, the
+    // compressed length or 0 if it does not fit (the data compresses poorly)
+
+int sgDecompress( const char *src, int len, char *dst, int room );
+    // Expand a compressed range into at most room bytes, the expanded length
+    // or -1 if it is corrupt
+
+#endif
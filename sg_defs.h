@@ -36,6 +36,20 @@
 // The basic ScatterGather packet size WITH block
 #define SG_DATA_PACKET_SIZE (SG_BASE_PACKET_SIZE + SG_BLOCK_SIZE)
 
+// The most blocks of a batched packet, and its largest size (the block IDs
+// follow the fields, then the blocks if there are any)
+#define SG_BATCH_MAX_BLOCKS 32
+#define SG_BATCH_PACKET_SIZE (SG_BASE_PACKET_SIZE + \
+        SG_BATCH_MAX_BLOCKS * (sizeof(SG_Block_ID) + SG_BLOCK_SIZE))
+
+// The data indicator of a packet whose block follows compressed, the packet
+// length gives the compressed length (see sg_compress.h)
+#define SG_DATA_COMPRESSED 2
+
+// The longest range of a partial update (the offset and length in the block
+// follow the fields, then the bytes), so it fits where a block packet does
+#define SG_RANGE_MAX_LENGTH (SG_BLOCK_SIZE - 2 * sizeof(uint16_t))
+
 // Type definitions
 typedef int32_t SgFHandle;
 typedef uint64_t SG_Node_ID;   // The type for node identifiers
@@ -51,7 +65,11 @@ typedef enum {
     SG_UPDATE_BLOCK    = 3,   // Update a block
     SG_OBTAIN_BLOCK    = 4,   // Get the block (or be redirected)
     SG_DELETE_BLOCK    = 5,   // Delete the block
-    SG_MAXVAL_OP       = 6    // Maximum value of the opcode
+    SG_CREATE_BATCH    = 6,   // Create blocks together (on one node)
+    SG_UPDATE_BATCH    = 7,   // Update blocks of one node
+    SG_OBTAIN_BATCH    = 8,   // Get blocks of one node
+    SG_UPDATE_RANGE    = 9,   // Update a range of a block
+    SG_MAXVAL_OP       = 10   // Maximum value of the opcode
 } SG_System_OP;  
 
 // A packet information structure 
@@ -65,6 +83,27 @@ typedef struct {
     SGDataBlock   *data;       // The data block (or NULL)
 } SG_Packet_Info;
 
+// The fields at the front of a packet, as laid out on the wire (the block,
+// if there is one, and the closing magic number follow)
+typedef struct {
+    uint32_t       magic;         // The magic number
+    SG_Node_ID     locNodeId;     // The local node ID
+    SG_Node_ID     remNodeId;     // The remote node ID
+    SG_Block_ID    blockID;       // The block ID
+    SG_System_OP   operation;     // The operation
+    SG_SeqNum      sendSeqNo;     // The sender sequence number
+    SG_SeqNum      recvSeqNo;     // The receiver sequence number
+    char           dataIndicator; // 1 if a block follows (SG_DATA_COMPRESSED if compressed)
+} __attribute__((packed)) SG_Packet_Header;
+
+// A packet in pieces, the block is referenced where it lies instead of
+// being copied into the packet
+typedef struct {
+    SG_Packet_Header header;  // The fields
+    char          *data;      // The block sent, or where a received one goes (or NULL)
+    uint32_t       trailer;   // The closing magic number
+} SG_Packet_Vec;
+
 // Status values for the packet processing
 typedef enum {
     SG_PACKT_OK        = 0,  // The packet processing is good
@@ -12,14 +12,29 @@
 // Include Files
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 // Project Includes
 #include <sg_driver.h>
 #include <sg_service.h>
 
 #include <sg_cache.h>
+#include <sg_compress.h>
 
 // Defines
+#define SG_AIO_MAX_INFLIGHT 256 // Async packets in flight (power of two)
+#define SG_BLOCK_MAP_INITIAL 16 // First size of a file's block map
+#define SG_FILE_TABLE_INITIAL 64 // First size of the handle table and path hash
+#define SG_REM_TABLE_SIZE 1024 // Remote node table slots (power of two)
+#define SG_REM_TABLE_LOAD (SG_REM_TABLE_SIZE * 3 / 4) // Most nodes kept
+#define SG_BATCH_WINDOW (SG_BATCH_MAX_BLOCKS * 4) // Dirty blocks a flush gathers before posting
+#define SG_WINDOW_INITIAL 4 // Packets a node may have in flight at first
+#define SG_WINDOW_MAX 64    // Most packets in flight to a node
+#define SG_WINDOW_DELAY 2   // Round trips over this many lowest ones shrink the window
+#define SG_READAHEAD_MIN 4  // Blocks read ahead of a new stream
+#define SG_READAHEAD_MAX 32 // Most blocks read ahead of a stream (by default)
 
 //
 // Global Data
@@ -29,42 +44,181 @@
 // Global data
 int sgDriverInitialized = 0; // The flag indicating the driver initialized
 SG_Block_ID sgLocalNodeId;   // The local node identifier
-SG_SeqNum sgLocalSeqno;      // The local sequence number
+SG_SeqNum sgLocalSeqno;      // The local sequence number (taken atomically)
 
+// Locks, always taken in this order: the table lock (written by open, close
+// and shutdown, read by the other file calls), a file's lock, the cache's
+// own lock, then the service lock (held from taking the seqnos of a packet
+// to its response, so the service sees them in order)
+pthread_once_t sgLockOnce = PTHREAD_ONCE_INIT;
+pthread_rwlock_t sgTableLock;
+pthread_mutex_t sgServiceLock = PTHREAD_MUTEX_INITIALIZER;
+
+// A remote node, a slot of the open-addressing node table
 typedef struct rem_info {
-    SG_Node_ID remNodeId;
-    SG_SeqNum sgRemoteseqno;
-    struct rem_info *pNext;
+    SG_Node_ID remNodeId;     // 0 if the slot is empty
+    SG_SeqNum sgRemoteseqno;  // Last receiver sequence number used
+    uint32_t blocks;          // Blocks created on the node
+    uint32_t ops[SG_MAXVAL_OP]; // Packets sent to the node, per operation
+    uint32_t inFlight;        // Pipelined packets not yet answered
+    uint32_t window;          // Most pipelined packets in flight
+    uint32_t threshold;       // Window below which it grows by one per answer
+    uint32_t acked;           // Answers since the window last grew
+    SG_SeqNum backoff;        // First seqno sent since the window last shrank
+    uint64_t baseRtt;         // Lowest round trip seen (ns)
 } Rem, *pRem;
-pRem myRem;
+Rem remTable[SG_REM_TABLE_SIZE]; // Remote nodes, linear probing
 
+// The node/block IDs of a block, myIds[blockCount] of its file (a block ID
+// of 0 marks a block not created yet)
 typedef struct ids_info {
     SG_Block_ID blockIdGot;
     SG_Node_ID remNoteIdGot;
-    int track;  // blockCount
-    struct ids_info *pNext;
 } IdGot, *pIdGot;
 
+// A block of a call, posted with the others for its node in batches when
+// the transport takes them
+typedef struct batch_block {
+    int blockCount;  // Index of the block in its file
+    SG_Node_ID rem;  // The node of the block (set by a creation)
+    SG_Block_ID blk; // The block ID (set by a creation)
+    char *data;      // The block sent, or where an obtained block goes
+} BatchBlock, *pBatchBlock;
+
 typedef struct file_info {
     int filePtr; // file position
     int fileSize;
     int fileStatus;
     const char *filename;
     SgFHandle fileHandle;
-    pIdGot myIds;
-    struct file_info *pNext;
+    pIdGot myIds;   // Block map, indexed by block number
+    int idCount;    // Entries allocated in myIds
+    int stageBlock; // Block index held in the staging buffer, -1 if none
+    size_t raNext;  // Where a sequential read would start
+    int raWindow;   // Blocks read ahead of the stream, 0 if none
+    int raBlock;    // First block not read ahead yet
+    SgAdvice advice; // How the file is used (sgadvise)
+    char stageData[SG_BLOCK_SIZE]; // Tail block not yet created on a node
+    struct file_info *pathNext; // Next file in the same path bucket
+    pthread_mutex_t fileLock;   // Held by the calls using the file
 } File, *pFile;
-pFile myFile;
 
-int count = 0; // count files
-int remCount = 0; // count remote nodes
+pFile *fileTable = NULL;  // Open files, indexed by file handle
+int fileTableSize = 0;    // Entries in fileTable
+SgFHandle *freeHandles;   // Handles of closed files, reused first (stack)
+int freeHandleCount = 0;  // Handles on freeHandles
+pFile *pathBuckets = NULL; // Open files, hashed by path
+uint64_t pathMask = 0;     // Number of path buckets - 1 (power of two)
+
+int count = 0; // count open files
+int remCount = 0; // count remote nodes (in remTable)
+int sgWriteBack = 0; // Keep writes in the cache until eviction or flush
+int sgReadaheadMax = SG_READAHEAD_MAX; // Most blocks read ahead of a stream, 0 for none
+uint32_t sgReadaheadCount = 0; // Blocks read ahead
+uint32_t sgCoalescedCount = 0; // Misses served by an obtain already in flight
+int sgOpCount[SG_MAXVAL_OP]; // Packets posted, per operation
+int sgPacketCompression = 0; // Blocks of packets sent compressed where it pays
+uint32_t sgCompressedCount = 0; // Blocks sent compressed
+uint64_t sgCompressedSaved = 0; // Bytes the compression saved
+__thread SG_Packet_Header sgPackedHeader; // Header of the last packet sgPacketIov compressed
+__thread char sgPackedData[SG_COMPRESS_LIMIT]; // Its block, compressed
+const SGServiceTransport *sgTransport = &sgLibraryTransport; // Where packets are posted
+
+// An asynchronous request, done when no packet of it is pending
+typedef struct aio_request {
+    SgAioCompletion completion;
+    int pending; // Packets in flight (+1 while submitting)
+    int failed;  // A packet of the request failed
+    int waited;  // A synchronous call waits for it (and caches the blocks)
+    struct aio_request *pNext; // Next completed request
+} AioRequest, *pAioRequest;
+
+// A miss of another request waiting on an obtain in flight
+typedef struct aio_waiter {
+    pAioRequest request; // The waiting request
+    char *dest;          // Where its range goes
+    int start, end;      // The range of the block
+    struct aio_waiter *pNext; // Next waiter of the packet (or free)
+} AioWaiter, *pAioWaiter;
+
+// An asynchronous packet in flight, indexed by its sender seqno
+typedef struct {
+    pAioRequest request; // Owning request, NULL if the slot is free
+    SG_System_OP op;
+    SG_Node_ID rem;
+    SG_Block_ID blk;
+    char *dest;     // Where the obtained range goes (OBTAIN)
+    int start, end; // The range of the block
+    size_t rlen;
+    uint64_t sent;  // When the packet was submitted (ns)
+    SG_Packet_Vec response; // The response, its block to dest or block
+    SGDataBlock block;      // The obtained block, unless it all goes to dest
+    pAioWaiter waiters;     // Other misses of the block, served from the answer
+    int missNext;           // Next obtain in the same miss bucket, -1 if none
+} AioPacket;
+
+AioPacket sgAioInFlight[SG_AIO_MAX_INFLIGHT]; // Packets in flight
+int sgAioPackets = 0;  // Number of packets in flight
+int sgAioRequests = 0; // Requests not yet reaped
+pAioRequest sgAioDone, sgAioDoneTail; // Completed requests, in order
+AioRequest sgReadahead; // Blocks read ahead, cached when answered (never done)
+int sgMissBuckets[SG_AIO_MAX_INFLIGHT]; // Obtains in flight by block, slot or -1
+pAioWaiter sgFreeWaiters = NULL; // Released waiters, reused first
+__thread pAioRequest sgAioCurrent; // Request this thread is submitting
 
 // Driver support functions
 int sgInitEndpoint( void ); // Initialize the endpoint
-
-int mySgCreateBlock( SgFHandle fh, char *buf, size_t len ); // Create a block
-int mySgUpdateBlock( SgFHandle fh, char *buf, size_t len ); // Update a block
-int mySgObtainBlock( SgFHandle fh, char *buf ); // Obtain a block
+SgFHandle mySgOpen( const char *path ); // Open a file (table lock held)
+int mySgShutdown( void ); // Shut down (table lock held)
+int mySgFlushFile( SgFHandle fh ); // Flush a file (its lock held)
+int mySgFlushBlocks( pBatchBlock blocks, int count ); // Write back cleaned blocks together
+void mySgInitLocks( void ); // Set up the table lock
+pFile mySgLockFile( SgFHandle fh ); // Find and lock an open file
+void mySgUnlockFile( pFile file ); // Release a file found by mySgLockFile
+
+int mySgCreateBlock( SgFHandle fh, char *buf, int blockCount ); // Create a block
+int mySgSetIds( pFile file, int blockCount, SG_Node_ID rem, SG_Block_ID blk ); // Record a created block
+int mySgPostBlocks( SG_System_OP op, pBatchBlock blocks, int count ); // Post blocks, batched by node
+int mySgFlushStage( SgFHandle fh ); // Create the staged tail block
+int mySgUpdateBlock( SgFHandle fh, int blockCount, char *buf ); // Update a block
+int mySgObtainBlock( SgFHandle fh, int blockCount, char *buf ); // Obtain a block
+int sgUpdateRemoteBlock( SG_Node_ID rem, SG_Block_ID blk, char *buf ); // Send an update
+int sgUpdateRemoteRange( SG_Node_ID rem, SG_Block_ID blk, char *buf, int start, int end ); // Send part of an update
+int sgObtainRemoteBlock( SG_Node_ID rem, SG_Block_ID blk, char *buf ); // Retrieve a block
+int sgCreateRemoteBlock( char *buf, SG_Node_ID *rem, SG_Block_ID *blk ); // Create a block on a node
+int sgBatchRemoteBlocks( SG_System_OP op, pBatchBlock blocks, int count ); // Post one batch to a node
+pFile mySgFindFile( SgFHandle fh ); // Find an open file
+SgFHandle mySgAllocHandle( void ); // Take a free file handle
+int mySgGrowPaths( void ); // Double the path hash
+uint64_t mySgHashPath( const char *path ); // Hash a path
+pIdGot mySgFindIds( pFile file, int blockCount ); // Find a block of a file
+int mySgReadv( SgFHandle fh, size_t off, const struct iovec *iov, int iovcnt ); // Read a range
+int mySgWritev( SgFHandle fh, size_t off, const struct iovec *iov, int iovcnt ); // Write a range
+size_t mySgIovLength( const struct iovec *iov, int iovcnt ); // Length of buffers
+char *mySgIovSpan( const struct iovec *iov, int iovcnt, size_t pos, size_t len ); // Contiguous range
+void mySgCopyIov( const struct iovec *iov, int iovcnt, size_t pos, char *block, size_t len, int toIov ); // Copy a range
+int sgPostPacket( SG_System_OP op, char *packet, size_t *len, char *rpacket, size_t *rlen ); // Post a packet
+int sgPostPacketv( SG_System_OP op, SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ); // Post in pieces
+SG_SeqNum mySgNextSeqno( void ); // Take a sender seqno
+SG_SeqNum mySgRemoteSeqno( SG_Node_ID rem, SG_System_OP op ); // Take a receiver seqno
+pRem mySgFindRem( SG_Node_ID rem, int add ); // Find a remote node
+int mySgAioPostBlock( pAioRequest request, SG_System_OP op, SG_Node_ID rem, SG_Block_ID blk,
+                      char *data, char *dest, int start, int end ); // Post without waiting
+int mySgAioComplete( SG_SeqNum seqno ); // Finish a packet in flight
+int mySgPackBlock( char *block, char *packed ); // Compress a block to send
+void mySgAioFinish( pAioRequest request ); // Finish a request if done
+int mySgAioWait( int wait ); // Complete answered packets
+int mySgAioWaitBlock( SG_Node_ID rem, SG_Block_ID blk ); // Wait for a block's obtain in flight
+void mySgMissWait( pFile file, int first, int last ); // Wait for obtains of a range in flight
+AioPacket *mySgFindMiss( SG_Node_ID rem, SG_Block_ID blk ); // Find a block's obtain in flight
+pAioWaiter mySgUnlinkMiss( AioPacket *slot ); // Forget an obtain, take its waiters
+int mySgMissBucket( SG_Node_ID rem, SG_Block_ID blk ); // Miss table bucket of a block
+void mySgReadahead( pFile file, size_t off, size_t len, int missed ); // Follow a read stream
+int mySgPrefetch( pFile file, int first, int end ); // Obtain blocks in the background
+int mySgAdvise( pFile file, size_t off, size_t len, SgAdvice advice ); // Apply advice
+void mySgDemoteBlocks( pFile file, int first, int last ); // Evict blocks first
+void mySgWindowAnswer( SG_Node_ID rem, SG_SeqNum seqno, uint64_t rtt, int ok ); // Resize a node's window
+uint64_t mySgNow( void ); // Monotonic time (ns)
 
 //
 // Functions
@@ -82,14 +236,93 @@ int mySgObtainBlock( SgFHandle fh, char *buf ); // Obtain a block
 
 SgFHandle sgopen(const char *path) {
 
+    // No other call uses the file table while it changes
+    pthread_once(&sgLockOnce, mySgInitLocks);
+    pthread_rwlock_wrlock(&sgTableLock);
+    SgFHandle fh = mySgOpen(path);
+    pthread_rwlock_unlock(&sgTableLock);
+
+    return( fh );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgOpen
+// Description  : Open the file, initializing the driver on the first call
+//                (the table lock is held for writing)
+//
+// Inputs       : path - the path/filename of the file
+// Outputs      : file handle if successful, -1 if failure
+
+SgFHandle mySgOpen( const char *path ) {
+
     // First check to see if we have been initialized
     if (!sgDriverInitialized) {
 
-        initSGCache(SG_MAX_CACHE_ELEMENTS); // Initialize cache
+        // Initialize cache, sized from the environment if given
+        uint32_t cacheSize = SG_MAX_CACHE_ELEMENTS;
+        char *sizeSpec = getenv(SG_CACHE_SIZE_ENV);
+        if ( sizeSpec != NULL && (cacheSize = parseSGCacheSize(sizeSpec)) == 0 ) {
+            logMessage( LOG_WARNING_LEVEL, "sgopen: bad cache size [%s], using %d blocks.",
+                                                    sizeSpec, SG_MAX_CACHE_ELEMENTS );
+            cacheSize = SG_MAX_CACHE_ELEMENTS;
+        }
+        if ( initSGCache(cacheSize) ) {
+            logMessage( LOG_ERROR_LEVEL, "sgopen: cache initialization failed." );
+            return( -1 );
+        }
+
+        // Write-back mode, dirty blocks are sent when evicted or flushed
+        char *writeBack = getenv(SG_CACHE_WRITEBACK_ENV);
+        sgWriteBack = (writeBack != NULL && atoi(writeBack) != 0);
+        setSGCacheWriteback(sgUpdateRemoteBlock);
+
+        // Read ahead of sequential reads, up to a window from the environment
+        char *readahead = getenv(SG_READAHEAD_ENV);
+        sgReadaheadMax = (readahead != NULL) ? atoi(readahead) : SG_READAHEAD_MAX;
+        if ( sgReadaheadMax < 0 || sgReadaheadMax > SG_AIO_MAX_INFLIGHT / 2 ) {
+            logMessage( LOG_WARNING_LEVEL, "sgopen: bad readahead [%s], using %d blocks.",
+                                                    readahead, SG_READAHEAD_MAX );
+            sgReadaheadMax = SG_READAHEAD_MAX;
+        }
+
+        // Blocks read ahead must not push the stream out of the cache
+        if ( sgReadaheadMax > (int) cacheSize / 4 ) {
+            sgReadaheadMax = cacheSize / 4;
+        }
+        memset(&sgReadahead, 0, sizeof(AioRequest));
+        sgReadahead.pending = 1;
+        sgReadaheadCount = 0;
+        sgCoalescedCount = 0;
+        memset(sgMissBuckets, 0xff, sizeof(sgMissBuckets));
+
+        // The library unless another transport is selected
+        char *service = getenv(SG_SERVICE_ENV);
+        if ( (sgTransport = getSGServiceTransport(service)) == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "sgopen: unknown service transport [%s].", service );
+            sgTransport = &sgLibraryTransport;
+            closeSGCache();
+            return( -1 );
+        }
+
+        // Blocks go compressed where the service takes them
+        char *compress = getenv(SG_COMPRESS_ENV);
+        setSGPacketCompression(compress != NULL && atoi(compress) != 0 && sgTransport->compressedBlocks);
+        sgCompressedCount = 0;
+        sgCompressedSaved = 0;
+
+        // A failed open is undone, so a later sgopen starts over
+        if ( sgTransport->open() ) {
+            logMessage( LOG_ERROR_LEVEL, "sgopen: %s service initialization failed.", sgTransport->name );
+            closeSGCache();
+            return( -1 );
+        }
 
         // Call the endpoint initialization 
         if ( sgInitEndpoint() ) {
             logMessage( LOG_ERROR_LEVEL, "sgopen: Scatter/Gather endpoint initialization failed." );
+            sgTransport->close();
+            closeSGCache();
             return( -1 );
         }
 
@@ -98,26 +331,38 @@ SgFHandle sgopen(const char *path) {
     }
 
     // If the file exist
-    pFile test = myFile;
-    for ( int i = 0; i < count; i++ ) {
-        while ( test != NULL ) {
-            if ( strcmp(test->filename, path) == 0 ) {
-                test->filePtr = 0;
-                return( test->fileHandle );
-            } else {
-                test = test->pNext;
-            }
+    uint64_t hash = mySgHashPath(path);
+    pFile test = (pathBuckets != NULL) ? pathBuckets[hash & pathMask] : NULL;
+    while ( test != NULL ) {
+        if ( strcmp(test->filename, path) == 0 ) {
+            test->filePtr = 0;
+            return( test->fileHandle );
+        } else {
+            test = test->pathNext;
         }
     }
+
+    // Keep the path hash at most one file per bucket
+    if ( (uint64_t) count >= pathMask && mySgGrowPaths() ) {
+        return( -1 );
+    }
     
     // Allocate memory to every new file passed in
     pFile newFile = (pFile) malloc(sizeof(File));
+    if ( newFile == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "sgopen: out of memory." );
+        return( -1 );
+    }
 
     // Set up filename in my struct
     newFile->filename = strdup(path);
     
     // 2) Assignment a file handle
-    newFile->fileHandle = count;
+    if ( (newFile->fileHandle = mySgAllocHandle()) == -1 ) {
+        free((char *) newFile->filename);
+        free(newFile);
+        return( -1 );
+    }
     
     // 3a) Set the file pointer to 0
     newFile->filePtr = 0;
@@ -127,13 +372,23 @@ SgFHandle sgopen(const char *path) {
 
     newFile->fileStatus = 1;
 
-    newFile->pNext = myFile;
-    myFile = newFile;
+    newFile->myIds = NULL;
+    newFile->idCount = 0;
+    newFile->stageBlock = -1;
+    newFile->raNext = 0;
+    newFile->raWindow = 0;
+    newFile->raBlock = 0;
+    newFile->advice = SG_ADVICE_NORMAL;
+    pthread_mutex_init(&newFile->fileLock, NULL);
+
+    fileTable[newFile->fileHandle] = newFile;
+    newFile->pathNext = pathBuckets[hash & pathMask];
+    pathBuckets[hash & pathMask] = newFile;
 
     count++;
 
     // Return the file handle 
-    return( myFile->fileHandle );
+    return( newFile->fileHandle );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -148,55 +403,8 @@ SgFHandle sgopen(const char *path) {
 
 int sgread(SgFHandle fh, char *buf, size_t len) {
 
-    // For transitional storage
-    char readData[SG_BLOCK_SIZE];
-
-    // 1) Check if file handle to see if assigned before, error if not
-    if ( fh < 0 || fh >= count ) {
-        return( -1 );
-    }
-
-    // Find the corresponding file
-    pFile temp = myFile;
-    while ( temp != NULL ) {
-        if ( temp->fileHandle == fh ) {
-            break;
-        } else {
-            temp = temp->pNext;
-        }
-    }
-
-    // 2) If file pointer points to end of the file, error reading beyond end of file 
-    if ( temp->filePtr >= temp->fileSize ) {
-        return( -1 );
-    }
-    
-    // 3) 4) 5) in the function
-    mySgObtainBlock(fh, readData);
-
-    if ( temp->filePtr % (SG_BLOCK_SIZE / 2) == 0 ) { // Read first quarter or third quarter of block
-
-        if( temp->filePtr % SG_BLOCK_SIZE == 0 ){ // Read first quarter
-            memcpy(buf, readData, len);
-        } else {                             // Read third quarter
-            memcpy(buf, &readData[len*2], len);
-        }
-
-    } else {                                  // Read second half or forth quarter of block
-
-        if( (temp->filePtr - len) % SG_BLOCK_SIZE == 0 ){ // Read second quarter
-            memcpy(buf, &readData[len], len);
-        } else {                             // Read fourth quarter
-            memcpy(buf, &readData[len*3], len);
-        }
-    }
-
-    // 6) Update the file position by adding len
-    temp->filePtr += len;
-
-    // 7) Return the number of bytes read
-    // Return the bytes processed
-    return( len );
+    struct iovec iov = { buf, len };
+    return( sgreadv(fh, &iov, 1) );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -211,110 +419,112 @@ int sgread(SgFHandle fh, char *buf, size_t len) {
 
 int sgwrite(SgFHandle fh, char *buf, size_t len) {
 
-    // For transitional storage
-    char myData[SG_BLOCK_SIZE];
+    struct iovec iov = { buf, len };
+    return( sgwritev(fh, &iov, 1) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgreadv
+// Description  : Read data from the file position into several buffers
+//
+// Inputs       : fh - file handle for the file to read from
+//                iov - the buffers to fill, in order
+//                iovcnt - the number of buffers
+// Outputs      : number of bytes read, -1 if failure
+
+int sgreadv(SgFHandle fh, const struct iovec *iov, int iovcnt) {
 
     // 1) Check if file handle to see if assigned before, error if not
-    if ( fh < 0 || fh >= count ) {
+    pFile temp = mySgLockFile(fh);
+    if ( temp == NULL ) {
         return( -1 );
     }
 
-    // Find the corresponding file
-    pFile temp = myFile;
-    while ( temp != NULL ) {
-        if ( temp->fileHandle == fh ) {
-            break;
-        } else {
-            temp = temp->pNext;
-        }
-    }
-
-    // Count which block is it
-    int blockCount = temp->filePtr / SG_BLOCK_SIZE; 
-
-    // 2) If file pointer points to end of the file
-    if ( temp->filePtr == temp->fileSize ) {
+    int ret = mySgReadv(fh, temp->filePtr, iov, iovcnt);
 
-        if ( temp->filePtr % (SG_BLOCK_SIZE / 2) == 0 ) { // Case1: ptr = 0, size = 0
-
-            if( temp->filePtr % SG_BLOCK_SIZE == 0 ){   // Case1.1: ptr = 0, size = 0 (1st)
-
-                memcpy(myData, buf, len);
-                mySgCreateBlock(fh, myData, len);
-            } else {                                // Case1.2: ptr = 512, size = 512 (3rd)
-            
-                mySgObtainBlock(fh, myData);
-                memcpy(&myData[len*2], buf, len);
-                mySgUpdateBlock(fh, myData, len);
-
-                temp->fileSize += len;
-                temp->filePtr = temp->fileSize;
-            }
-        } else {                                  // Case2: ptr = 512, size = 512
-            mySgObtainBlock(fh, myData);
+    // Update the file position by adding the bytes read
+    if ( ret > 0 ) {
+        temp->filePtr += ret;
+    }
+    mySgUnlockFile(temp);
+    return( ret );
+}
 
-            if( (temp->filePtr - len) % SG_BLOCK_SIZE == 0 ){   // Case2.1: ptr = 512, size = 512 (2nd)
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgwritev
+// Description  : Write data from several buffers at the file position
+//
+// Inputs       : fh - file handle for the file to write to
+//                iov - the buffers to write, in order
+//                iovcnt - the number of buffers
+// Outputs      : number of bytes written, -1 if failure
 
-                memcpy(&myData[len], buf, len);
-            } else {                                // Case2.2: ptr = 768, size = 768 (4th)
-            
-                memcpy(&myData[len*3], buf, len);
-            }
+int sgwritev(SgFHandle fh, const struct iovec *iov, int iovcnt) {
 
-            mySgUpdateBlock(fh, myData, len);
-            temp->fileSize += len;
-            temp->filePtr = temp->fileSize;
-        }
-    } else {    // 3) If file pointer NOT at end of file
+    // 1) Check if file handle to see if assigned before, error if not
+    pFile temp = mySgLockFile(fh);
+    if ( temp == NULL ) {
+        return( -1 );
+    }
 
-        mySgObtainBlock(fh, myData);
+    int ret = mySgWritev(fh, temp->filePtr, iov, iovcnt);
 
-        if ( temp->filePtr % (SG_BLOCK_SIZE / 2) == 0 ) { // Case3: ptr = 0, size 1024
+    // Move the file position past the write
+    if ( ret > 0 ) {
+        temp->filePtr += ret;
+    }
+    mySgUnlockFile(temp);
+    return( ret );
+}
 
-            if( temp->filePtr % SG_BLOCK_SIZE == 0 ){   // Case3.1: ptr = 0, size = 1024 (1st)
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgpreadv
+// Description  : Read data at an offset into several buffers, the file
+//                position is not changed
+//
+// Inputs       : fh - file handle for the file to read from
+//                iov - the buffers to fill, in order
+//                iovcnt - the number of buffers
+//                off - the offset in the file to read from
+// Outputs      : number of bytes read, -1 if failure
 
-                memcpy(myData, buf, len);
-            } else {                                // Case3.2: ptr = 512, size = 1024 (3rd)
-            
-                memcpy(&myData[len*2], buf, len);
-            }
-        } else {                                  // Case4: ptr = 512, size 1024
+int sgpreadv(SgFHandle fh, const struct iovec *iov, int iovcnt, size_t off) {
 
-            if( (temp->filePtr - len) % SG_BLOCK_SIZE == 0 ){   // Case4.1: ptr = 256, size = 1024 (2nd)
+    pFile temp = mySgLockFile(fh);
+    if ( temp == NULL ) {
+        return( -1 );
+    }
 
-                memcpy(&myData[len], buf, len);
-            } else {                                // Case4.2: ptr = 768, size = 1024 (4th)
-            
-                memcpy(&myData[len*3], buf, len);
-            }
-        }
+    int ret = mySgReadv(fh, off, iov, iovcnt);
+    mySgUnlockFile(temp);
+    return( ret );
+}
 
-        mySgUpdateBlock(fh, myData, len);
-        temp->filePtr += len;
-    }
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgpwritev
+// Description  : Write data from several buffers at an offset, the file
+//                position is not changed
+//
+// Inputs       : fh - file handle for the file to write to
+//                iov - the buffers to write, in order
+//                iovcnt - the number of buffers
+//                off - the offset in the file to write at (at most its size)
+// Outputs      : number of bytes written, -1 if failure
 
-    // Find the corresponding Ids
-    SG_Block_ID blockIdToBePassed;
-    SG_Node_ID remNoteIdToBePassed;
+int sgpwritev(SgFHandle fh, const struct iovec *iov, int iovcnt, size_t off) {
 
-    pIdGot findIds = temp->myIds;
-    while ( findIds != NULL ) {
-        if ( findIds->track == blockCount ) {
-            blockIdToBePassed = findIds->blockIdGot;
-            remNoteIdToBePassed = findIds->remNoteIdGot;
-            break;
-        } else {
-            findIds = findIds->pNext;
-        }
+    pFile temp = mySgLockFile(fh);
+    if ( temp == NULL ) {
+        return( -1 );
     }
 
-    // Insert block into cache after each write
-    putSGDataBlock(remNoteIdToBePassed, 
-                blockIdToBePassed, myData);
-
-    // 3) Return number of bytes written
-    // Log the write, return bytes written
-    return( len );
+    int ret = mySgWritev(fh, off, iov, iovcnt);
+    mySgUnlockFile(temp);
+    return( ret );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -328,28 +538,22 @@ int sgwrite(SgFHandle fh, char *buf, size_t len) {
 
 int sgseek(SgFHandle fh, size_t off) {
 
-    // 1) Check if file handle to see if assigned before, error if not
-    if ( fh < 0 || fh >= count ) {
+    // 1) Find the file, error if the handle is not open
+    pFile temp = mySgLockFile(fh);
+    if ( temp == NULL ) {
         return( -1 );
     }
 
-    // Find the corresponding file
-    pFile temp = myFile;
-    while ( temp != NULL ) {
-        if ( temp->fileHandle == fh ) {
-            break;
-        } else {
-            temp = temp->pNext;
-        }
-    }
-
     // 2) Check if seek position <= file size
-    if ( temp->filePtr <= temp->fileSize ) {
-
-        // 3) Set file position to the seek position
-        temp->filePtr = off;
+    if ( off > temp->fileSize ) {
+        mySgUnlockFile(temp);
+        return( -1 );
     }
 
+    // 3) Set file position to the seek position
+    temp->filePtr = off;
+    mySgUnlockFile(temp);
+
     // 4) Return the seek position
     // Return new position
     return( off );
@@ -365,36 +569,43 @@ int sgseek(SgFHandle fh, size_t off) {
 
 int sgclose(SgFHandle fh) {
 
-    // 1) Check if file handle to see if assigned before, error if not
-    if ( fh < 0 || fh >= count ) {
+    // 1) Find the file, error if the handle is not open (no call is using
+    // it once the table lock is held for writing)
+    pthread_once(&sgLockOnce, mySgInitLocks);
+    pthread_rwlock_wrlock(&sgTableLock);
+    pFile temp = mySgFindFile(fh);
+    if ( temp == NULL ) {
+        pthread_rwlock_unlock(&sgTableLock);
         return( -1 );
     }
 
-    pFile temp = myFile;
-    pFile prev = NULL;
-    
-    // Find the corresponding node and keep tracking previous and current node
-    while ( temp != NULL ) {
-        if ( temp->fileHandle == fh ) {
-            break;
-        } else {
-            prev = temp;
-            temp = temp->pNext; 
-        }
+    // Create the staged block and write back the file's modified blocks, a
+    // file whose data did not all reach its nodes stays open for a retry
+    if ( mySgFlushFile(fh) ) {
+        pthread_rwlock_unlock(&sgTableLock);
+        logMessage( LOG_ERROR_LEVEL, "sgclose: failed flushing file [%s], left open.", temp->filename );
+        return( -1 );
     }
 
     // 2) Clean up data structure, mark file as closed
-    if ( temp == myFile) {
-        myFile = myFile->pNext;
-    } else {
-        prev->pNext = temp->pNext;
+    pFile *prev = &pathBuckets[mySgHashPath(temp->filename) & pathMask];
+    while ( *prev != temp ) {
+        prev = &(*prev)->pathNext;
     }
+    *prev = temp->pathNext;
+
+    fileTable[fh] = NULL;
+    freeHandles[freeHandleCount++] = fh;
+    count--;
+    pthread_rwlock_unlock(&sgTableLock);
 
     temp->fileStatus = 0;
+    pthread_mutex_destroy(&temp->fileLock);
 
     free(temp->myIds);
     temp->myIds = NULL;
 
+    free((char *) temp->filename);
     free(temp);
     temp = NULL;
 
@@ -403,6 +614,145 @@ int sgclose(SgFHandle fh) {
     return( 0 );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgflush
+// Description  : Write the file's staged and modified (write-back) blocks to
+//                their nodes
+//
+// Inputs       : fh - the file handle of the file to flush
+// Outputs      : 0 if successful test, -1 if failure
+
+int sgflush(SgFHandle fh) {
+
+    pFile temp = mySgLockFile(fh);
+    if ( temp == NULL ) {
+        return( -1 );
+    }
+
+    int ret = mySgFlushFile(fh);
+    mySgUnlockFile(temp);
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgadvise
+// Description  : Tell the driver how a range of the file is used.  The
+//                stream advice (SEQUENTIAL, RANDOM, NOREUSE, NORMAL) holds
+//                for the whole file until the next, WILLNEED and DONTNEED
+//                act on the blocks of the range.
+//
+// Inputs       : fh - the file handle of the file
+//                off - the offset of the range
+//                len - the length of the range, 0 for the rest of the file
+//                advice - the access pattern
+// Outputs      : 0 if successful, -1 if failure
+
+int sgadvise( SgFHandle fh, size_t off, size_t len, SgAdvice advice ) {
+
+    pFile temp = mySgLockFile(fh);
+    if ( temp == NULL ) {
+        return( -1 );
+    }
+
+    int ret = mySgAdvise(temp, off, len, advice);
+    mySgUnlockFile(temp);
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgFlushFile
+// Description  : Write the file's staged and modified blocks to their nodes
+//                (the caller holds the file)
+//
+// Inputs       : fh - the file handle of the file to flush
+// Outputs      : 0 if successful, -1 if failure
+
+int mySgFlushFile( SgFHandle fh ) {
+
+    // Find the file, error if the handle is not open
+    pFile temp = mySgFindFile(fh);
+    if ( temp == NULL ) {
+        return( -1 );
+    }
+
+    // Create the partially written tail block
+    int ret = 0;
+    if ( mySgFlushStage(fh) ) {
+        ret = -1;
+    }
+
+    // The dirty blocks are taken out of the cache a window at a time and
+    // written back together
+    BatchBlock window[SG_BATCH_WINDOW];
+    char *windowData = NULL;
+    int count = 0;
+    if ( sgWriteBack && sgAioCurrent == NULL &&
+         (windowData = (char *) malloc(SG_BLOCK_SIZE * SG_BATCH_WINDOW)) == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgFlushFile: out of memory." );
+        return( -1 );
+    }
+
+    // Flush every block of the file that is dirty in the cache
+    for ( int i = 0; i < temp->idCount; i++ ) {
+        SG_Node_ID rem = temp->myIds[i].remNoteIdGot;
+        SG_Block_ID blk = temp->myIds[i].blockIdGot;
+        if ( blk == 0 ) {
+            continue;
+        }
+        if ( windowData == NULL ) {
+            if ( flushSGDataBlock(rem, blk) ) {
+                ret = -1;
+            }
+            continue;
+        }
+        window[count].data = &windowData[count * SG_BLOCK_SIZE];
+        if ( cleanSGDataBlock(rem, blk, window[count].data) == 0 ) {
+            window[count].blockCount = i;
+            window[count].rem = rem;
+            window[count].blk = blk;
+            count++;
+        }
+        if ( count == SG_BATCH_WINDOW ) {
+            if ( mySgFlushBlocks(window, count) ) {
+                ret = -1;
+            }
+            count = 0;
+        }
+    }
+    if ( count > 0 && mySgFlushBlocks(window, count) ) {
+        ret = -1;
+    }
+    free(windowData);
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgFlushBlocks
+// Description  : Write back blocks taken out of the cache, marking them
+//                dirty again if they could not be
+//
+// Inputs       : blocks - the blocks
+//                count - the number of blocks
+// Outputs      : 0 if successful, -1 if failure
+
+int mySgFlushBlocks( pBatchBlock blocks, int count ) {
+
+    if ( mySgPostBlocks(SG_UPDATE_BLOCK, blocks, count) == 0 ) {
+        return( 0 );
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        putSGDataBlock(blocks[i].rem, blocks[i].blk, blocks[i].data);
+        dirtySGDataBlock(blocks[i].rem, blocks[i].blk);
+    }
+    return( -1 );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : sgshutdown
@@ -413,6 +763,25 @@ int sgclose(SgFHandle fh) {
 
 int sgshutdown(void) {
 
+    pthread_once(&sgLockOnce, mySgInitLocks);
+    pthread_rwlock_wrlock(&sgTableLock);
+    int ret = mySgShutdown();
+    pthread_rwlock_unlock(&sgTableLock);
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgShutdown
+// Description  : Flush everything and stop the endpoint (the table lock is
+//                held for writing)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int mySgShutdown( void ) {
+
     // Local variables
     char initPacket[SG_BASE_PACKET_SIZE], recvPacket[SG_BASE_PACKET_SIZE];
     size_t pktlen, rpktlen;
@@ -422,10 +791,42 @@ int sgshutdown(void) {
     SG_System_OP op;
     SG_Packet_Status ret;
 
+    if ( !sgDriverInitialized ) {
+        return( -1 );
+    }
+
+    // Finish the asynchronous packets still in flight
+    while ( sgAioPackets > 0 ) {
+        mySgAioWait(1);
+    }
+
+    // Create the staged blocks of the open files
+    int flushed = 0;
+    for ( int i = 0; i < fileTableSize; i++ ) {
+        if ( fileTable[i] != NULL && mySgFlushStage(i) ) {
+            logMessage( LOG_ERROR_LEVEL, "sgshutdown: failed creating staged block." );
+            flushed = -1;
+        }
+    }
+
+    // Write back everything still dirty while the nodes are reachable
+    if ( flushSGCache() ) {
+        logMessage( LOG_ERROR_LEVEL, "sgshutdown: failed flushing dirty blocks." );
+        flushed = -1;
+    }
+
+    // Data that did not reach its nodes is kept, the driver stays up so a
+    // later shutdown can retry
+    if ( flushed ) {
+        logMessage( LOG_ERROR_LEVEL, "sgshutdown: unwritten data, driver left running." );
+        return( -1 );
+    }
+
     logMessage( LOG_INFO_LEVEL, "Stopping local endpoint ..." );
 
     // Setup the packet
     pktlen = SG_BASE_PACKET_SIZE;
+    pthread_mutex_lock(&sgServiceLock);
     if ( (ret = serialize_sg_packet( sgLocalNodeId, // Local ID
                                     SG_NODE_UNKNOWN,   // Remote ID
                                     SG_BLOCK_UNKNOWN,  // Block ID
@@ -433,13 +834,16 @@ int sgshutdown(void) {
                                     sgLocalSeqno,    // Sender sequence number
                                     SG_SEQNO_UNKNOWN,  // Receiver sequence number
                                     NULL, initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
         logMessage( LOG_ERROR_LEVEL, "mySgStopEndpoint: failed serialization of packet [%d].", ret );
         return( -1 );
     }
 
     // Send the packet
     rpktlen = SG_BASE_PACKET_SIZE;
-    if ( sgServicePost(initPacket, &pktlen, recvPacket, &rpktlen) ) {
+    int posted = sgPostPacket(SG_STOP_ENDPOINT, initPacket, &pktlen, recvPacket, &rpktlen);
+    pthread_mutex_unlock(&sgServiceLock);
+    if ( posted ) {
         logMessage( LOG_ERROR_LEVEL, "mySgStopEndpoint: failed packet post" );
         return( -1 );
     }
@@ -452,13 +856,59 @@ int sgshutdown(void) {
     }
 
     logMessage( LOG_INFO_LEVEL, "Stopped local node (local node ID %lu)", sgLocalNodeId );
+    logMessage( SGDriverLevel, "Driver packets: %d create, %d update, %d obtain (%d, %d, %d batched), %d ranges.",
+                sgOpCount[SG_CREATE_BLOCK], sgOpCount[SG_UPDATE_BLOCK], sgOpCount[SG_OBTAIN_BLOCK],
+                sgOpCount[SG_CREATE_BATCH], sgOpCount[SG_UPDATE_BATCH], sgOpCount[SG_OBTAIN_BATCH],
+                sgOpCount[SG_UPDATE_RANGE] );
+    logMessage( SGDriverLevel, "Driver readahead: %u blocks, %u misses coalesced.",
+                sgReadaheadCount, sgCoalescedCount );
+    logMessage( SGDriverLevel, "Driver compression: %u blocks sent compressed, %lu bytes saved.",
+                sgCompressedCount, sgCompressedSaved );
  
     // Print cache statics and free it
     closeSGCache();
+    sgTransport->close();
+
+    // Log the nodes used, clean up rseq structure
+    for ( int i = 0; i < SG_REM_TABLE_SIZE; i++ ) {
+        pRem node = &remTable[i];
+        if ( node->remNodeId != 0 ) {
+            logMessage( SGDriverLevel, "Node %lu: %u blocks, %u create, %u update, %u obtain (%u, %u, %u batched), %u ranges, window %u.",
+                        node->remNodeId, node->blocks, node->ops[SG_CREATE_BLOCK],
+                        node->ops[SG_UPDATE_BLOCK], node->ops[SG_OBTAIN_BLOCK],
+                        node->ops[SG_CREATE_BATCH], node->ops[SG_UPDATE_BATCH], node->ops[SG_OBTAIN_BATCH],
+                        node->ops[SG_UPDATE_RANGE], node->window );
+        }
+    }
+    memset(remTable, 0, sizeof(remTable));
+    remCount = 0;
+
+    // Free the waiters of the packets answered
+    while ( sgFreeWaiters != NULL ) {
+        pAioWaiter waiter = sgFreeWaiters;
+        sgFreeWaiters = waiter->pNext;
+        free(waiter);
+    }
 
-    // Clean up rseq structure
-    free(myRem);
-    myRem = NULL;
+    // Free the files left open and their tables, a later sgopen starts over
+    for ( int i = 0; i < fileTableSize; i++ ) {
+        if ( fileTable[i] != NULL ) {
+            pthread_mutex_destroy(&fileTable[i]->fileLock);
+            free(fileTable[i]->myIds);
+            free((char *) fileTable[i]->filename);
+            free(fileTable[i]);
+        }
+    }
+    free(fileTable);
+    free(freeHandles);
+    free(pathBuckets);
+    fileTable = NULL;
+    freeHandles = NULL;
+    pathBuckets = NULL;
+    fileTableSize = freeHandleCount = count = 0;
+    pathMask = 0;
+    memset(sgOpCount, 0, sizeof(sgOpCount));
+    sgDriverInitialized = 0;
 
     // Log, return successfully
     logMessage( LOG_INFO_LEVEL, "Shut down Scatter/Gather driver." );
@@ -468,592 +918,2851 @@ int sgshutdown(void) {
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : serialize_sg_packet
-// Description  : Serialize a ScatterGather packet (create packet)
+// Function     : sg_submit
+// Description  : Submit asynchronous requests.  Local work (cache, staging)
+//                is done now, the packets they need are posted without
+//                waiting and tracked by their sender sequence numbers.
 //
-// Inputs       : loc - the local node identifier
-//                rem - the remote node identifier
-//                blk - the block identifier
-//                op - the operation performed/to be performed on block
-//                sseq - the sender sequence number
-//                rseq - the receiver sequence number
-//                data - the data block (of size SG_BLOCK_SIZE) or NULL
-//                packet - the buffer to place the data
-//                plen - the packet length (int bytes)
-// Outputs      : 0 if successfully created, -1 if failure
+// Inputs       : reqs - the requests
+//                nreqs - the number of requests
+// Outputs      : number of requests submitted, -1 if failure
 
-SG_Packet_Status serialize_sg_packet(SG_Node_ID loc, SG_Node_ID rem, SG_Block_ID blk,
-                                     SG_System_OP op, SG_SeqNum sseq, SG_SeqNum rseq, char *data,
-                                     char *packet, size_t *plen) {
+int sg_submit( SgAioRequest *reqs, int nreqs ) {
 
-    // Check if packet data is bad
-    if ( packet == NULL) {
-        return SG_PACKT_PDATA_BAD;
+    if ( reqs == NULL || nreqs < 0 || !sgDriverInitialized ) {
+        return( -1 );
     }
 
-    int offset = 0;
-    uint32_t magic = SG_MAGIC_VALUE;
-    char dataIndicator;
-    *plen = 0;
-    
-
-    // Determine if data is empty
-    if ( data == NULL ){
-        dataIndicator = 0;
-    } else {
-        dataIndicator = 1;
-    }
+    for ( int i = 0; i < nreqs; i++ ) {
 
+        pAioRequest request = (pAioRequest) calloc(1, sizeof(AioRequest));
+        if ( request == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "sg_submit: out of memory." );
+            return( i > 0 ? i : -1 );
+        }
+        request->completion.userData = reqs[i].userData;
+        request->pending = 1; // Held until the submission is done
+        sgAioRequests++;
+
+        // Packets posted now belong to this request
+        struct iovec iov = { reqs[i].buf, reqs[i].len };
+        int ret = -1;
+        pFile temp = mySgLockFile(reqs[i].fh);
+        sgAioCurrent = request;
+        if ( temp != NULL ) {
+            switch ( reqs[i].op ) {
+            case SG_AIO_READ:
+                ret = mySgReadv(reqs[i].fh, reqs[i].off, &iov, 1);
+                break;
+            case SG_AIO_WRITE:
+                ret = mySgWritev(reqs[i].fh, reqs[i].off, &iov, 1);
+                break;
+            case SG_AIO_FLUSH:
+                ret = mySgFlushFile(reqs[i].fh);
+                break;
+            }
+            mySgUnlockFile(temp);
+        }
+        sgAioCurrent = NULL;
 
-    // Validate each element's status
-    if ( loc == 0 ){
-        return SG_PACKT_LOCID_BAD;
+        request->completion.result = ret;
+        if ( ret < 0 ) {
+            request->failed = 1;
+        }
+        mySgAioFinish(request);
     }
 
-    if ( rem == 0 ){
-        return SG_PACKT_REMID_BAD;
-    }
+    return( nreqs );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sg_reap
+// Description  : Collect completed asynchronous requests, in the order they
+//                complete
+//
+// Inputs       : comps - place to put the completions
+//                max - the size of comps
+//                minComplete - wait until this many are collected (or none
+//                              are left in flight)
+// Outputs      : number of completions collected, -1 if failure
+
+int sg_reap( SgAioCompletion *comps, int max, int minComplete ) {
+
+    int n = 0;
+
+    if ( comps == NULL || max < 0 ) {
+        return( -1 );
+    }
+
+    while ( n < max ) {
+
+        // Hand out finished requests first (other threads completing
+        // packets queue them)
+        pthread_mutex_lock(&sgServiceLock);
+        pAioRequest request = sgAioDone;
+        if ( request != NULL ) {
+            sgAioDone = request->pNext;
+            if ( sgAioDone == NULL ) {
+                sgAioDoneTail = NULL;
+            }
+        }
+        pthread_mutex_unlock(&sgServiceLock);
+        if ( request != NULL ) {
+            comps[n++] = request->completion;
+            sgAioRequests--;
+            free(request);
+            continue;
+        }
+
+        if ( n >= minComplete || sgAioPackets == 0 ) {
+            break;
+        }
+        mySgAioWait(1);
+    }
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgAioPostBlock
+// Description  : Post a block packet for an asynchronous request, completed
+//                later by mySgAioComplete once the transport has answered it.
+//                A block already being obtained is not asked for again, the
+//                request waits on the packet in flight (single flight).
+//
+// Inputs       : request - the request the packet belongs to
+//                op - SG_OBTAIN_BLOCK or SG_UPDATE_BLOCK
+//                rem - the remote node of the block
+//                blk - the block ID
+//                data - the block to send (UPDATE), NULL otherwise
+//                dest - where the obtained range goes (OBTAIN), NULL to only
+//                       cache the block
+//                start - the start of the range in the block
+//                end - the end of the range in the block
+// Outputs      : 0 if successfull, -1 if failure
+
+int mySgAioPostBlock( pAioRequest request, SG_System_OP op, SG_Node_ID rem, SG_Block_ID blk,
+                      char *data, char *dest, int start, int end ) {
+
+    // Local variables
+    SG_Packet_Vec initPacket;
+    size_t pktlen;
+    SG_Packet_Status ret;
+
+    // The slot of the next seqno may be taken by a packet a full window
+    // older, and the node takes no more than its window, the seqno is only
+    // taken once the packet can go (a node not seen yet gets its window now)
+    pthread_mutex_lock(&sgServiceLock);
+    pRem node = mySgFindRem(rem, 1);
+    AioPacket *slot;
+    while ( 1 ) {
+
+        // Join an obtain of the block in flight, its answer serves both
+        if ( op == SG_OBTAIN_BLOCK && (slot = mySgFindMiss(rem, blk)) != NULL ) {
+            if ( dest != NULL ) {
+                pAioWaiter waiter = sgFreeWaiters;
+                if ( waiter != NULL ) {
+                    sgFreeWaiters = waiter->pNext;
+                } else if ( (waiter = (pAioWaiter) malloc(sizeof(AioWaiter))) == NULL ) {
+                    pthread_mutex_unlock(&sgServiceLock);
+                    logMessage( LOG_ERROR_LEVEL, "mySgAioPostBlock: out of memory." );
+                    return( -1 );
+                }
+                waiter->request = request;
+                waiter->dest = dest;
+                waiter->start = start;
+                waiter->end = end;
+                waiter->pNext = slot->waiters;
+                slot->waiters = waiter;
+                request->pending++;
+            }
+            sgCoalescedCount++;
+            pthread_mutex_unlock(&sgServiceLock);
+            return( 0 );
+        }
+
+        if ( sgAioInFlight[(sgLocalSeqno != 0 ? sgLocalSeqno : 1) & (SG_AIO_MAX_INFLIGHT - 1)].request == NULL &&
+             (node == NULL || node->inFlight < node->window) ) {
+            break;
+        }
+        pthread_mutex_unlock(&sgServiceLock);
+        mySgAioWait(1);
+        pthread_mutex_lock(&sgServiceLock);
+    }
+    SG_SeqNum seqno = mySgNextSeqno();
+    slot = &sgAioInFlight[seqno & (SG_AIO_MAX_INFLIGHT - 1)];
+
+    // Setup the packet, the block is sent from the caller's buffer
+    if ( (ret = serialize_sg_packetv( sgLocalNodeId, // Local ID
+                                    rem,             // Remote ID
+                                    blk,             // Block ID
+                                    op,              // Operation
+                                    seqno,           // Sender sequence number
+                                    mySgRemoteSeqno(rem, op), // Receiver sequence number
+                                    data, &initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "mySgAioPostBlock: failed serialization of packet [%d].", ret );
+        return( -1 );
+    }
+
+    slot->request = request;
+    slot->op = op;
+    slot->rem = rem;
+    slot->blk = blk;
+    slot->dest = dest;
+    slot->start = start;
+    slot->end = end;
+    slot->rlen = 0;
+    request->pending++;
+    sgOpCount[op]++;
+
+    // A whole obtained block is received straight into the destination
+    slot->response.data = (op == SG_OBTAIN_BLOCK && dest != NULL && start == 0 && end == SG_BLOCK_SIZE) ?
+                          dest : slot->block;
+    if ( sgTransport->submitv(&initPacket, &slot->response, &slot->rlen, seqno) ) {
+        slot->request = NULL;
+        request->pending--;
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "mySgAioPostBlock: failed packet submit" );
+        return( -1 );
+    }
+    slot->sent = mySgNow();
+    if ( node != NULL ) {
+        node->inFlight++;
+    }
+    sgAioPackets++;
+
+    // Later misses of the block find it in flight
+    slot->waiters = NULL;
+    slot->missNext = -1;
+    if ( op == SG_OBTAIN_BLOCK ) {
+        int bucket = mySgMissBucket(rem, blk);
+        slot->missNext = sgMissBuckets[bucket];
+        sgMissBuckets[bucket] = seqno & (SG_AIO_MAX_INFLIGHT - 1);
+    }
+    pthread_mutex_unlock(&sgServiceLock);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgAioComplete
+// Description  : Finish a packet in flight, identified by its sender seqno
+//
+// Inputs       : seqno - the sender sequence number of the packet
+// Outputs      : 0 if successfull, -1 if failure
+
+int mySgAioComplete( SG_SeqNum seqno ) {
+
+    // Local variables
+    SG_Node_ID loc, rem;
+    SG_Block_ID blkid;
+    SG_SeqNum sloc, srem;
+    SG_System_OP op;
+    SG_Packet_Status ret;
+
+    AioPacket *slot = &sgAioInFlight[seqno & (SG_AIO_MAX_INFLIGHT - 1)];
+    pAioRequest request = slot->request;
+    if ( request == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgAioComplete: no packet in flight for seqno %u.", seqno );
+        return( -1 );
+    }
+
+    // Unpack the recieived data, the block is already in place
+    char *data = slot->response.data;
+    ret = deserialize_sg_packetv(&loc, &rem, &blkid, &op, &sloc, &srem, &slot->response, slot->rlen);
+    mySgWindowAnswer(slot->rem, seqno, mySgNow() - slot->sent, ret == SG_PACKT_OK);
+    if ( ret != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgAioComplete: failed deserialization of packet [%d]", ret );
+        request->failed = 1;
+    } else if ( slot->op == SG_OBTAIN_BLOCK ) {
+
+        if ( slot->dest != NULL && data != slot->dest ) {
+            memcpy(slot->dest, &data[slot->start], slot->end - slot->start);
+        }
+
+        // Cache the block unless a newer copy got there first, not while
+        // posting (the cache may be evicting)
+        if ( sgAioCurrent == NULL && !request->waited &&
+             probeSGDataBlock(slot->rem, slot->blk) ) {
+            putSGDataBlock(slot->rem, slot->blk, data);
+        }
+    }
+
+    // Once cached, the block is no longer looked for in flight, the misses
+    // that joined the packet get their ranges from the same answer
+    pAioWaiter waiter = NULL, next;
+    if ( slot->op == SG_OBTAIN_BLOCK ) {
+        pthread_mutex_lock(&sgServiceLock);
+        waiter = mySgUnlinkMiss(slot);
+        pthread_mutex_unlock(&sgServiceLock);
+    }
+    for ( ; waiter != NULL; waiter = next ) {
+        next = waiter->pNext;
+        if ( ret == SG_PACKT_OK ) {
+            memcpy(waiter->dest, &data[waiter->start], waiter->end - waiter->start);
+        } else {
+            waiter->request->failed = 1;
+        }
+        mySgAioFinish(waiter->request);
+
+        pthread_mutex_lock(&sgServiceLock);
+        waiter->pNext = sgFreeWaiters;
+        sgFreeWaiters = waiter;
+        pthread_mutex_unlock(&sgServiceLock);
+    }
+
+    // The slot is only free for the next packet once done with
+    mySgAioFinish(request);
+    __atomic_store_n(&slot->request, NULL, __ATOMIC_RELEASE);
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgAioFinish
+// Description  : Drop a pending count of a request, queue its completion
+//                when nothing is left
+//
+// Inputs       : request - the request
+// Outputs      : none
+
+void mySgAioFinish( pAioRequest request ) {
+
+    if ( __atomic_sub_fetch(&request->pending, 1, __ATOMIC_ACQ_REL) > 0 ) {
+        return;
+    }
+
+    if ( request->failed ) {
+        request->completion.result = -1;
+    }
+    request->pNext = NULL;
+
+    // Any thread completing packets may get here
+    pthread_mutex_lock(&sgServiceLock);
+    if ( sgAioDoneTail != NULL ) {
+        sgAioDoneTail->pNext = request;
+    } else {
+        sgAioDone = request;
+    }
+    sgAioDoneTail = request;
+    pthread_mutex_unlock(&sgServiceLock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgAioWait
+// Description  : Complete the packets the service has answered
+//
+// Inputs       : wait - wait for at least one if none is ready
+// Outputs      : number of packets completed
+
+int mySgAioWait( int wait ) {
+
+    SG_SeqNum tags[SG_AIO_MAX_INFLIGHT];
+    pthread_mutex_lock(&sgServiceLock);
+    int n = sgTransport->reap(tags, SG_AIO_MAX_INFLIGHT, wait);
+    sgAioPackets -= n;
+    pthread_mutex_unlock(&sgServiceLock);
+
+    // Nothing left in flight, the answers waited for are being completed by
+    // another thread, let it run
+    if ( n == 0 && wait ) {
+        sched_yield();
+    }
+
+    for ( int i = 0; i < n; i++ ) {
+        mySgAioComplete(tags[i]);
+    }
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgAioWaitBlock
+// Description  : Wait until no obtain of a block is in flight (the block is
+//                cached by then)
+//
+// Inputs       : rem - the remote node of the block
+//                blk - the block ID
+// Outputs      : 1 if it waited, 0 if nothing was in flight
+
+int mySgAioWaitBlock( SG_Node_ID rem, SG_Block_ID blk ) {
+
+    int waited = 0;
+
+    while ( 1 ) {
+        pthread_mutex_lock(&sgServiceLock);
+        AioPacket *slot = mySgFindMiss(rem, blk);
+        pthread_mutex_unlock(&sgServiceLock);
+
+        if ( slot == NULL ) {
+            return( waited );
+        }
+        mySgAioWait(1);
+        waited = 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgMissWait
+// Description  : Wait for the obtains in flight of the blocks of a range of
+//                a file (read ahead, or by asynchronous reads), before they
+//                are read or written
+//
+// Inputs       : file - the file
+//                first - the first block of the range
+//                last - the last block of the range
+// Outputs      : none
+
+void mySgMissWait( pFile file, int first, int last ) {
+
+    for ( int i = first; i <= last && __atomic_load_n(&sgAioPackets, __ATOMIC_ACQUIRE) > 0; i++ ) {
+        pIdGot ids = mySgFindIds(file, i);
+        if ( ids != NULL ) {
+            mySgAioWaitBlock(ids->remNoteIdGot, ids->blockIdGot);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgFindMiss
+// Description  : Find the obtain of a block in flight (the service lock is
+//                held)
+//
+// Inputs       : rem - the remote node of the block
+//                blk - the block ID
+// Outputs      : the packet's slot or NULL if none
+
+AioPacket *mySgFindMiss( SG_Node_ID rem, SG_Block_ID blk ) {
+
+    int bucket = mySgMissBucket(rem, blk);
+    for ( int i = sgMissBuckets[bucket]; i != -1; i = sgAioInFlight[i].missNext ) {
+        if ( sgAioInFlight[i].rem == rem && sgAioInFlight[i].blk == blk ) {
+            return( &sgAioInFlight[i] );
+        }
+    }
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgMissBucket
+// Description  : The bucket of the miss table a block hashes to
+//
+// Inputs       : rem - the remote node of the block
+//                blk - the block ID
+// Outputs      : the bucket
+
+int mySgMissBucket( SG_Node_ID rem, SG_Block_ID blk ) {
+
+    return( ((rem ^ (blk * 0x9e3779b97f4a7c15ULL)) >> 32) & (SG_AIO_MAX_INFLIGHT - 1) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgUnlinkMiss
+// Description  : Take an answered obtain out of the miss table (the service
+//                lock is held)
+//
+// Inputs       : slot - the slot of the packet
+// Outputs      : the misses waiting on it
+
+pAioWaiter mySgUnlinkMiss( AioPacket *slot ) {
+
+    int bucket = mySgMissBucket(slot->rem, slot->blk);
+    int index = slot - sgAioInFlight;
+    for ( int *link = &sgMissBuckets[bucket]; *link != -1; link = &sgAioInFlight[*link].missNext ) {
+        if ( *link == index ) {
+            *link = slot->missNext;
+            break;
+        }
+    }
+    slot->missNext = -1;
+
+    pAioWaiter waiters = slot->waiters;
+    slot->waiters = NULL;
+    return( waiters );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgReadahead
+// Description  : Follow the reads of a file, a read starting where the last
+//                one ended continues a stream whose next blocks are obtained
+//                in the background (cached when answered).  The window
+//                starts at SG_READAHEAD_MIN blocks and doubles with every
+//                read the blocks read ahead satisfied, up to sgReadaheadMax,
+//                and halves when the stream is abandoned.  Reads of a
+//                window or more are left alone, their blocks already travel
+//                together and single obtains ahead of them only slow them.
+//                A file advised RANDOM is never read ahead, one advised
+//                SEQUENTIAL keeps the largest window across seeks.
+//
+// Inputs       : file - the file read
+//                off - the offset of the read
+//                len - the bytes read
+//                missed - blocks of the read had to be obtained
+// Outputs      : none
+
+void mySgReadahead( pFile file, size_t off, size_t len, int missed ) {
+
+    int sequential = (off == file->raNext);
+    file->raNext = off + len;
+    if ( sgReadaheadMax == 0 || sgAioCurrent != NULL || file->advice == SG_ADVICE_RANDOM ) {
+        return;
+    }
+
+    // Another read, the next stream starts from a smaller window
+    if ( !sequential ) {
+        file->raBlock = 0;
+        if ( file->advice != SG_ADVICE_SEQUENTIAL ) {
+            file->raWindow /= 2;
+            return;
+        }
+    }
+    if ( len >= SG_READAHEAD_MIN * SG_BLOCK_SIZE ) {
+        return;
+    }
+
+    if ( file->advice == SG_ADVICE_SEQUENTIAL ) {
+        file->raWindow = sgReadaheadMax;
+    } else if ( file->raWindow < SG_READAHEAD_MIN ) {
+        file->raWindow = SG_READAHEAD_MIN;
+    } else if ( !missed ) {
+        file->raWindow *= 2;
+    }
+    if ( file->raWindow > sgReadaheadMax ) {
+        file->raWindow = sgReadaheadMax;
+    }
+
+    // Obtain the blocks of the window not cached or on their way yet
+    int next = (off + len + SG_BLOCK_SIZE - 1) / SG_BLOCK_SIZE;
+    int end = next + file->raWindow;
+    int blocks = (file->fileSize + SG_BLOCK_SIZE - 1) / SG_BLOCK_SIZE;
+    if ( end > blocks ) {
+        end = blocks;
+    }
+    if ( next < file->raBlock ) {
+        next = file->raBlock;
+    }
+    file->raBlock = mySgPrefetch(file, next, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgPrefetch
+// Description  : Obtain the blocks of a range of a file not cached in the
+//                background, cached when answered
+//
+// Inputs       : file - the file
+//                first - the first block of the range
+//                end - the block after the range
+// Outputs      : the first block not obtained (end if all were)
+
+int mySgPrefetch( pFile file, int first, int end ) {
+
+    int next;
+    for ( next = first; next < end; next++ ) {
+        pIdGot ids = mySgFindIds(file, next);
+        if ( next == file->stageBlock || ids == NULL ||
+             probeSGDataBlock(ids->remNoteIdGot, ids->blockIdGot) == 0 ) {
+            continue;
+        }
+        if ( mySgAioPostBlock(&sgReadahead, SG_OBTAIN_BLOCK, ids->remNoteIdGot,
+                              ids->blockIdGot, NULL, NULL, 0, SG_BLOCK_SIZE) ) {
+            break;
+        }
+        __atomic_fetch_add(&sgReadaheadCount, 1, __ATOMIC_RELAXED);
+    }
+    return( next );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgAdvise
+// Description  : Apply access pattern advice to a file (the caller holds it).
+//                WILLNEED obtains the range in the background (at most half
+//                the cache), DONTNEED writes back and drops its blocks, and
+//                the other advice changes how the file is read ahead and
+//                cached.
+//
+// Inputs       : file - the file
+//                off - the offset of the range
+//                len - the length of the range, 0 for the rest of the file
+//                advice - the access pattern
+// Outputs      : 0 if successful, -1 if failure
+
+int mySgAdvise( pFile file, size_t off, size_t len, SgAdvice advice ) {
+
+    SGCacheStats stats;
+    int ret = 0;
+
+    // The blocks of the range within the file
+    int blocks = (file->fileSize + SG_BLOCK_SIZE - 1) / SG_BLOCK_SIZE;
+    int first = off / SG_BLOCK_SIZE;
+    int end = (len == 0 || off + len > file->fileSize) ? blocks :
+              (off + len + SG_BLOCK_SIZE - 1) / SG_BLOCK_SIZE;
+
+    switch ( advice ) {
+    case SG_ADVICE_NORMAL:
+    case SG_ADVICE_RANDOM:
+    case SG_ADVICE_NOREUSE:
+        file->advice = advice;
+        file->raWindow = 0;
+        break;
+
+    case SG_ADVICE_SEQUENTIAL:
+        file->advice = advice;
+        file->raWindow = sgReadaheadMax;
+        break;
+
+    case SG_ADVICE_WILLNEED:
+        if ( getSGCacheStats(&stats) == 0 && end - first > (int) stats.capacity / 2 ) {
+            end = first + stats.capacity / 2;
+        }
+        if ( sgAioCurrent == NULL && first < end ) {
+            mySgPrefetch(file, first, end);
+        }
+        break;
+
+    case SG_ADVICE_DONTNEED:
+
+        // Blocks still being read ahead would come back once answered
+        mySgMissWait(file, first, end - 1);
+        for ( int i = first; i < end; i++ ) {
+            pIdGot ids = mySgFindIds(file, i);
+            if ( i != file->stageBlock && ids != NULL &&
+                 dropSGDataBlock(ids->remNoteIdGot, ids->blockIdGot) ) {
+                logMessage( LOG_ERROR_LEVEL, "mySgAdvise: failed dropping block %d of file [%s].",
+                            i, file->filename );
+                ret = -1;
+            }
+        }
+        file->raBlock = 0;
+        break;
+
+    default:
+        logMessage( LOG_ERROR_LEVEL, "mySgAdvise: bad advice [%d].", advice );
+        return( -1 );
+    }
+
+    return( ret );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgDemoteBlocks
+// Description  : Make the cached blocks of a range of a file (NOREUSE) the
+//                next ones evicted
+//
+// Inputs       : file - the file
+//                first - the first block of the range
+//                last - the last block of the range
+// Outputs      : none
+
+void mySgDemoteBlocks( pFile file, int first, int last ) {
+
+    for ( int i = first; i <= last; i++ ) {
+        pIdGot ids = mySgFindIds(file, i);
+        if ( i != file->stageBlock && ids != NULL ) {
+            demoteSGDataBlock(ids->remNoteIdGot, ids->blockIdGot);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgWindowAnswer
+// Description  : Account for an answered packet of a node's window, which
+//                grows by one per answer up to the threshold and by one per
+//                window of answers past it, and halves (once for the packets
+//                already sent) when a packet fails or the round trip grows
+//                well over the lowest seen, the service queueing them
+//
+// Inputs       : rem - the remote node of the packet
+//                seqno - the sender sequence number of the packet
+//                rtt - the round trip of the packet (ns)
+//                ok - the packet was answered
+// Outputs      : none
+
+void mySgWindowAnswer( SG_Node_ID rem, SG_SeqNum seqno, uint64_t rtt, int ok ) {
+
+    pthread_mutex_lock(&sgServiceLock);
+    pRem node = mySgFindRem(rem, 0);
+    if ( node == NULL ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        return;
+    }
+    node->inFlight--;
+
+    if ( !ok || (node->baseRtt != 0 && rtt > node->baseRtt * SG_WINDOW_DELAY) ) {
+        if ( node->backoff == 0 || (int16_t) (seqno - node->backoff) >= 0 ) {
+            node->threshold = (node->window > 1) ? node->window / 2 : 1;
+            node->window = node->threshold;
+            node->acked = 0;
+            node->backoff = sgLocalSeqno;
+        }
+    } else if ( node->window < node->threshold ) {
+        node->window++;
+    } else if ( ++node->acked >= node->window && node->window < SG_WINDOW_MAX ) {
+        node->window++;
+        node->acked = 0;
+    }
+    if ( ok && (node->baseRtt == 0 || rtt < node->baseRtt) ) {
+        node->baseRtt = rtt;
+    }
+    pthread_mutex_unlock(&sgServiceLock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgNow
+// Description  : Read the monotonic clock
+//
+// Inputs       : none
+// Outputs      : the time in nanoseconds
+
+uint64_t mySgNow( void ) {
+
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgNextSeqno
+// Description  : Take the next sender sequence number (0 is skipped when
+//                it wraps, serialize_sg_packet rejects it)
+//
+// Inputs       : none
+// Outputs      : the sequence number
+
+SG_SeqNum mySgNextSeqno( void ) {
+
+    SG_SeqNum seqno = __atomic_fetch_add(&sgLocalSeqno, 1, __ATOMIC_RELAXED);
+    if ( seqno == 0 ) {
+        seqno = __atomic_fetch_add(&sgLocalSeqno, 1, __ATOMIC_RELAXED);
+    }
+    return( seqno );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgRemoteSeqno
+// Description  : Take the next receiver sequence number of a remote node for
+//                a packet, counting the packet for the node
+//
+// Inputs       : rem - the remote node
+//                op - the operation of the packet
+// Outputs      : the sequence number, 0 if the node is unknown
+
+SG_SeqNum mySgRemoteSeqno( SG_Node_ID rem, SG_System_OP op ) {
+
+    // Find the rseq need to be passed
+    pRem node = mySgFindRem(rem, 0);
+    if ( node == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgRemoteSeqno: unknown node %lu.", rem );
+        return( 0 );
+    }
+
+    node->ops[op]++;
+    if ( ++node->sgRemoteseqno == 0 ) {
+        node->sgRemoteseqno++;
+    }
+    return( node->sgRemoteseqno );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgFindRem
+// Description  : Find a remote node in the node table (linear probing)
+//
+// Inputs       : rem - the remote node
+//                add - take an empty slot if the node is not there
+// Outputs      : the node, NULL if not found (or the table is full)
+
+pRem mySgFindRem( SG_Node_ID rem, int add ) {
+
+    uint32_t slot = (uint32_t) ((rem * 0x9e3779b97f4a7c15ULL) >> 32) & (SG_REM_TABLE_SIZE - 1);
+
+    while ( remTable[slot].remNodeId != 0 ) {
+        if ( remTable[slot].remNodeId == rem ) {
+            return( &remTable[slot] );
+        }
+        slot = (slot + 1) & (SG_REM_TABLE_SIZE - 1);
+    }
+
+    if ( !add ) {
+        return( NULL );
+    }
+    if ( remCount >= SG_REM_TABLE_LOAD ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgFindRem: more than %d remote nodes.", SG_REM_TABLE_LOAD );
+        return( NULL );
+    }
+
+    remTable[slot].remNodeId = rem;
+    remTable[slot].window = SG_WINDOW_INITIAL;
+    remTable[slot].threshold = SG_WINDOW_MAX;
+    remCount++;
+    return( &remTable[slot] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serialize_sg_packet
+// Description  : Serialize a ScatterGather packet (create packet)
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                blk - the block identifier
+//                op - the operation performed/to be performed on block
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                data - the data block (of size SG_BLOCK_SIZE) or NULL
+//                packet - the buffer to place the data
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status serialize_sg_packet(SG_Node_ID loc, SG_Node_ID rem, SG_Block_ID blk,
+                                     SG_System_OP op, SG_SeqNum sseq, SG_SeqNum rseq, char *data,
+                                     char *packet, size_t *plen) {
+
+    SG_Packet_Vec pv;
+    SG_Packet_Status ret;
+
+    // Check if packet data is bad
+    if ( packet == NULL) {
+        return SG_PACKT_PDATA_BAD;
+    }
+
+    // Lay out the fields, then flatten them around the block (compressed
+    // if it pays)
+    if ( (ret = serialize_sg_packetv(loc, rem, blk, op, sseq, rseq, data, &pv, plen)) != SG_PACKT_OK ) {
+        return( ret );
+    }
+    *plen = sgPacketGather(&pv, packet);
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : deserialize_sg_packet
+// Description  : De-serialize a ScatterGather packet (unpack packet)
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                blk - the block identifier
+//                op - the operation performed/to be performed on block
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                data - the data block (of size SG_BLOCK_SIZE) or NULL
+//                packet - the buffer to place the data
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status deserialize_sg_packet(SG_Node_ID *loc, SG_Node_ID *rem, SG_Block_ID *blk,
+                                       SG_System_OP *op, SG_SeqNum *sseq, SG_SeqNum *rseq, char *data,
+                                       char *packet, size_t plen) {
+
+    SG_Packet_Vec pv;
+    SG_Packet_Status ret;
+
+    // Check if packet data is bad
+    if ( packet == NULL) {
+        return SG_PACKT_PDATA_BAD;
+    }
+
+    // Split the packet, the block goes straight to data
+    pv.data = data;
+    if ( (ret = sgPacketScatter(&pv, packet, plen)) != SG_PACKT_OK ) {
+        return( ret );
+    }
+
+    return( deserialize_sg_packetv(loc, rem, blk, op, sseq, rseq, &pv, plen) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serialize_sg_packetv
+// Description  : Serialize a ScatterGather packet in pieces, the fields in
+//                one header and the block left where it is
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                blk - the block identifier
+//                op - the operation performed/to be performed on block
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                data - the data block (of size SG_BLOCK_SIZE) or NULL, it
+//                       must stay put until the packet is sent
+//                pv - the packet to fill in
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status serialize_sg_packetv(SG_Node_ID loc, SG_Node_ID rem, SG_Block_ID blk,
+                                      SG_System_OP op, SG_SeqNum sseq, SG_SeqNum rseq, char *data,
+                                      SG_Packet_Vec *pv, size_t *plen) {
+
+    // Check if packet data is bad
+    if ( pv == NULL ) {
+        return SG_PACKT_PDATA_BAD;
+    }
+    *plen = 0;
+
+    // Validate each element's status
+    if ( loc == 0 ){
+        return SG_PACKT_LOCID_BAD;
+    }
+
+    if ( rem == 0 ){
+        return SG_PACKT_REMID_BAD;
+    }
+
+    if ( blk == 0 ){
+        return SG_PACKT_BLKID_BAD;
+    }
+
+    if ( op < 0 || op > SG_DELETE_BLOCK ){
+        return SG_PACKT_OPERN_BAD;
+    }
+
+    if ( sseq == 0 ){
+        return SG_PACKT_SNDSQ_BAD;
+    }
+
+    if ( rseq == 0 ){
+        return SG_PACKT_RCVSQ_BAD;
+    }
+
+    // Fill in the header, the block is only referenced
+    pv->header.magic = SG_MAGIC_VALUE;
+    pv->header.locNodeId = loc;
+    pv->header.remNodeId = rem;
+    pv->header.blockID = blk;
+    pv->header.operation = op;
+    pv->header.sendSeqNo = sseq;
+    pv->header.recvSeqNo = rseq;
+    pv->header.dataIndicator = (data != NULL) ? 1 : 0;
+    pv->data = data;
+    pv->trailer = SG_MAGIC_VALUE;
+
+    // Set plen equals to packet size
+    *plen = (data != NULL) ? SG_DATA_PACKET_SIZE : SG_BASE_PACKET_SIZE;
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : deserialize_sg_packetv
+// Description  : De-serialize a ScatterGather packet received in pieces (the
+//                block, if any, is already in pv->data)
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                blk - the block identifier
+//                op - the operation performed/to be performed on block
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                pv - the packet received
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status deserialize_sg_packetv(SG_Node_ID *loc, SG_Node_ID *rem, SG_Block_ID *blk,
+                                        SG_System_OP *op, SG_SeqNum *sseq, SG_SeqNum *rseq,
+                                        SG_Packet_Vec *pv, size_t plen) {
+
+    // Check if packet data is bad
+    if ( pv == NULL ) {
+        return SG_PACKT_PDATA_BAD;
+    }
+    if ( plen < SG_BASE_PACKET_SIZE ) {
+        return SG_PACKT_BLKLN_BAD;
+    }
+
+    *loc = pv->header.locNodeId;
+    *rem = pv->header.remNodeId;
+    *blk = pv->header.blockID;
+    *op = pv->header.operation;
+    *sseq = pv->header.sendSeqNo;
+    *rseq = pv->header.recvSeqNo;
+
+    // Validate each element's status
+    if ( pv->header.dataIndicator == 1 && plen != SG_DATA_PACKET_SIZE){
+        return SG_PACKT_BLKLN_BAD;              // plen from input parameter doesn't have
+    }                                           // the correct value for packet size
+
+    if ( pv->header.dataIndicator == SG_DATA_COMPRESSED &&
+         (plen <= SG_BASE_PACKET_SIZE || plen > SG_BASE_PACKET_SIZE + SG_COMPRESS_LIMIT) ){
+        return SG_PACKT_BLKLN_BAD;
+    }
+
+    if ( *loc == 0 ){
+        return SG_PACKT_LOCID_BAD;
+    }
+
+    if ( *rem == 0 ){
+        return SG_PACKT_REMID_BAD;
+    }
+
+    if ( *blk == 0 ){
+        return SG_PACKT_BLKID_BAD;
+    }
+
+    if ( *op < 0 || *op > SG_DELETE_BLOCK ){
+        return SG_PACKT_OPERN_BAD;
+    }
+
+    if ( *sseq == 0 ){
+        return SG_PACKT_SNDSQ_BAD;
+    }
+
+    if ( *rseq == 0 ){
+        return SG_PACKT_RCVSQ_BAD;
+    }
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgPacketIov
+// Description  : Describe a packet in pieces for writev/sendmsg, a block
+//                compressed if it pays (the compressed pieces are the
+//                thread's, good until its next packet)
+//
+// Inputs       : pv - the packet
+//                iov - place for the pieces (SG_PACKET_IOV entries)
+// Outputs      : the number of pieces
+
+int sgPacketIov( SG_Packet_Vec *pv, struct iovec *iov ) {
+
+    int n = 0, packed = 0;
+
+    if ( pv->header.dataIndicator == 1 && (packed = mySgPackBlock(pv->data, sgPackedData)) > 0 ) {
+        sgPackedHeader = pv->header;
+        sgPackedHeader.dataIndicator = SG_DATA_COMPRESSED;
+    }
+
+    iov[n].iov_base = packed ? &sgPackedHeader : &pv->header;
+    iov[n++].iov_len = sizeof(SG_Packet_Header);
+    if ( pv->header.dataIndicator ) {
+        iov[n].iov_base = packed ? sgPackedData : pv->data;
+        iov[n++].iov_len = packed ? packed : SG_BLOCK_SIZE;
+    }
+    iov[n].iov_base = &pv->trailer;
+    iov[n++].iov_len = sizeof(uint32_t);
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgPacketGather
+// Description  : Flatten a packet in pieces into one buffer, a block
+//                compressed if it pays
+//
+// Inputs       : pv - the packet
+//                packet - the buffer (SG_DATA_PACKET_SIZE if it has a block)
+// Outputs      : the packet length
+
+size_t sgPacketGather( SG_Packet_Vec *pv, char *packet ) {
+
+    SG_Packet_Header header = pv->header;
+    size_t offset = sizeof(SG_Packet_Header);
+    int packed;
+
+    if ( header.dataIndicator == 1 && (packed = mySgPackBlock(pv->data, &packet[offset])) > 0 ) {
+        header.dataIndicator = SG_DATA_COMPRESSED;
+        offset += packed;
+    } else if ( header.dataIndicator ) {
+        memcpy(&packet[offset], pv->data, SG_BLOCK_SIZE);
+        offset += SG_BLOCK_SIZE;
+    }
+    memcpy(packet, &header, sizeof(SG_Packet_Header));
+    memcpy(&packet[offset], &pv->trailer, sizeof(uint32_t));
+
+    return( offset + sizeof(uint32_t) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgPacketScatter
+// Description  : Split a flat packet into pieces, the block straight to
+//                pv->data (expanded there if it came compressed)
+//
+// Inputs       : pv - the packet to fill in, data set to where a block goes
+//                packet - the flat packet
+//                plen - its length
+// Outputs      : SG_PACKT_OK, or the status if it does not split
+
+SG_Packet_Status sgPacketScatter( SG_Packet_Vec *pv, char *packet, size_t plen ) {
+
+    size_t offset = sizeof(SG_Packet_Header);
+
+    if ( plen < SG_BASE_PACKET_SIZE ) {
+        return( SG_PACKT_BLKLN_BAD );
+    }
+    memcpy(&pv->header, packet, sizeof(SG_Packet_Header));
+
+    // Check if the packet has a data block, the rest of a compressed packet
+    // is the block
+    if ( pv->header.dataIndicator == SG_DATA_COMPRESSED ) {
+        size_t packed = plen - SG_BASE_PACKET_SIZE;
+        if ( pv->data == NULL ) {
+            return( SG_PACKT_BLKDT_BAD );
+        }
+        if ( packed == 0 || packed > SG_COMPRESS_LIMIT ||
+             sgDecompress(&packet[offset], packed, pv->data, SG_BLOCK_SIZE) != SG_BLOCK_SIZE ) {
+            return( SG_PACKT_BLKLN_BAD );
+        }
+        offset += packed;
+    } else if ( pv->header.dataIndicator != 0 ) {
+        if ( pv->data == NULL ) {
+            return( SG_PACKT_BLKDT_BAD );
+        }
+        if ( plen < SG_DATA_PACKET_SIZE ) {
+            return( SG_PACKT_BLKLN_BAD );
+        }
+        memcpy(pv->data, &packet[offset], SG_BLOCK_SIZE);
+        offset += SG_BLOCK_SIZE;
+    }
+    memcpy(&pv->trailer, &packet[offset], sizeof(uint32_t));
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : setSGPacketCompression
+// Description  : Set whether the blocks of packets are sent compressed,
+//                each only if it shrinks to SG_COMPRESS_LIMIT (compressed
+//                blocks are taken either way)
+//
+// Inputs       : compress - send blocks compressed if set
+// Outputs      : none
+
+void setSGPacketCompression( int compress ) {
+
+    sgPacketCompression = compress;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgPackBlock
+// Description  : Compress a block to send, if compression is on and the
+//                block shrinks enough
+//
+// Inputs       : block - the block (SG_BLOCK_SIZE)
+//                packed - where the compressed block goes (SG_COMPRESS_LIMIT)
+// Outputs      : the compressed length, 0 if it is sent as it is
+
+int mySgPackBlock( char *block, char *packed ) {
+
+    if ( !sgPacketCompression ) {
+        return( 0 );
+    }
+
+    int len = sgCompress(block, SG_BLOCK_SIZE, packed, SG_COMPRESS_LIMIT);
+    if ( len > 0 ) {
+        __atomic_fetch_add(&sgCompressedCount, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sgCompressedSaved, SG_BLOCK_SIZE - len, __ATOMIC_RELAXED);
+    }
+    return( len );
+}
+
+//
+// Driver support functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serialize_sg_batch
+// Description  : Serialize a batched packet, the fields (the block ID is
+//                the number of blocks) then the block IDs, then the blocks
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                op - the operation (SG_CREATE_BATCH ... SG_OBTAIN_BATCH)
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                count - the number of blocks
+//                blks - the block IDs
+//                data - the blocks (each of size SG_BLOCK_SIZE) or NULL
+//                packet - the buffer to place the data (SG_BATCH_PACKET_SIZE)
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status serialize_sg_batch(SG_Node_ID loc, SG_Node_ID rem, SG_System_OP op,
+                                    SG_SeqNum sseq, SG_SeqNum rseq, int count, SG_Block_ID *blks,
+                                    char **data, char *packet, size_t *plen) {
+
+    SG_Packet_Header header;
+    uint32_t magic = SG_MAGIC_VALUE;
+    size_t offset = sizeof(SG_Packet_Header);
+
+    // Check if packet data is bad
+    if ( packet == NULL || blks == NULL ) {
+        return SG_PACKT_PDATA_BAD;
+    }
+    *plen = 0;
+
+    // Validate each element's status
+    if ( loc == 0 ){
+        return SG_PACKT_LOCID_BAD;
+    }
+
+    if ( rem == 0 ){
+        return SG_PACKT_REMID_BAD;
+    }
+
+    if ( op < SG_CREATE_BATCH || op > SG_OBTAIN_BATCH ){
+        return SG_PACKT_OPERN_BAD;
+    }
+
+    if ( sseq == 0 ){
+        return SG_PACKT_SNDSQ_BAD;
+    }
+
+    if ( rseq == 0 ){
+        return SG_PACKT_RCVSQ_BAD;
+    }
+
+    if ( count < 1 || count > SG_BATCH_MAX_BLOCKS ){
+        return SG_PACKT_BLKLN_BAD;
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        if ( blks[i] == 0 ) {
+            return SG_PACKT_BLKID_BAD;
+        }
+        if ( data != NULL && data[i] == NULL ) {
+            return SG_PACKT_BLKDT_BAD;
+        }
+    }
+
+    // Lay out the fields, the block IDs and the blocks
+    header.magic = SG_MAGIC_VALUE;
+    header.locNodeId = loc;
+    header.remNodeId = rem;
+    header.blockID = count;
+    header.operation = op;
+    header.sendSeqNo = sseq;
+    header.recvSeqNo = rseq;
+    header.dataIndicator = (data != NULL) ? 1 : 0;
+    memcpy(packet, &header, sizeof(SG_Packet_Header));
+    memcpy(&packet[offset], blks, sizeof(SG_Block_ID) * count);
+    offset += sizeof(SG_Block_ID) * count;
+    for ( int i = 0; data != NULL && i < count; i++ ) {
+        memcpy(&packet[offset], data[i], SG_BLOCK_SIZE);
+        offset += SG_BLOCK_SIZE;
+    }
+    memcpy(&packet[offset], &magic, sizeof(uint32_t));
+
+    // Set plen equals to packet size
+    *plen = offset + sizeof(uint32_t);
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : deserialize_sg_batch
+// Description  : De-serialize a batched packet, the blocks straight to where
+//                they go
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                op - the operation
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                count - the room in blks and data, set to the number of blocks
+//                blks - the block IDs
+//                data - where each block goes, or NULL if none are expected
+//                packet - the packet received
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status deserialize_sg_batch(SG_Node_ID *loc, SG_Node_ID *rem, SG_System_OP *op,
+                                      SG_SeqNum *sseq, SG_SeqNum *rseq, int *count, SG_Block_ID *blks,
+                                      char **data, char *packet, size_t plen) {
+
+    SG_Packet_Header header;
+    size_t offset = sizeof(SG_Packet_Header);
+    int room = *count;
+
+    // Check if packet data is bad
+    if ( packet == NULL || blks == NULL ) {
+        return SG_PACKT_PDATA_BAD;
+    }
+    *count = 0;
+    if ( plen < SG_BASE_PACKET_SIZE ) {
+        return SG_PACKT_BLKLN_BAD;
+    }
+    memcpy(&header, packet, sizeof(SG_Packet_Header));
+
+    *loc = header.locNodeId;
+    *rem = header.remNodeId;
+    *op = header.operation;
+    *sseq = header.sendSeqNo;
+    *rseq = header.recvSeqNo;
+
+    // The length follows from the number of blocks
+    if ( header.blockID < 1 || header.blockID > (SG_Block_ID) room ||
+         plen != SG_BASE_PACKET_SIZE + header.blockID * sizeof(SG_Block_ID) +
+                 (header.dataIndicator ? header.blockID * SG_BLOCK_SIZE : 0) ) {
+        return SG_PACKT_BLKLN_BAD;
+    }
+    if ( header.dataIndicator && data == NULL ) {
+        return SG_PACKT_BLKDT_BAD;
+    }
+    *count = (int) header.blockID;
+
+    memcpy(blks, &packet[offset], sizeof(SG_Block_ID) * *count);
+    offset += sizeof(SG_Block_ID) * *count;
+    for ( int i = 0; header.dataIndicator && i < *count; i++ ) {
+        memcpy(data[i], &packet[offset], SG_BLOCK_SIZE);
+        offset += SG_BLOCK_SIZE;
+    }
+
+    // Validate each element's status
+    if ( *loc == 0 ){
+        return SG_PACKT_LOCID_BAD;
+    }
+
+    if ( *rem == 0 ){
+        return SG_PACKT_REMID_BAD;
+    }
+
+    if ( *op < SG_CREATE_BATCH || *op > SG_OBTAIN_BATCH ){
+        return SG_PACKT_OPERN_BAD;
+    }
+
+    if ( *sseq == 0 ){
+        return SG_PACKT_SNDSQ_BAD;
+    }
+
+    if ( *rseq == 0 ){
+        return SG_PACKT_RCVSQ_BAD;
+    }
+
+    for ( int i = 0; i < *count; i++ ) {
+        if ( blks[i] == 0 ) {
+            return SG_PACKT_BLKID_BAD;
+        }
+    }
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serialize_sg_range
+// Description  : Serialize a partial update, the fields then the offset and
+//                length of the range in the block, then its bytes
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                blk - the block identifier
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                start - the offset of the range in the block
+//                len - the length of the range (0 for the answer)
+//                data - the bytes of the range, or NULL if none
+//                packet - the buffer to place the data (SG_DATA_PACKET_SIZE)
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status serialize_sg_range(SG_Node_ID loc, SG_Node_ID rem, SG_Block_ID blk,
+                                    SG_SeqNum sseq, SG_SeqNum rseq, uint16_t start, uint16_t len,
+                                    char *data, char *packet, size_t *plen) {
+
+    SG_Packet_Header header;
+    uint32_t magic = SG_MAGIC_VALUE;
+    size_t offset = sizeof(SG_Packet_Header);
+
+    // Check if packet data is bad
+    if ( packet == NULL ) {
+        return SG_PACKT_PDATA_BAD;
+    }
+    *plen = 0;
+
+    // Validate each element's status
+    if ( loc == 0 ){
+        return SG_PACKT_LOCID_BAD;
+    }
+
+    if ( rem == 0 ){
+        return SG_PACKT_REMID_BAD;
+    }
 
     if ( blk == 0 ){
         return SG_PACKT_BLKID_BAD;
     }
 
-    if ( op < 0 || op > 6 ){
-        return SG_PACKT_OPERN_BAD;
+    if ( sseq == 0 ){
+        return SG_PACKT_SNDSQ_BAD;
+    }
+
+    if ( rseq == 0 ){
+        return SG_PACKT_RCVSQ_BAD;
+    }
+
+    if ( len > SG_RANGE_MAX_LENGTH || start + len > SG_BLOCK_SIZE ){
+        return SG_PACKT_BLKLN_BAD;
+    }
+
+    if ( len > 0 && data == NULL ){
+        return SG_PACKT_BLKDT_BAD;
+    }
+
+    // Lay out the fields, the range and its bytes
+    header.magic = SG_MAGIC_VALUE;
+    header.locNodeId = loc;
+    header.remNodeId = rem;
+    header.blockID = blk;
+    header.operation = SG_UPDATE_RANGE;
+    header.sendSeqNo = sseq;
+    header.recvSeqNo = rseq;
+    header.dataIndicator = (len > 0) ? 1 : 0;
+    memcpy(packet, &header, sizeof(SG_Packet_Header));
+    memcpy(&packet[offset], &start, sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+    memcpy(&packet[offset], &len, sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+    if ( len > 0 ) {
+        memcpy(&packet[offset], data, len);
+        offset += len;
+    }
+    memcpy(&packet[offset], &magic, sizeof(uint32_t));
+
+    // Set plen equals to packet size
+    *plen = offset + sizeof(uint32_t);
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : deserialize_sg_range
+// Description  : De-serialize a partial update, the bytes straight to their
+//                place in the block
+//
+// Inputs       : loc - the local node identifier
+//                rem - the remote node identifier
+//                blk - the block identifier
+//                sseq - the sender sequence number
+//                rseq - the receiver sequence number
+//                start - the offset of the range in the block
+//                len - the length of the range
+//                data - the block the bytes go to (at start), or NULL if none
+//                       are expected
+//                packet - the packet received
+//                plen - the packet length (int bytes)
+// Outputs      : 0 if successfully created, -1 if failure
+
+SG_Packet_Status deserialize_sg_range(SG_Node_ID *loc, SG_Node_ID *rem, SG_Block_ID *blk,
+                                      SG_SeqNum *sseq, SG_SeqNum *rseq, uint16_t *start, uint16_t *len,
+                                      char *data, char *packet, size_t plen) {
+
+    SG_Packet_Header header;
+    size_t offset = sizeof(SG_Packet_Header);
+
+    // Check if packet data is bad
+    if ( packet == NULL ) {
+        return SG_PACKT_PDATA_BAD;
+    }
+    if ( plen < SG_BASE_PACKET_SIZE + 2 * sizeof(uint16_t) ) {
+        return SG_PACKT_BLKLN_BAD;
+    }
+    memcpy(&header, packet, sizeof(SG_Packet_Header));
+    memcpy(start, &packet[offset], sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+    memcpy(len, &packet[offset], sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+
+    *loc = header.locNodeId;
+    *rem = header.remNodeId;
+    *blk = header.blockID;
+    *sseq = header.sendSeqNo;
+    *rseq = header.recvSeqNo;
+
+    // The length follows from the range
+    if ( *len > SG_RANGE_MAX_LENGTH || *start + *len > SG_BLOCK_SIZE ||
+         plen != SG_BASE_PACKET_SIZE + 2 * sizeof(uint16_t) + *len ) {
+        return SG_PACKT_BLKLN_BAD;
+    }
+    if ( *len > 0 ) {
+        if ( data == NULL ) {
+            return SG_PACKT_BLKDT_BAD;
+        }
+        memcpy(&data[*start], &packet[offset], *len);
+    }
+
+    // Validate each element's status
+    if ( *loc == 0 ){
+        return SG_PACKT_LOCID_BAD;
+    }
+
+    if ( *rem == 0 ){
+        return SG_PACKT_REMID_BAD;
+    }
+
+    if ( *blk == 0 ){
+        return SG_PACKT_BLKID_BAD;
+    }
+
+    if ( header.operation != SG_UPDATE_RANGE ){
+        return SG_PACKT_OPERN_BAD;
+    }
+
+    if ( *sseq == 0 ){
+        return SG_PACKT_SNDSQ_BAD;
+    }
+
+    if ( *rseq == 0 ){
+        return SG_PACKT_RCVSQ_BAD;
+    }
+
+    return( SG_PACKT_OK );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgInitEndpoint
+// Description  : Initialize the endpoint
+//
+// Inputs       : none
+// Outputs      : 0 if successfull, -1 if failure
+
+int sgInitEndpoint( void ) {
+
+    // Local variables
+    char initPacket[SG_BASE_PACKET_SIZE], recvPacket[SG_BASE_PACKET_SIZE];
+    size_t pktlen, rpktlen;
+    SG_Node_ID loc, rem;
+    SG_Block_ID blkid;
+    SG_SeqNum sloc, srem;
+    SG_System_OP op;
+    SG_Packet_Status ret;
+
+    // Local and do some initial setup
+    logMessage( LOG_INFO_LEVEL, "Initializing local endpoint ..." );
+    sgLocalSeqno = SG_INITIAL_SEQNO;
+
+    // Setup the packet
+    pktlen = SG_BASE_PACKET_SIZE;
+    pthread_mutex_lock(&sgServiceLock);
+    if ( (ret = serialize_sg_packet( SG_NODE_UNKNOWN, // Local ID
+                                    SG_NODE_UNKNOWN,   // Remote ID
+                                    SG_BLOCK_UNKNOWN,  // Block ID
+                                    SG_INIT_ENDPOINT,  // Operation
+                                    mySgNextSeqno(),   // Sender sequence number
+                                    SG_SEQNO_UNKNOWN,  // Receiver sequence number
+                                    NULL, initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: failed serialization of packet [%d].", ret );
+        return( -1 );
+    }
+
+
+    // Send the packet
+    rpktlen = SG_BASE_PACKET_SIZE;
+    int posted = sgPostPacket(SG_INIT_ENDPOINT, initPacket, &pktlen, recvPacket, &rpktlen);
+    pthread_mutex_unlock(&sgServiceLock);
+    if ( posted ) {
+        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: failed packet post" );
+        return( -1 );
+    }
+
+    // Unpack the recieived data
+    if ( (ret = deserialize_sg_packet(&loc, &rem, &blkid, &op, &sloc, 
+                                    &srem, NULL, recvPacket, rpktlen)) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: failed deserialization of packet [%d]", ret );
+        return( -1 );
+    }
+
+    // Sanity check the return value
+    if ( loc == SG_NODE_UNKNOWN ) {
+        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: bad local ID returned [%ul]", loc );
+        return( -1 );
+    }
+
+    // Set the local node ID, log and return successfully
+    sgLocalNodeId = loc;
+    logMessage( LOG_INFO_LEVEL, "Completed initialization of node (local node ID %lu", sgLocalNodeId );
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgCreateBlock
+// Description  : Create a block, used when the staged block is written out
+//
+// Inputs       : fh - file handle for the file to write to
+//                buf - the block to create (SG_BLOCK_SIZE)
+//                blockCount - the index of the block in the file
+// Outputs      : 0 if successfull, -1 if failure
+
+int mySgCreateBlock( SgFHandle fh, char *buf, int blockCount ) {
+
+    // Find the corresponding file
+    pFile temp = mySgFindFile(fh);
+    SG_Node_ID rem;
+    SG_Block_ID blkid;
+    if ( temp == NULL ) {
+        return( -1 );
+    }
+
+    // 2a) Create a new block containing the contents of the write [SG_CREATE_BLOCK op]
+    if ( sgCreateRemoteBlock(buf, &rem, &blkid) ) {
+        return( -1 );
+    }
+
+    // 2b) Save node/block IDs as the current block in the data structure
+    if ( mySgSetIds(temp, blockCount, rem, blkid) ) {
+        return( -1 );
+    }
+
+    // The node has the block now, keep it in the cache (clean)
+    putSGDataBlock(rem, blkid, buf);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgSetIds
+// Description  : Record the node/block IDs of a created block of a file
+//
+// Inputs       : file - the file
+//                blockCount - the index of the block in the file
+//                rem - the node the block was created on
+//                blk - the block ID
+// Outputs      : 0 if successfull, -1 if failure
+
+int mySgSetIds( pFile file, int blockCount, SG_Node_ID rem, SG_Block_ID blk ) {
+
+    // Grow the block map to hold the block, doubling
+    if ( blockCount >= file->idCount ) {
+        int newCount = (file->idCount > 0) ? file->idCount : SG_BLOCK_MAP_INITIAL;
+        while ( newCount <= blockCount ) {
+            newCount *= 2;
+        }
+        pIdGot newIds = (pIdGot) realloc(file->myIds, sizeof(IdGot) * newCount);
+        if ( newIds == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "mySgSetIds: out of memory." );
+            return( -1 );
+        }
+        memset(&newIds[file->idCount], 0, sizeof(IdGot) * (newCount - file->idCount));
+        file->myIds = newIds;
+        file->idCount = newCount;
+    }
+
+    // Set the remote node ID and block ID
+    file->myIds[blockCount].blockIdGot = blk;
+    file->myIds[blockCount].remNoteIdGot = rem;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgCreateRemoteBlock
+// Description  : Create a block on the next node [SG_CREATE_BLOCK op]
+//
+// Inputs       : buf - the block to create (SG_BLOCK_SIZE)
+//                rem - set to the node the block was created on
+//                blk - set to the block ID
+// Outputs      : 0 if successfull, -1 if failure
+
+int sgCreateRemoteBlock( char *buf, SG_Node_ID *rem, SG_Block_ID *blk ) {
+
+    // Local variables
+    SG_Packet_Vec initPacket, recvPacket;
+    size_t pktlen, rpktlen;
+    SG_Node_ID loc;
+    SG_SeqNum sloc, srem;
+    SG_System_OP op;
+    SG_Packet_Status ret;
+
+    // Setup the packet, the block is sent from buf
+    pthread_mutex_lock(&sgServiceLock);
+    if ( (ret = serialize_sg_packetv( sgLocalNodeId,   // Local ID
+                                    SG_NODE_UNKNOWN,   // Remote ID
+                                    SG_BLOCK_UNKNOWN,  // Block ID
+                                    SG_CREATE_BLOCK,   // Operation
+                                    mySgNextSeqno(), // Sender sequence number
+                                    SG_SEQNO_UNKNOWN,  // Receiver sequence number
+                                    buf, &initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "sgCreateRemoteBlock: failed serialization of packet [%d].", ret );
+        return( -1 );
     }
 
-    if ( sseq == 0 ){
-        return SG_PACKT_SNDSQ_BAD;
+    // Send the packet
+    recvPacket.data = NULL;
+    if ( sgPostPacketv(SG_CREATE_BLOCK, &initPacket, &recvPacket, &rpktlen) ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "sgCreateRemoteBlock: failed packet post" );
+        return( -1 );
     }
 
-    if ( rseq == 0 ){
-        return SG_PACKT_RCVSQ_BAD;
+    // Unpack the recieived data
+    if ( (ret = deserialize_sg_packetv(&loc, rem, blk, &op, &sloc, 
+                                    &srem, &recvPacket, rpktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "sgCreateRemoteBlock: failed deserialization of packet [%d]", ret );
+        return( -1 );
     }
 
+    // Store the corresponding rseq to the remote node ID, the node answers
+    // a create with its current rseq (before another packet goes to it)
+    pRem node = mySgFindRem(*rem, 1);
+    if ( node == NULL ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        return( -1 );
+    }
+    node->sgRemoteseqno = srem;
+    node->blocks++;
+    node->ops[SG_CREATE_BLOCK]++;
+    pthread_mutex_unlock(&sgServiceLock);
 
-    // Copy data into the packet
-    memcpy(packet, &magic, sizeof(uint32_t));
-    offset += sizeof(uint32_t);
-    
-    memcpy(&packet[offset], &loc, sizeof(SG_Node_ID));
-    offset += sizeof(SG_Node_ID);
-    
-    memcpy(&packet[offset], &rem, sizeof(SG_Node_ID));
-    offset += sizeof(SG_Node_ID);
-    
-    memcpy(&packet[offset], &blk, sizeof(SG_Block_ID));
-    offset += sizeof(SG_Block_ID);
+    return( 0 );
+}
 
-    memcpy(&packet[offset], &op, sizeof(SG_System_OP));
-    offset += sizeof(SG_System_OP);
-    
-    memcpy(&packet[offset], &sseq, sizeof(SG_SeqNum));
-    offset += sizeof(SG_SeqNum);
-    
-    memcpy(&packet[offset], &rseq, sizeof(SG_SeqNum));
-    offset += sizeof(SG_SeqNum);
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgFlushStage
+// Description  : Create the block held in the file's staging buffer, appends
+//                collect there so a block costs one CREATE and no OBTAIN
+//
+// Inputs       : fh - file handle of the file
+// Outputs      : 0 if successfull (or nothing staged), -1 if failure
 
-    memcpy(&packet[offset], &dataIndicator, sizeof(char));
-    offset += sizeof(char);
+int mySgFlushStage( SgFHandle fh ) {
 
-    // Pass data to packet if data is not empty. Skip if it is empty
-    if ( data != NULL ){
-        memcpy(&packet[offset], data, sizeof(SGDataBlock));
-        offset += sizeof(SGDataBlock);
+    // Find the corresponding file
+    pFile temp = mySgFindFile(fh);
+    if ( temp == NULL || temp->stageBlock < 0 ) {
+        return( 0 );
     }
 
-    memcpy(&packet[offset], &magic, sizeof(uint32_t));
-    offset += sizeof(uint32_t);
+    if ( mySgCreateBlock(fh, temp->stageData, temp->stageBlock) ) {
+        return( -1 );
+    }
+    temp->stageBlock = -1;
 
-    // Set plen equals to packet size
-    *plen = offset;
+    return( 0 );
+}
 
-    return( SG_PACKT_OK );
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgReadv
+// Description  : Read a range of the file into buffers, gathering from every
+//                block the range touches
+//
+// Inputs       : fh - file handle for the file to read from
+//                off - the offset of the range in the file
+//                iov - the buffers to fill, in order
+//                iovcnt - the number of buffers
+// Outputs      : number of bytes read, -1 if failure
+
+int mySgReadv( SgFHandle fh, size_t off, const struct iovec *iov, int iovcnt ) {
+
+    // Find the corresponding file
+    pFile temp = mySgFindFile(fh);
+    if ( temp == NULL || iov == NULL || iovcnt < 0 ) {
+        return( -1 );
+    }
+
+    // 2) If the offset is at the end of the file, error reading beyond end of file 
+    if ( off >= temp->fileSize ) {
+        return( -1 );
+    }
+    size_t len = mySgIovLength(iov, iovcnt);
+    if ( len == 0 ) {
+        return( 0 );
+    }
+
+    // A read past the end returns what is there
+    if ( len > temp->fileSize - off ) {
+        len = temp->fileSize - off;
+    }
+
+    int first = off / SG_BLOCK_SIZE;
+    int last = (off + len - 1) / SG_BLOCK_SIZE;
+    int *missing = (int *) malloc(sizeof(int) * (last - first + 1));
+    int missCount = 0;
+    if ( missing == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgReadv: out of memory." );
+        return( -1 );
+    }
+
+    // Blocks read ahead or obtained by asynchronous reads may still be on
+    // their way, an asynchronous read joins their packets instead
+    if ( sgAioCurrent == NULL ) {
+        mySgMissWait(temp, first, last);
+    }
+
+    // 3) Copy the staged and cached blocks, remember the ones to retrieve
+    for ( int blockCount = first; blockCount <= last; blockCount++ ) {
+
+        int start = (blockCount == first) ? off % SG_BLOCK_SIZE : 0;
+        int end = (blockCount == last) ? (off + len - 1) % SG_BLOCK_SIZE + 1 : SG_BLOCK_SIZE;
+        size_t pos = (size_t) blockCount * SG_BLOCK_SIZE + start - off;
+
+        // The tail block may only exist in the staging buffer
+        if ( temp->stageBlock == blockCount ) {
+            mySgCopyIov(iov, iovcnt, pos, &temp->stageData[start], end - start, 1);
+            continue;
+        }
+
+        pIdGot ids = mySgFindIds(temp, blockCount);
+        if ( ids == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "mySgReadv: no block %d in file [%s].", blockCount, temp->filename );
+            free(missing);
+            return( -1 );
+        }
+
+        // A range held by one buffer is copied out of the cache into it, one
+        // split over buffers is scattered from the pinned block
+        char *dest = mySgIovSpan(iov, iovcnt, pos, end - start);
+        SGBlockRef ref;
+        if ( dest != NULL ) {
+            if ( readSGDataBlock(ids->remNoteIdGot, ids->blockIdGot, dest, start, end - start) ) {
+                missing[missCount++] = blockCount;
+            }
+        } else if ( pinSGDataBlock(ids->remNoteIdGot, ids->blockIdGot, &ref) == 0 ) {
+            mySgCopyIov(iov, iovcnt, pos, &ref.data[start], end - start, 1);
+            unpinSGDataBlock(&ref);
+        } else {
+            missing[missCount++] = blockCount;
+        }
+    }
+
+    // 4) 5) Retrieve the missing blocks together (in batches where the
+    // transport takes them), a whole block held by one buffer is unpacked
+    // into it directly, the others into scratch blocks
+    pBatchBlock blocks = NULL;
+    char *scratch = NULL;
+    int blockTotal = 0;
+    if ( missCount > 0 ) {
+        blocks = (pBatchBlock) malloc(sizeof(BatchBlock) * missCount);
+        scratch = (char *) malloc((size_t) SG_BLOCK_SIZE * missCount);
+        if ( blocks == NULL || scratch == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "mySgReadv: out of memory." );
+            free(blocks);
+            free(scratch);
+            free(missing);
+            return( -1 );
+        }
+    }
+    for ( int i = 0; i < missCount; i++ ) {
+
+        int blockCount = missing[i];
+        int start = (blockCount == first) ? off % SG_BLOCK_SIZE : 0;
+        int end = (blockCount == last) ? (off + len - 1) % SG_BLOCK_SIZE + 1 : SG_BLOCK_SIZE;
+        size_t pos = (size_t) blockCount * SG_BLOCK_SIZE + start - off;
+        char *block = NULL;
+
+        if ( start == 0 && end == SG_BLOCK_SIZE ) {
+            block = mySgIovSpan(iov, iovcnt, pos, SG_BLOCK_SIZE);
+        }
+        if ( block == NULL ) {
+            block = &scratch[(size_t) i * SG_BLOCK_SIZE];
+        }
+
+        pIdGot ids = mySgFindIds(temp, blockCount);
+
+        // An asynchronous request gets the range when the packet completes
+        char *dest = mySgIovSpan(iov, iovcnt, pos, end - start);
+        if ( sgAioCurrent != NULL && dest != NULL ) {
+            if ( mySgAioPostBlock(sgAioCurrent, SG_OBTAIN_BLOCK, ids->remNoteIdGot,
+                                  ids->blockIdGot, NULL, dest, start, end) ) {
+                free(blocks);
+                free(scratch);
+                free(missing);
+                return( -1 );
+            }
+            continue;
+        }
+
+        blocks[blockTotal].blockCount = blockCount;
+        blocks[blockTotal].rem = ids->remNoteIdGot;
+        blocks[blockTotal].blk = ids->blockIdGot;
+        blocks[blockTotal].data = block;
+        blockTotal++;
+    }
+
+    if ( mySgPostBlocks(SG_OBTAIN_BLOCK, blocks, blockTotal) ) {
+        free(blocks);
+        free(scratch);
+        free(missing);
+        return( -1 );
+    }
+
+    // Cache the blocks, copy the ranges retrieved into scratch blocks
+    for ( int i = 0; i < blockTotal; i++ ) {
+
+        int blockCount = blocks[i].blockCount;
+        int start = (blockCount == first) ? off % SG_BLOCK_SIZE : 0;
+        int end = (blockCount == last) ? (off + len - 1) % SG_BLOCK_SIZE + 1 : SG_BLOCK_SIZE;
+        size_t pos = (size_t) blockCount * SG_BLOCK_SIZE + start - off;
+
+        putSGDataBlock(blocks[i].rem, blocks[i].blk, blocks[i].data);
+        if ( start != 0 || end != SG_BLOCK_SIZE ||
+             blocks[i].data != mySgIovSpan(iov, iovcnt, pos, SG_BLOCK_SIZE) ) {
+            mySgCopyIov(iov, iovcnt, pos, &blocks[i].data[start], end - start, 1);
+        }
+    }
+    free(blocks);
+    free(scratch);
+    free(missing);
+
+    // Blocks used once make way for the others
+    if ( temp->advice == SG_ADVICE_NOREUSE ) {
+        mySgDemoteBlocks(temp, first, last);
+    }
+
+    // Read ahead if the read continues a stream
+    mySgReadahead(temp, off, len, missCount > 0);
+
+    // Return the bytes processed
+    return( len );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : deserialize_sg_packet
-// Description  : De-serialize a ScatterGather packet (unpack packet)
+// Function     : mySgWritev
+// Description  : Write buffers to a range of the file, scattering over every
+//                block the range touches
 //
-// Inputs       : loc - the local node identifier
-//                rem - the remote node identifier
-//                blk - the block identifier
-//                op - the operation performed/to be performed on block
-//                sseq - the sender sequence number
-//                rseq - the receiver sequence number
-//                data - the data block (of size SG_BLOCK_SIZE) or NULL
-//                packet - the buffer to place the data
-//                plen - the packet length (int bytes)
-// Outputs      : 0 if successfully created, -1 if failure
+// Inputs       : fh - file handle for the file to write to
+//                off - the offset of the range in the file (at most its size)
+//                iov - the buffers to write, in order
+//                iovcnt - the number of buffers
+// Outputs      : number of bytes written, -1 if failure
 
-SG_Packet_Status deserialize_sg_packet(SG_Node_ID *loc, SG_Node_ID *rem, SG_Block_ID *blk,
-                                       SG_System_OP *op, SG_SeqNum *sseq, SG_SeqNum *rseq, char *data,
-                                       char *packet, size_t plen) {
+int mySgWritev( SgFHandle fh, size_t off, const struct iovec *iov, int iovcnt ) {
 
-    // Check if packet data is bad
-    if ( packet == NULL) {
-        return SG_PACKT_PDATA_BAD;
+    // For transitional storage, the partly written first and last blocks and
+    // a whole block split over several buffers
+    char headData[SG_BLOCK_SIZE], tailData[SG_BLOCK_SIZE], myData[SG_BLOCK_SIZE];
+
+    // Find the corresponding file, no holes past the end
+    pFile temp = mySgFindFile(fh);
+    if ( temp == NULL || iov == NULL || iovcnt < 0 || off > temp->fileSize ) {
+        return( -1 );
+    }
+    size_t len = mySgIovLength(iov, iovcnt);
+    if ( len == 0 ) {
+        return( 0 );
     }
 
-    int offset = 0;
-    uint32_t magic = SG_MAGIC_VALUE;
-    char dataIndicator;
-    plen = (size_t)SG_BASE_PACKET_SIZE;
-    
+    int first = off / SG_BLOCK_SIZE;
+    int last = (off + len - 1) / SG_BLOCK_SIZE;
+    int newSize = off + len;
+    if ( newSize < temp->fileSize ) {
+        newSize = temp->fileSize;
+    }
 
-    // Get value in the packet first(unpacking)
-    memcpy(&magic, packet, sizeof(uint32_t));
-    offset += sizeof(uint32_t);
-    
-    memcpy(loc, &packet[offset], sizeof(SG_Node_ID));
-    offset += sizeof(SG_Node_ID);
+    // The updated blocks are queued from the back, and the new ones from the
+    // front where the transport takes batches, posted together at the end
+    // (write-back keeps updates in the cache), split whole blocks copied
+    // to a block of their own
+    int blockTotal = last - first + 1, createCount = 0, updateCount = 0;
+    int batching = (sgTransport->batchBlocks > 1 && sgAioCurrent == NULL);
+    int queueing = (sgAioCurrent == NULL && !sgWriteBack);
+    pBatchBlock queue = NULL;
+    char *copies = NULL;
+    int stageNew = -1, stageEnd = 0;
+    size_t stagePos = 0;
+    if ( (batching || queueing) &&
+         (queue = (pBatchBlock) malloc(sizeof(BatchBlock) * blockTotal)) == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgWritev: out of memory." );
+        return( -1 );
+    }
 
-    memcpy(rem, &packet[offset], sizeof(SG_Node_ID));
-    offset += sizeof(SG_Node_ID);
-    
-    memcpy(blk, &packet[offset], sizeof(SG_Block_ID));
-    offset += sizeof(SG_Block_ID);
+    // A block still being obtained must not land over the new contents
+    mySgMissWait(temp, first, last);
+
+    // 2) Retrieve the old contents of created blocks only partly overwritten
+    // (at most the first and the last), together before changing anything;
+    // where the service takes partial updates only the written range is
+    // sent, the old contents then only read if cached to keep it current
+    int headStart = off % SG_BLOCK_SIZE;
+    int tailEnd = (off + len - 1) % SG_BLOCK_SIZE + 1;
+    int headEnd = (first == last) ? tailEnd : SG_BLOCK_SIZE;
+    int ranges = (sgTransport->rangeUpdates && !sgWriteBack && sgAioCurrent == NULL);
+    int headRange = 0, headCached = 0, tailRange = 0, tailCached = 0;
+    pIdGot ids;
+    if ( (headStart != 0 || headEnd != SG_BLOCK_SIZE) &&
+         temp->stageBlock != first && (ids = mySgFindIds(temp, first)) != NULL ) {
+        if ( ranges && headEnd - headStart <= SG_RANGE_MAX_LENGTH ) {
+            headRange = 1;
+            headCached = (readSGDataBlock(ids->remNoteIdGot, ids->blockIdGot,
+                                          headData, 0, SG_BLOCK_SIZE) == 0);
+        } else if ( mySgObtainBlock(fh, first, headData) ) {
+            free(queue);
+            return( -1 );
+        }
+    }
+    if ( last != first && tailEnd != SG_BLOCK_SIZE &&
+         temp->stageBlock != last && (ids = mySgFindIds(temp, last)) != NULL ) {
+        if ( ranges && tailEnd <= SG_RANGE_MAX_LENGTH ) {
+            tailRange = 1;
+            tailCached = (readSGDataBlock(ids->remNoteIdGot, ids->blockIdGot,
+                                          tailData, 0, SG_BLOCK_SIZE) == 0);
+        } else if ( mySgObtainBlock(fh, last, tailData) ) {
+            free(queue);
+            return( -1 );
+        }
+    }
 
-    memcpy(op, &packet[offset], sizeof(SG_System_OP));
-    offset += sizeof(SG_System_OP);
+    // 3) Scatter the data over the blocks
+    for ( int blockCount = first; blockCount <= last; blockCount++ ) {
+
+        int start = (blockCount == first) ? headStart : 0;
+        int end = (blockCount == last) ? tailEnd : SG_BLOCK_SIZE;
+        size_t pos = (size_t) blockCount * SG_BLOCK_SIZE + start - off;
+        char *block = (blockCount == first) ? headData : tailData;
+
+        // Writes to the staged block stay local, created once it is full
+        if ( temp->stageBlock == blockCount ) {
+            mySgCopyIov(iov, iovcnt, pos, &temp->stageData[start], end - start, 0);
+            if ( newSize >= (blockCount + 1) * SG_BLOCK_SIZE && mySgFlushStage(fh) ) {
+                free(queue);
+                free(copies);
+                return( -1 );
+            }
+            continue;
+        }
 
-    memcpy(sseq, &packet[offset], sizeof(SG_SeqNum));
-    offset += sizeof(SG_SeqNum);
-    
-    memcpy(rseq, &packet[offset], sizeof(SG_SeqNum));
-    offset += sizeof(SG_SeqNum);
+        // A whole block is sent straight from the buffer holding it
+        if ( start == 0 && end == SG_BLOCK_SIZE ) {
+            block = mySgIovSpan(iov, iovcnt, pos, SG_BLOCK_SIZE);
+            if ( block == NULL && queue != NULL ) {
+                if ( copies == NULL &&
+                     (copies = (char *) malloc((size_t) SG_BLOCK_SIZE * blockTotal)) == NULL ) {
+                    logMessage( LOG_ERROR_LEVEL, "mySgWritev: out of memory." );
+                    free(queue);
+                    return( -1 );
+                }
+                block = &copies[(size_t) (blockCount - first) * SG_BLOCK_SIZE];
+                mySgCopyIov(iov, iovcnt, pos, block, SG_BLOCK_SIZE, 0);
+            } else if ( block == NULL ) {
+                block = myData;
+                mySgCopyIov(iov, iovcnt, pos, block, SG_BLOCK_SIZE, 0);
+            }
+        }
 
-    memcpy(&dataIndicator, &packet[offset], sizeof(char));
-    offset += sizeof(char);
-    
-    // Check if the packet has a data block
-    if ( dataIndicator != 0){
-        memcpy(data, &packet[offset], sizeof(SGDataBlock));
-        offset += sizeof(SGDataBlock);
+        // Created blocks are updated, a partly written one by its range alone
+        ids = mySgFindIds(temp, blockCount);
+        if ( ids != NULL ) {
+            if ( start != 0 || end != SG_BLOCK_SIZE ) {
+                mySgCopyIov(iov, iovcnt, pos, &block[start], end - start, 0);
+            }
+            int range = (blockCount == first) ? headRange : (blockCount == last) ? tailRange : 0;
+            if ( range ) {
+                if ( sgUpdateRemoteRange(ids->remNoteIdGot, ids->blockIdGot, block, start, end) ) {
+                    free(queue);
+                    free(copies);
+                    return( -1 );
+                }
+                if ( (blockCount == first) ? headCached : tailCached ) {
+                    putSGDataBlock(ids->remNoteIdGot, ids->blockIdGot, block);
+                }
+                continue;
+            }
+            if ( queueing ) {
+                updateCount++;
+                queue[blockTotal - updateCount].blockCount = blockCount;
+                queue[blockTotal - updateCount].rem = ids->remNoteIdGot;
+                queue[blockTotal - updateCount].blk = ids->blockIdGot;
+                queue[blockTotal - updateCount].data = block;
+            } else if ( mySgUpdateBlock(fh, blockCount, block) ) {
+                free(queue);
+                free(copies);
+                return( -1 );
+            }
+            continue;
+        }
 
-        // If the packet has a data block, but data pointer(input) is NULL
-        if ( data == NULL ){
-            return SG_PACKT_BLKDT_BAD;
+        // New whole blocks are created directly
+        if ( end == SG_BLOCK_SIZE ) {
+            if ( batching ) {
+                queue[createCount].blockCount = blockCount;
+                queue[createCount].data = block;
+                createCount++;
+            } else if ( mySgCreateBlock(fh, block, blockCount) ) {
+                free(queue);
+                free(copies);
+                return( -1 );
+            } else if ( (blockCount + 1) * SG_BLOCK_SIZE > temp->fileSize ) {
+
+                // The file covers the blocks it records, should a later one fail
+                temp->fileSize = (blockCount + 1) * SG_BLOCK_SIZE;
+            }
+            continue;
         }
+
+        // A new partial block (the last one) opens the staging buffer, once
+        // the blocks before it exist
+        stageNew = blockCount;
+        stagePos = pos;
+        stageEnd = end;
     }
 
-    memcpy(&magic, &packet[offset], sizeof(uint32_t));
-    offset += sizeof(uint32_t);
+    // Create the queued blocks and record them, then update the others
+    int ret = mySgPostBlocks(SG_CREATE_BLOCK, queue, createCount);
+    for ( int i = 0; ret == 0 && i < createCount; i++ ) {
+        if ( (ret = mySgSetIds(temp, queue[i].blockCount, queue[i].rem, queue[i].blk)) == 0 ) {
+            putSGDataBlock(queue[i].rem, queue[i].blk, queue[i].data);
+            if ( (queue[i].blockCount + 1) * SG_BLOCK_SIZE > temp->fileSize ) {
+                temp->fileSize = (queue[i].blockCount + 1) * SG_BLOCK_SIZE;
+            }
+        }
+    }
+    if ( ret == 0 && updateCount > 0 ) {
+        ret = mySgPostBlocks(SG_UPDATE_BLOCK, &queue[blockTotal - updateCount], updateCount);
+    }
+    for ( int i = blockTotal - updateCount; ret == 0 && i < blockTotal; i++ ) {
+        putSGDataBlock(queue[i].rem, queue[i].blk, queue[i].data);
+    }
+    free(queue);
+    free(copies);
+    if ( ret ) {
+        return( -1 );
+    }
+    if ( stageNew != -1 ) {
+        if ( mySgFlushStage(fh) ) {
+            return( -1 );
+        }
+        memset(temp->stageData, 0, SG_BLOCK_SIZE);
+        mySgCopyIov(iov, iovcnt, stagePos, temp->stageData, stageEnd, 0);
+        temp->stageBlock = stageNew;
+    }
+    if ( temp->advice == SG_ADVICE_NOREUSE ) {
+        mySgDemoteBlocks(temp, first, last);
+    }
 
-    // Set plen equals to input packet size
-    plen = offset;
+    // 4) Extend the file, return number of bytes written
+    temp->fileSize = newSize;
+    return( len );
+}
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgIovLength
+// Description  : Total length of a set of buffers
+//
+// Inputs       : iov - the buffers
+//                iovcnt - the number of buffers
+// Outputs      : the number of bytes
 
-    // Validate each element's status
-    if ( dataIndicator == 1 && plen != SG_DATA_PACKET_SIZE){
-        return SG_PACKT_BLKLN_BAD;              // plen from input parameter doesn't have
-    }                                           // the correct value for packet size
+size_t mySgIovLength( const struct iovec *iov, int iovcnt ) {
 
-    if ( *loc == 0 ){
-        return SG_PACKT_LOCID_BAD;
+    size_t len = 0;
+    for ( int i = 0; i < iovcnt; i++ ) {
+        len += iov[i].iov_len;
     }
+    return( len );
+}
 
-    if ( *rem == 0 ){
-        return SG_PACKT_REMID_BAD;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgIovSpan
+// Description  : Find a range of the buffers if it lies within one of them
+//
+// Inputs       : iov - the buffers
+//                iovcnt - the number of buffers
+//                pos - the offset of the range in the buffers
+//                len - the length of the range
+// Outputs      : pointer to the range, NULL if it is split or out of range
+
+char *mySgIovSpan( const struct iovec *iov, int iovcnt, size_t pos, size_t len ) {
+
+    for ( int i = 0; i < iovcnt; i++ ) {
+        if ( pos < iov[i].iov_len ) {
+            if ( pos + len <= iov[i].iov_len ) {
+                return( (char *) iov[i].iov_base + pos );
+            }
+            return( NULL );
+        }
+        pos -= iov[i].iov_len;
     }
+    return( NULL );
+}
 
-    if ( *blk == 0 ){
-        return SG_PACKT_BLKID_BAD;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgCopyIov
+// Description  : Copy between a block and a range of the buffers
+//
+// Inputs       : iov - the buffers
+//                iovcnt - the number of buffers
+//                pos - the offset of the range in the buffers
+//                block - the block data
+//                len - the length of the range
+//                toIov - 1 to copy into the buffers, 0 to copy out of them
+// Outputs      : none
+
+void mySgCopyIov( const struct iovec *iov, int iovcnt, size_t pos, char *block, size_t len, int toIov ) {
+
+    for ( int i = 0; i < iovcnt && len > 0; i++ ) {
+
+        // Skip the buffers before the range
+        if ( pos >= iov[i].iov_len ) {
+            pos -= iov[i].iov_len;
+            continue;
+        }
+
+        size_t n = iov[i].iov_len - pos;
+        if ( n > len ) {
+            n = len;
+        }
+        if ( toIov ) {
+            memcpy((char *) iov[i].iov_base + pos, block, n);
+        } else {
+            memcpy(block, (char *) iov[i].iov_base + pos, n);
+        }
+        block += n;
+        len -= n;
+        pos = 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgObtainBlock
+// Description  : Obtain a block of the file, from the cache if possible
+//
+// Inputs       : fh - file handle for the file to read from
+//                blockCount - the index of the block in the file
+//                buf - place to put the data (SG_BLOCK_SIZE)
+// Outputs      : 0 if successfull, -1 if failure
+
+int mySgObtainBlock( SgFHandle fh, int blockCount, char *buf ) {
+
+    // Find the corresponding IDs
+    pIdGot ids = mySgFindIds(mySgFindFile(fh), blockCount);
+    if ( ids == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgObtainBlock: no block %d in file %d.", blockCount, fh );
+        return( -1 );
+    }
+
+    // Check if there is corresponding data in the cache, copied into buf
+    if ( readSGDataBlock(ids->remNoteIdGot, ids->blockIdGot, buf, 0, SG_BLOCK_SIZE) == 0 ) {
+        return( 0 );
+    }
+
+    // Retrieve the block [SG_OBTAIN_BLOCK op]
+    if ( sgObtainRemoteBlock(ids->remNoteIdGot, ids->blockIdGot, buf) ) {
+        return( -1 );
     }
 
-    if ( *op < 0 || *op > 6 ){
-        return SG_PACKT_OPERN_BAD;
-    }
+    // If there is not corresponding data in the cache, update block info to cache
+    putSGDataBlock(ids->remNoteIdGot, ids->blockIdGot, buf);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgUpdateBlock
+// Description  : Update a block of the file, only in the cache (marked dirty)
+//                in write-back mode
+//
+// Inputs       : fh - file handle for the file to write to
+//                blockCount - the index of the block in the file
+//                buf - the new block contents (SG_BLOCK_SIZE)
+// Outputs      : 0 if successfull, -1 if failure
+
+int mySgUpdateBlock( SgFHandle fh, int blockCount, char *buf ) {
+
+    // Find the corresponding IDs
+    pIdGot ids = mySgFindIds(mySgFindFile(fh), blockCount);
+    if ( ids == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgUpdateBlock: no block %d in file %d.", blockCount, fh );
+        return( -1 );
+    }
+
+    // Write-back, the block is sent when evicted or flushed
+    if ( sgWriteBack && putSGDataBlock(ids->remNoteIdGot, ids->blockIdGot, buf) == 0 &&
+         dirtySGDataBlock(ids->remNoteIdGot, ids->blockIdGot) == 0 ) {
+        return( 0 );
+    }
+
+    if ( sgUpdateRemoteBlock(ids->remNoteIdGot, ids->blockIdGot, buf) ) {
+        return( -1 );
+    }
+
+    // Keep the cache in step with the node
+    putSGDataBlock(ids->remNoteIdGot, ids->blockIdGot, buf);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgPostBlocks
+// Description  : Create, update or obtain the blocks of a call, grouping
+//                them by node into batches when the transport takes them
+//                (the blocks are reordered, each group posted as one packet)
+//                and pipelining the blocks left alone in the node windows
+//
+// Inputs       : op - SG_CREATE_BLOCK, SG_UPDATE_BLOCK or SG_OBTAIN_BLOCK
+//                blocks - the blocks
+//                count - the number of blocks
+// Outputs      : 0 if successfull, -1 if failure
+
+int mySgPostBlocks( SG_System_OP op, pBatchBlock blocks, int count ) {
+
+    int most = (sgAioCurrent == NULL) ? sgTransport->batchBlocks : 0;
+    int i, n, ret = 0;
+
+    // Creations wait for the node to answer with its rseq, the others are
+    // answered by seqno, still pending until waited for below
+    AioRequest pipeline;
+    memset(&pipeline, 0, sizeof(AioRequest));
+    pipeline.pending = 1;
+    pipeline.waited = 1;
+    int pipelined = (op != SG_CREATE_BLOCK && sgAioCurrent == NULL && count > 1);
+
+    for ( i = 0; i < count && ret == 0; i += n ) {
+
+        // Bring the next blocks of the same node up behind this one (all
+        // creations go to the node the service picks)
+        n = 1;
+        for ( int j = i + 1; j < count && n < most; j++ ) {
+            if ( op == SG_CREATE_BLOCK || blocks[j].rem == blocks[i].rem ) {
+                BatchBlock swap = blocks[i + n];
+                blocks[i + n] = blocks[j];
+                blocks[j] = swap;
+                n++;
+            }
+        }
 
-    if ( *sseq == 0 ){
-        return SG_PACKT_SNDSQ_BAD;
+        if ( n > 1 ) {
+            SG_System_OP batch = (op == SG_CREATE_BLOCK) ? SG_CREATE_BATCH :
+                                 (op == SG_UPDATE_BLOCK) ? SG_UPDATE_BATCH : SG_OBTAIN_BATCH;
+            ret = sgBatchRemoteBlocks(batch, &blocks[i], n);
+        } else if ( op == SG_CREATE_BLOCK ) {
+            ret = sgCreateRemoteBlock(blocks[i].data, &blocks[i].rem, &blocks[i].blk);
+        } else if ( pipelined ) {
+            ret = mySgAioPostBlock(&pipeline, op, blocks[i].rem, blocks[i].blk,
+                                   (op == SG_UPDATE_BLOCK) ? blocks[i].data : NULL,
+                                   blocks[i].data, 0, SG_BLOCK_SIZE);
+            mySgAioWait(0);
+        } else if ( op == SG_UPDATE_BLOCK ) {
+            ret = sgUpdateRemoteBlock(blocks[i].rem, blocks[i].blk, blocks[i].data);
+        } else {
+            ret = sgObtainRemoteBlock(blocks[i].rem, blocks[i].blk, blocks[i].data);
+        }
     }
 
-    if ( *rseq == 0 ){
-        return SG_PACKT_RCVSQ_BAD;
+    // Wait for the pipelined blocks
+    while ( __atomic_load_n(&pipeline.pending, __ATOMIC_ACQUIRE) > 1 ) {
+        mySgAioWait(1);
     }
 
-    return( SG_PACKT_OK );
+    return( (ret || pipeline.failed) ? -1 : 0 );
 }
 
-//
-// Driver support functions
-
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : sgInitEndpoint
-// Description  : Initialize the endpoint
+// Function     : sgObtainRemoteBlock
+// Description  : Retrieve a block from its node [SG_OBTAIN_BLOCK op]
 //
-// Inputs       : none
+// Inputs       : rem - the remote node of the block
+//                blk - the block ID
+//                buf - place to put the data (SG_BLOCK_SIZE)
 // Outputs      : 0 if successfull, -1 if failure
 
-int sgInitEndpoint( void ) {
+int sgObtainRemoteBlock( SG_Node_ID rem, SG_Block_ID blk, char *buf ) {
 
     // Local variables
-    char initPacket[SG_BASE_PACKET_SIZE], recvPacket[SG_BASE_PACKET_SIZE];
+    SG_Packet_Vec initPacket, recvPacket;
     size_t pktlen, rpktlen;
-    SG_Node_ID loc, rem;
+    SG_Node_ID loc, remId;
     SG_Block_ID blkid;
     SG_SeqNum sloc, srem;
     SG_System_OP op;
     SG_Packet_Status ret;
-
-    // Local and do some initial setup
-    logMessage( LOG_INFO_LEVEL, "Initializing local endpoint ..." );
-    sgLocalSeqno = SG_INITIAL_SEQNO;
+    
+    // Find the rseq need to be passed
+    pthread_mutex_lock(&sgServiceLock);
+    SG_SeqNum rseqToBePassed = mySgRemoteSeqno(rem, SG_OBTAIN_BLOCK);
 
     // Setup the packet
-    pktlen = SG_BASE_PACKET_SIZE;
-    if ( (ret = serialize_sg_packet( SG_NODE_UNKNOWN, // Local ID
-                                    SG_NODE_UNKNOWN,   // Remote ID
-                                    SG_BLOCK_UNKNOWN,  // Block ID
-                                    SG_INIT_ENDPOINT,  // Operation
-                                    sgLocalSeqno++,    // Sender sequence number
-                                    SG_SEQNO_UNKNOWN,  // Receiver sequence number
-                                    NULL, initPacket, &pktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: failed serialization of packet [%d].", ret );
-        return( -1 );
-    }
-
-
-    // Send the packet
-    rpktlen = SG_BASE_PACKET_SIZE;
-    if ( sgServicePost(initPacket, &pktlen, recvPacket, &rpktlen) ) {
-        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: failed packet post" );
+    if ( (ret = serialize_sg_packetv( sgLocalNodeId, // Local ID
+                                    rem,            // Remote ID
+                                    blk,            // Block ID
+                                    SG_OBTAIN_BLOCK,  // Operation
+                                    mySgNextSeqno(), // Sender sequence number
+                                    rseqToBePassed, // Receiver sequence number
+                                    NULL, &initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "sgObtainRemoteBlock: failed serialization of packet [%d].", ret );
         return( -1 );
     }
 
-    // Unpack the recieived data
-    if ( (ret = deserialize_sg_packet(&loc, &rem, &blkid, &op, &sloc, 
-                                    &srem, NULL, recvPacket, rpktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: failed deserialization of packet [%d]", ret );
+    // Send the packet, the block is received straight into buf
+    recvPacket.data = buf;
+    int posted = sgPostPacketv(SG_OBTAIN_BLOCK, &initPacket, &recvPacket, &rpktlen);
+    pthread_mutex_unlock(&sgServiceLock);
+    if ( posted ) {
+        logMessage( LOG_ERROR_LEVEL, "sgObtainRemoteBlock: failed packet post" );
         return( -1 );
     }
 
-    // Sanity check the return value
-    if ( loc == SG_NODE_UNKNOWN ) {
-        logMessage( LOG_ERROR_LEVEL, "sgInitEndpoint: bad local ID returned [%ul]", loc );
+    // Unpack the recieived data, already in buf
+    if ( (ret = deserialize_sg_packetv(&loc, &remId, &blkid, &op, &sloc, 
+                                    &srem, &recvPacket, rpktlen)) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "sgObtainRemoteBlock: failed deserialization of packet [%d]", ret );
         return( -1 );
     }
 
-    // Set the local node ID, log and return successfully
-    sgLocalNodeId = loc;
-    logMessage( LOG_INFO_LEVEL, "Completed initialization of node (local node ID %lu", sgLocalNodeId );
     return( 0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : mySgCreateBlock
-// Description  : Create a block, used in sgwirte
+// Function     : sgUpdateRemoteBlock
+// Description  : Send a block to its node [SG_UPDATE_BLOCK op], also used by
+//                the cache to write back dirty blocks
 //
-// Inputs       : fh - file handle for the file to write to
-//                buf - pointer to data to write
-//                len - the length of the write
+// Inputs       : rem - the remote node of the block
+//                blk - the block ID
+//                buf - the block data (SG_BLOCK_SIZE)
 // Outputs      : 0 if successfull, -1 if failure
 
-int mySgCreateBlock( SgFHandle fh, char *buf, size_t len ) {
+int sgUpdateRemoteBlock( SG_Node_ID rem, SG_Block_ID blk, char *buf ) {
 
-    // Find the corresponding file
-    pFile temp = myFile;
-    while ( temp != NULL ) {
-        if ( temp->fileHandle == fh ) {
-            break;
-        } else {
-            temp = temp->pNext;
-        }
+    // Updates of an asynchronous request are not waited for
+    if ( sgAioCurrent != NULL ) {
+        return( mySgAioPostBlock(sgAioCurrent, SG_UPDATE_BLOCK, rem, blk, buf, NULL, 0, 0) );
     }
 
     // Local variables
-    char initPacket[SG_DATA_PACKET_SIZE], recvPacket[SG_BASE_PACKET_SIZE];
+    SG_Packet_Vec initPacket, recvPacket;
     size_t pktlen, rpktlen;
-    SG_Node_ID loc, rem;
+    SG_Node_ID loc, remId;
     SG_Block_ID blkid;
     SG_SeqNum sloc, srem;
     SG_System_OP op;
     SG_Packet_Status ret;
 
-    int blockCount = temp->filePtr / SG_BLOCK_SIZE; // Count which block is it
+    // Find the rseq need to be passed
+    pthread_mutex_lock(&sgServiceLock);
+    SG_SeqNum rseqToBePassed = mySgRemoteSeqno(rem, SG_UPDATE_BLOCK);
 
-    // 2a) Create a new block containing the contents of the write [SG_CREATE_BLOCK op]
-    // Setup the packet
-    pktlen = SG_DATA_PACKET_SIZE;
-    if ( (ret = serialize_sg_packet( sgLocalNodeId,    // Local ID
-                                    SG_NODE_UNKNOWN,   // Remote ID
-                                    SG_BLOCK_UNKNOWN,  // Block ID
-                                    SG_CREATE_BLOCK,   // Operation
-                                    sgLocalSeqno++,  // Sender sequence number
-                                    SG_SEQNO_UNKNOWN,  // Receiver sequence number
-                                    buf, initPacket, &pktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "mySgCreateBlock: failed serialization of packet [%d].", ret );
+    // Setup the packet, the block is sent from buf
+    if ( (ret = serialize_sg_packetv( sgLocalNodeId,   // Local ID
+                                    rem,               // Remote ID
+                                    blk,               // Block ID
+                                    SG_UPDATE_BLOCK,   // Operation
+                                    mySgNextSeqno(), // Sender sequence number
+                                    rseqToBePassed,  // Receiver sequence number
+                                    buf, &initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "sgUpdateRemoteBlock: failed serialization of packet [%d].", ret );
         return( -1 );
     }
 
     // Send the packet
-    rpktlen = SG_BASE_PACKET_SIZE;
-    if ( sgServicePost(initPacket, &pktlen, recvPacket, &rpktlen) ) {
-        logMessage( LOG_ERROR_LEVEL, "mySCreateBlock: failed packet post" );
+    recvPacket.data = NULL;
+    int posted = sgPostPacketv(SG_UPDATE_BLOCK, &initPacket, &recvPacket, &rpktlen);
+    pthread_mutex_unlock(&sgServiceLock);
+    if ( posted ) {
+        logMessage( LOG_ERROR_LEVEL, "sgUpdateRemoteBlock: failed packet post" );
         return( -1 );
     }
 
     // Unpack the recieived data
-    if ( (ret = deserialize_sg_packet(&loc, &rem, &blkid, &op, &sloc, 
-                                    &srem, NULL, recvPacket, rpktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "mySCreateBlock: failed deserialization of packet [%d]", ret );
+    if ( (ret = deserialize_sg_packetv(&loc, &remId, &blkid, &op, &sloc, 
+                                    &srem, &recvPacket, rpktlen)) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "sgUpdateRemoteBlock: failed deserialization of packet [%d]", ret );
         return( -1 );
     }
 
-    // Store the corresponding rseq to the remote node ID
-    // If previously received the same remote node ID, increment its rseq by 1
-    pRem test = myRem;
-    int i = 0;
-    for ( i = 0; i < remCount; i++ ) {
-        while ( test != NULL ) {
-            if ( test->remNodeId == rem ) {
-                test->sgRemoteseqno++;
-                break;
-            } else {
-                test = test->pNext;
-            }
-        }
-    }
-
-    // Allocate memory to every new rem
-    pRem newRem = (pRem) malloc(sizeof(Rem));
-    if ( i == remCount ){
-        newRem->remNodeId = rem;
-        newRem->sgRemoteseqno = srem;
-        remCount++;
-    }
-    newRem->pNext = myRem;
-    myRem = newRem;
-    
-
-    // Allocate memory to every new Id
-    pIdGot newIds = (pIdGot) malloc(sizeof(IdGot));
-
-    // 2b) Save node/block IDs as the current block in the data structure
-    // Set the remote node ID and block ID
-    newIds->blockIdGot = blkid;
-    newIds->remNoteIdGot = rem;
-    newIds->track = blockCount;
-
-    newIds->pNext = temp->myIds;
-    temp->myIds = newIds;
-
-    // 2c) Increase the file size by length of write
-    temp->fileSize += len;
-
-    // 2d) Set file pointer to the end of the file
-    temp->filePtr += len;
-
     return( 0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : mySgObtainBlock
-// Description  : Obtain a block, used in sgread
+// Function     : sgUpdateRemoteRange
+// Description  : Send the changed range of a block to its node, the rest of
+//                the block left as it is there [SG_UPDATE_RANGE op]
 //
-// Inputs       : fh - file handle for the file to read from
-//                buf - place to put the data
+// Inputs       : rem - the remote node of the block
+//                blk - the block ID
+//                buf - the block data (the range at its place in the block)
+//                start - the offset of the range in the block
+//                end - the end of the range (at most SG_RANGE_MAX_LENGTH on)
 // Outputs      : 0 if successfull, -1 if failure
 
-int mySgObtainBlock( SgFHandle fh, char *buf ) {
+int sgUpdateRemoteRange( SG_Node_ID rem, SG_Block_ID blk, char *buf, int start, int end ) {
 
-    // Find the corresponding node
-    pFile temp = myFile;
-    while ( temp != NULL ) {
-        if ( temp->fileHandle == fh ) {
-            break;
-        } else {
-            temp = temp->pNext;
-        }
+    // Local variables
+    char initPacket[SG_DATA_PACKET_SIZE], recvPacket[SG_DATA_PACKET_SIZE];
+    size_t pktlen, rpktlen;
+    SG_Node_ID loc, remId;
+    SG_Block_ID blkid;
+    SG_SeqNum sloc, srem;
+    SG_Packet_Status ret;
+    uint16_t rstart, rlen;
+
+    // Setup the packet, only the range is sent
+    pthread_mutex_lock(&sgServiceLock);
+    SG_SeqNum rseqToBePassed = mySgRemoteSeqno(rem, SG_UPDATE_RANGE);
+    if ( (ret = serialize_sg_range( sgLocalNodeId,   // Local ID
+                                    rem,             // Remote ID
+                                    blk,             // Block ID
+                                    mySgNextSeqno(), // Sender sequence number
+                                    rseqToBePassed,  // Receiver sequence number
+                                    start, end - start, &buf[start],
+                                    initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        logMessage( LOG_ERROR_LEVEL, "sgUpdateRemoteRange: failed serialization of packet [%d].", ret );
+        return( -1 );
     }
 
-    int blockCount = temp->filePtr / SG_BLOCK_SIZE; // Count which block is it
-
-    // Find the corresponding IDs
-    SG_Block_ID blockIdToBePassed;
-    SG_Node_ID remNoteIdToBePassed;
-
-    pIdGot findIds = temp->myIds;
-    while ( findIds != NULL ) {
-        if ( findIds->track == blockCount ) {
-            blockIdToBePassed = findIds->blockIdGot;
-            remNoteIdToBePassed = findIds->remNoteIdGot;
-            break;
-        } else {
-            findIds = findIds->pNext;
-        }
+    // Send the packet
+    rpktlen = SG_DATA_PACKET_SIZE;
+    int posted = sgPostPacket(SG_UPDATE_RANGE, initPacket, &pktlen, recvPacket, &rpktlen);
+    pthread_mutex_unlock(&sgServiceLock);
+    if ( posted ) {
+        logMessage( LOG_ERROR_LEVEL, "sgUpdateRemoteRange: failed packet post" );
+        return( -1 );
     }
 
-    char *data = getSGDataBlock(remNoteIdToBePassed, 
-                    blockIdToBePassed);
+    // Unpack the recieived data, the answer carries no bytes
+    if ( (ret = deserialize_sg_range(&loc, &remId, &blkid, &sloc, &srem, &rstart, &rlen,
+                                     NULL, recvPacket, rpktlen)) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "sgUpdateRemoteRange: failed deserialization of packet [%d]", ret );
+        return( -1 );
+    }
 
-    // Check if there is corresponding data in the cache
-    if (data != NULL){
+    return( 0 );
+}
 
-        // Pass the corresponding data stored in the cache into buf
-        memcpy(buf, data, SG_BLOCK_SIZE);
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgBatchRemoteBlocks
+// Description  : Post blocks of one node (or to create) together in one
+//                batched packet [SG_CREATE_BATCH, SG_UPDATE_BATCH or
+//                SG_OBTAIN_BATCH op]
+//
+// Inputs       : op - the batched operation
+//                blocks - the blocks, all of one node unless created
+//                count - the number of blocks (at most SG_BATCH_MAX_BLOCKS)
+// Outputs      : 0 if successfull, -1 if failure
 
-        // Update block info
-        putSGDataBlock(remNoteIdToBePassed, 
-                    blockIdToBePassed, buf);
-        return( 0 );
-    }
-    
+int sgBatchRemoteBlocks( SG_System_OP op, pBatchBlock blocks, int count ) {
 
     // Local variables
-    char initPacket[SG_BASE_PACKET_SIZE], recvPacket[SG_DATA_PACKET_SIZE];
+    SG_Block_ID blks[SG_BATCH_MAX_BLOCKS];
+    char *data[SG_BATCH_MAX_BLOCKS];
     size_t pktlen, rpktlen;
     SG_Node_ID loc, rem;
-    SG_Block_ID blkid;
     SG_SeqNum sloc, srem;
-    SG_System_OP op;
+    SG_System_OP rop;
     SG_Packet_Status ret;
-    
-    // Find the rseq need to be passed
-    SG_SeqNum rseqToBePassed = 0;
-    pRem remTemp = myRem;
-    while ( remTemp != NULL ) {
-        if ( remTemp->remNodeId == remNoteIdToBePassed ) {
-            remTemp->sgRemoteseqno++;
-            rseqToBePassed = remTemp->sgRemoteseqno;
-            break;
-        } else {
-            remTemp = remTemp->pNext;
-        }
+    int n = count, create = (op == SG_CREATE_BATCH);
+
+    char *initPacket = (char *) malloc(SG_BATCH_PACKET_SIZE * 2);
+    char *recvPacket = initPacket + SG_BATCH_PACKET_SIZE;
+    if ( initPacket == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchRemoteBlocks: out of memory." );
+        return( -1 );
+    }
+    for ( int i = 0; i < count; i++ ) {
+        blks[i] = create ? SG_BLOCK_UNKNOWN : blocks[i].blk;
+        data[i] = blocks[i].data;
     }
 
-    //3) Look at data structure and figure out what block to retrieve
-    pktlen = SG_BASE_PACKET_SIZE;
-    if ( (ret = serialize_sg_packet( sgLocalNodeId, // Local ID
-                                    remNoteIdToBePassed,// Remote ID
-                                    blockIdToBePassed,  // Block ID
-                                    SG_OBTAIN_BLOCK,  // Operation
-                                    sgLocalSeqno++, // Sender sequence number
-                                    rseqToBePassed, // Receiver sequence number
-                                    NULL, initPacket, &pktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "mySgObtainBlock: failed serialization of packet [%d].", ret );
+    // Setup the packet, one receiver seqno for the batch
+    pthread_mutex_lock(&sgServiceLock);
+    rem = create ? SG_NODE_UNKNOWN : blocks[0].rem;
+    if ( (ret = serialize_sg_batch( sgLocalNodeId,  // Local ID
+                                    rem,             // Remote ID
+                                    op,              // Operation
+                                    mySgNextSeqno(), // Sender sequence number
+                                    create ? SG_SEQNO_UNKNOWN : mySgRemoteSeqno(rem, op), // Receiver seqno
+                                    count, blks, (op == SG_OBTAIN_BATCH) ? NULL : data,
+                                    initPacket, &pktlen)) != SG_PACKT_OK ) {
+        pthread_mutex_unlock(&sgServiceLock);
+        free(initPacket);
+        logMessage( LOG_ERROR_LEVEL, "sgBatchRemoteBlocks: failed serialization of packet [%d].", ret );
         return( -1 );
     }
 
-    //4) Retrieve the block [SG_OBTAIN_BLOCK op]
-    // Send the packet
-    rpktlen = SG_DATA_PACKET_SIZE;
-    if ( sgServicePost(initPacket, &pktlen, recvPacket, &rpktlen) ) {
-        logMessage( LOG_ERROR_LEVEL, "mySgObtainBlock: failed packet post" );
+    // Send the packet, a creation keeps the lock until the node's rseq is in
+    rpktlen = SG_BATCH_PACKET_SIZE;
+    int posted = sgPostPacket(op, initPacket, &pktlen, recvPacket, &rpktlen);
+    if ( !create || posted ) {
+        pthread_mutex_unlock(&sgServiceLock);
+    }
+    if ( posted ) {
+        free(initPacket);
+        logMessage( LOG_ERROR_LEVEL, "sgBatchRemoteBlocks: failed packet post" );
         return( -1 );
     }
 
-    //5) Copy the data from the retrieved block to passed in buf
-    // Unpack the recieived data
-    if ( (ret = deserialize_sg_packet(&loc, &rem, &blkid, &op, &sloc, 
-                                    &srem, buf, recvPacket, rpktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "mySgObtainBlock: failed deserialization of packet [%d]", ret );
+    // Unpack the recieived data, obtained blocks straight to where they go
+    ret = deserialize_sg_batch(&loc, &rem, &rop, &sloc, &srem, &n, blks,
+                               (op == SG_OBTAIN_BATCH) ? data : NULL, recvPacket, rpktlen);
+    free(initPacket);
+    if ( ret != SG_PACKT_OK || n != count ) {
+        if ( create ) {
+            pthread_mutex_unlock(&sgServiceLock);
+        }
+        logMessage( LOG_ERROR_LEVEL, "sgBatchRemoteBlocks: failed deserialization of packet [%d]", ret );
         return( -1 );
     }
 
-    // If there is not corresponding data in the cache, update block info to cache
-    putSGDataBlock(remNoteIdToBePassed, 
-                    blockIdToBePassed, buf);
+    // Created blocks take their node and IDs, the node answers with its
+    // current rseq
+    if ( create ) {
+        pRem node = mySgFindRem(rem, 1);
+        if ( node == NULL ) {
+            pthread_mutex_unlock(&sgServiceLock);
+            return( -1 );
+        }
+        node->sgRemoteseqno = srem;
+        node->blocks += count;
+        node->ops[SG_CREATE_BATCH]++;
+        pthread_mutex_unlock(&sgServiceLock);
+        for ( int i = 0; i < count; i++ ) {
+            blocks[i].rem = rem;
+            blocks[i].blk = blks[i];
+        }
+    }
 
     return( 0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : mySgUpdateBlock
-// Description  : Update a block, used in sgwirte
+// Function     : mySgInitLocks
+// Description  : Set up the table lock, waiting writers go before new
+//                readers so opens are not starved by a stream of reads
 //
-// Inputs       : fh - file handle for the file to write to
-//                buf - pointer to data to write
-//                len - the length of the write
-// Outputs      : 0 if successfull, -1 if failure
+// Inputs       : none
+// Outputs      : none
 
-int mySgUpdateBlock( SgFHandle fh, char *buf, size_t len ) {
+void mySgInitLocks( void ) {
 
-    // Find the corresponding node
-    pFile temp = myFile;
-    while ( temp != NULL ) {
-        if ( temp->fileHandle == fh ) {
-            break;
-        } else {
-            temp = temp->pNext;
-        }
+    pthread_rwlockattr_t attr;
+
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&sgTableLock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgLockFile
+// Description  : Find an open file and lock it, the file stays open until
+//                mySgUnlockFile (calls on other files go on in parallel)
+//
+// Inputs       : fh - the file handle
+// Outputs      : the file, NULL if not open
+
+pFile mySgLockFile( SgFHandle fh ) {
+
+    pthread_once(&sgLockOnce, mySgInitLocks);
+    pthread_rwlock_rdlock(&sgTableLock);
+
+    pFile file = mySgFindFile(fh);
+    if ( file == NULL ) {
+        pthread_rwlock_unlock(&sgTableLock);
+        return( NULL );
     }
 
-    // Local variables
-    char initPacket[SG_DATA_PACKET_SIZE], recvPacket[SG_BASE_PACKET_SIZE];
-    size_t pktlen, rpktlen;
-    SG_Node_ID loc, rem;
-    SG_Block_ID blkid;
-    SG_SeqNum sloc, srem;
-    SG_System_OP op;
-    SG_Packet_Status ret;
+    pthread_mutex_lock(&file->fileLock);
+    return( file );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgUnlockFile
+// Description  : Release a file locked by mySgLockFile
+//
+// Inputs       : file - the file
+// Outputs      : none
 
-    int blockCount = temp->filePtr / SG_BLOCK_SIZE; // Count which block is it
+void mySgUnlockFile( pFile file ) {
 
-    // Find the corresponding IDs
-    SG_Block_ID blockIdToBePassed;
-    SG_Node_ID remNoteIdToBePassed;
-
-    pIdGot findIds = temp->myIds;
-    while ( findIds != NULL ) {
-        if ( findIds->track == blockCount ) {
-            blockIdToBePassed = findIds->blockIdGot;
-            remNoteIdToBePassed = findIds->remNoteIdGot;
-            break;
-        } else {
-            findIds = findIds->pNext;
-        }
+    pthread_mutex_unlock(&file->fileLock);
+    pthread_rwlock_unlock(&sgTableLock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgFindFile
+// Description  : Find the open file with a file handle
+//
+// Inputs       : fh - the file handle
+// Outputs      : the file, NULL if not open
+
+pFile mySgFindFile( SgFHandle fh ) {
+
+    if ( fh < 0 || fh >= fileTableSize ) {
+        return( NULL );
     }
+    return( fileTable[fh] );
+}
 
-    // Find the rseq need to be passed
-    SG_SeqNum rseqToBePassed = 0;
-    pRem remTemp = myRem;
-    while ( remTemp != NULL ) {
-        if ( remTemp->remNodeId == remNoteIdToBePassed ) {
-            remTemp->sgRemoteseqno++;
-            rseqToBePassed = remTemp->sgRemoteseqno;
-            break;
-        } else {
-            remTemp = remTemp->pNext;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgAllocHandle
+// Description  : Take a file handle, a closed file's if any, growing the
+//                handle table when all are in use
+//
+// Inputs       : none
+// Outputs      : the file handle, -1 if failure
+
+SgFHandle mySgAllocHandle( void ) {
+
+    if ( freeHandleCount > 0 ) {
+        return( freeHandles[--freeHandleCount] );
+    }
+
+    if ( count >= fileTableSize ) {
+        int newSize = (fileTableSize > 0) ? fileTableSize * 2 : SG_FILE_TABLE_INITIAL;
+        pFile *table = (pFile *) realloc(fileTable, sizeof(pFile) * newSize);
+        SgFHandle *handles = (SgFHandle *) realloc(freeHandles, sizeof(SgFHandle) * newSize);
+        if ( table != NULL ) {
+            fileTable = table;
+        }
+        if ( handles != NULL ) {
+            freeHandles = handles;
+        }
+        if ( table == NULL || handles == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "mySgAllocHandle: out of memory." );
+            return( -1 );
         }
+        memset(&fileTable[fileTableSize], 0, sizeof(pFile) * (newSize - fileTableSize));
+        fileTableSize = newSize;
     }
 
-    // Setup the packet
-    pktlen = SG_DATA_PACKET_SIZE;
-    if ( (ret = serialize_sg_packet( sgLocalNodeId,    // Local ID
-                                    remNoteIdToBePassed,// Remote ID
-                                    blockIdToBePassed,  // Block ID
-                                    SG_UPDATE_BLOCK,   // Operation
-                                    sgLocalSeqno++,  // Sender sequence number
-                                    rseqToBePassed,  // Receiver sequence number
-                                    buf, initPacket, &pktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "mySgUpdateBlock: failed serialization of packet [%d].", ret );
+    // No handle is free, so every handle below count is open
+    return( count );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgGrowPaths
+// Description  : Double the path hash (or create it)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int mySgGrowPaths( void ) {
+
+    uint64_t mask = (pathBuckets != NULL) ? pathMask * 2 + 1 : SG_FILE_TABLE_INITIAL - 1;
+    pFile *buckets = (pFile *) calloc(mask + 1, sizeof(pFile));
+    if ( buckets == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "mySgGrowPaths: out of memory." );
         return( -1 );
     }
 
-    // Send the packet
-    rpktlen = SG_BASE_PACKET_SIZE;
-    if ( sgServicePost(initPacket, &pktlen, recvPacket, &rpktlen) ) {
-        logMessage( LOG_ERROR_LEVEL, "mySgUpdateBlock: failed packet post" );
-        return( -1 );
+    // Move the open files over
+    for ( int i = 0; i < fileTableSize; i++ ) {
+        if ( fileTable[i] != NULL ) {
+            uint64_t bucket = mySgHashPath(fileTable[i]->filename) & mask;
+            fileTable[i]->pathNext = buckets[bucket];
+            buckets[bucket] = fileTable[i];
+        }
     }
 
-    // Unpack the recieived data
-    if ( (ret = deserialize_sg_packet(&loc, &rem, &blkid, &op, &sloc, 
-                                    &srem, NULL, recvPacket, rpktlen)) != SG_PACKT_OK ) {
-        logMessage( LOG_ERROR_LEVEL, "mySgUpdateBlock: failed deserialization of packet [%d]", ret );
-        return( -1 );
+    free(pathBuckets);
+    pathBuckets = buckets;
+    pathMask = mask;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgHashPath
+// Description  : Hash a path (FNV-1a)
+//
+// Inputs       : path - the path
+// Outputs      : the hash
+
+uint64_t mySgHashPath( const char *path ) {
+
+    uint64_t hash = 14695981039346656037ULL;
+    while ( *path ) {
+        hash ^= (unsigned char) *path++;
+        hash *= 1099511628211ULL;
     }
+    return( hash );
+}
 
-    // Query the cache after updates
-    getSGDataBlock(remNoteIdToBePassed, 
-                    blockIdToBePassed);
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mySgFindIds
+// Description  : Find the node/block IDs of a created block of the file
+//
+// Inputs       : file - the file
+//                blockCount - the index of the block in the file
+// Outputs      : the IDs, NULL if the block was not created
 
-    return( 0 );
-}
\ No newline at end of file
+pIdGot mySgFindIds( pFile file, int blockCount ) {
+
+    if ( file == NULL || blockCount < 0 || blockCount >= file->idCount ||
+         file->myIds[blockCount].blockIdGot == 0 ) {
+        return( NULL );
+    }
+
+    return( &file->myIds[blockCount] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgPostPacket
+// Description  : Post a packet through the selected transport, counting the
+//                packets sent for each operation
+//
+// Inputs       : op - the operation of the packet
+//                packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response
+//                rlen - the length of the response buffer (updated)
+// Outputs      : 0 if successfull, -1 if failure
+
+int sgPostPacket( SG_System_OP op, char *packet, size_t *len, char *rpacket, size_t *rlen ) {
+
+    sgOpCount[op]++;
+    return( sgTransport->post(packet, len, rpacket, rlen) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgPostPacketv
+// Description  : Post a packet in pieces through the selected transport, so
+//                blocks go from and to the caller's buffers uncopied
+//
+// Inputs       : op - the operation of the packet
+//                packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the length of the response
+// Outputs      : 0 if successfull, -1 if failure
+
+int sgPostPacketv( SG_System_OP op, SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ) {
+
+    sgOpCount[op]++;
+    return( sgTransport->postv(packet, response, rlen) );
+}
@@ -12,15 +12,50 @@
 //
 
 // Includes
+#include <sys/uio.h>
 #include <sg_defs.h>
 
 // Defines 
+#define SG_PACKET_IOV 3 // Pieces of a packet: header, block, magic number
+#define SG_READAHEAD_ENV "SG_READAHEAD" // Environment most blocks read ahead of a stream
+#define SG_COMPRESS_ENV "SG_COMPRESS"   // Environment compression of blocks on the wire
 
 // Type definitions
 
-// Global interface definitions
+// Asynchronous operations
+typedef enum {
+    SG_AIO_READ  = 0, // Read len bytes at off into buf
+    SG_AIO_WRITE = 1, // Write len bytes from buf at off (at most the file size)
+    SG_AIO_FLUSH = 2  // Write back the file's modified blocks
+} SgAioOp;
+
+// An asynchronous request
+typedef struct {
+    SgAioOp op;     // The operation
+    SgFHandle fh;   // The file
+    char *buf;      // The data (READ, WRITE), untouched until completion
+    size_t len;     // The length of the data
+    size_t off;     // The offset in the file (READ, WRITE)
+    void *userData; // Returned with the completion
+} SgAioRequest;
+
+// Access patterns a file can be advised of (sgadvise)
+typedef enum {
+    SG_ADVICE_NORMAL     = 0, // No advice, readahead follows the reads
+    SG_ADVICE_SEQUENTIAL = 1, // Read in order, the most blocks read ahead from the start
+    SG_ADVICE_RANDOM     = 2, // Read out of order, nothing read ahead
+    SG_ADVICE_WILLNEED   = 3, // The range is read soon, obtained in the background
+    SG_ADVICE_DONTNEED   = 4, // The range is not read again soon, dropped from the cache
+    SG_ADVICE_NOREUSE    = 5  // Blocks are used once, evicted before the others
+} SgAdvice;
+
+// A completed asynchronous request
+typedef struct {
+    void *userData; // From the request
+    int result;     // Bytes read or written (0 for FLUSH), -1 if failure
+} SgAioCompletion;
 
-// Type definitions
+// Global interface definitions
 
 // File system interface definitions
 
@@ -33,15 +68,39 @@ int sgread( SgFHandle fh, char *buf, size_t len );
 int sgwrite( SgFHandle fh, char *buf, size_t len );
     // Write data to the file
 
+int sgreadv( SgFHandle fh, const struct iovec *iov, int iovcnt );
+    // Read data from the file into several buffers
+
+int sgwritev( SgFHandle fh, const struct iovec *iov, int iovcnt );
+    // Write data from several buffers to the file
+
+int sgpreadv( SgFHandle fh, const struct iovec *iov, int iovcnt, size_t off );
+    // Read data at an offset, the file position is unchanged
+
+int sgpwritev( SgFHandle fh, const struct iovec *iov, int iovcnt, size_t off );
+    // Write data at an offset, the file position is unchanged
+
 int sgseek( SgFHandle fh, size_t off );
     // Seek to a specific place in the file
 
 int sgclose( SgFHandle fh );
     // Close the file
 
+int sgflush( SgFHandle fh );
+    // Write the file's modified blocks to their nodes (write-back cache)
+
+int sgadvise( SgFHandle fh, size_t off, size_t len, SgAdvice advice );
+    // Tell the driver how a range of the file is used (len 0 to the end)
+
 int sgshutdown( void );
     // Shut down the filesystem
 
+int sg_submit( SgAioRequest *reqs, int nreqs );
+    // Submit asynchronous requests, the file position is not used
+
+int sg_reap( SgAioCompletion *comps, int max, int minComplete );
+    // Collect completed asynchronous requests (wait for minComplete)
+
 //
 // Helper Functions
 
@@ -55,4 +114,47 @@ SG_Packet_Status deserialize_sg_packet( SG_Node_ID *loc, SG_Node_ID *rem, SG_Blo
         char *packet, size_t plen );
     // De-serialize a ScatterGather packet (unpack packet)
 
+SG_Packet_Status serialize_sg_packetv( SG_Node_ID loc, SG_Node_ID rem, SG_Block_ID blk,
+        SG_System_OP op, SG_SeqNum sseq, SG_SeqNum rseq, char *data,
+        SG_Packet_Vec *pv, size_t *plen );
+    // Serialize a packet in pieces, the block referenced rather than copied
+
+SG_Packet_Status deserialize_sg_packetv( SG_Node_ID *loc, SG_Node_ID *rem, SG_Block_ID *blk,
+        SG_System_OP *op, SG_SeqNum *sseq, SG_SeqNum *rseq,
+        SG_Packet_Vec *pv, size_t plen );
+    // De-serialize a packet received in pieces (the block already in place)
+
+int sgPacketIov( SG_Packet_Vec *pv, struct iovec *iov );
+    // The pieces of a packet for writev (at most SG_PACKET_IOV), their count
+
+size_t sgPacketGather( SG_Packet_Vec *pv, char *packet );
+    // Flatten a packet in pieces, the packet length
+
+SG_Packet_Status sgPacketScatter( SG_Packet_Vec *pv, char *packet, size_t plen );
+    // Split a flat packet into pieces, the block copied to pv->data
+
+void setSGPacketCompression( int compress );
+    // Send the blocks of packets compressed where it saves enough (always
+    // taken compressed)
+
+SG_Packet_Status serialize_sg_batch( SG_Node_ID loc, SG_Node_ID rem, SG_System_OP op,
+        SG_SeqNum sseq, SG_SeqNum rseq, int count, SG_Block_ID *blks,
+        char **data, char *packet, size_t *plen );
+    // Serialize a batched packet, the block IDs then the blocks (if any)
+
+SG_Packet_Status deserialize_sg_batch( SG_Node_ID *loc, SG_Node_ID *rem, SG_System_OP *op,
+        SG_SeqNum *sseq, SG_SeqNum *rseq, int *count, SG_Block_ID *blks,
+        char **data, char *packet, size_t plen );
+    // De-serialize a batched packet, each block copied to where it goes
+
+SG_Packet_Status serialize_sg_range( SG_Node_ID loc, SG_Node_ID rem, SG_Block_ID blk,
+        SG_SeqNum sseq, SG_SeqNum rseq, uint16_t start, uint16_t len, char *data,
+        char *packet, size_t *plen );
+    // Serialize a partial update, the range of the block then its bytes
+
+SG_Packet_Status deserialize_sg_range( SG_Node_ID *loc, SG_Node_ID *rem, SG_Block_ID *blk,
+        SG_SeqNum *sseq, SG_SeqNum *rseq, uint16_t *start, uint16_t *len, char *data,
+        char *packet, size_t plen );
+    // De-serialize a partial update, the bytes copied to data[start]
+
 #endif
\ No newline at end of file
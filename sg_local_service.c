@@ -0,0 +1,810 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_local_service.c
+//  Description    : This is the local stand-in for the ScatterGather service,
+//                   an in-memory set of remote nodes behind a modelled
+//                   link.  A request takes effect when it is posted, the
+//                   link only delays its completion: its bytes cross at the
+//                   link bandwidth after those posted before it, then the
+//                   latency (plus jitter) passes, so requests that are in
+//                   flight together overlap like they would on the wire.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include <sg_local_service.h>
+#include <sg_driver.h>
+
+//
+// Type definitions
+
+// A remote node of the stand-in
+typedef struct {
+    SG_Node_ID nodeId;
+    SG_SeqNum seqno; // Last receiver sequence number seen
+} LocalNode;
+
+// A stored block
+typedef struct local_block {
+    SG_Block_ID blockId;
+    SG_Node_ID nodeId;
+    struct local_block *pNext; // Next block in the hash bucket
+    SGDataBlock data;
+} LocalBlock;
+
+// A submitted request waiting for its latency to pass
+typedef struct local_request {
+    SG_SeqNum tag;
+    uint64_t due; // Completion time (ns)
+    struct local_request *pNext;
+} LocalRequest;
+
+//
+// Global data
+
+int localServiceUp = 0;             // The stand-in is initialized
+uint32_t localLatency = 0;          // Latency of each request (usec)
+uint32_t localBandwidth = 0;        // Link bandwidth (MB/s, bytes/usec), 0 for none
+uint32_t localJitter = 0;           // Most latency added at random (usec)
+uint64_t localLinkFree = 0;         // When the link has sent everything posted (ns)
+uint64_t localRandState = 88172645463325252ULL; // xorshift state of the jitter
+SG_Node_ID localEndpointId = 0;     // The node ID given to the driver
+LocalNode localNodes[SG_LOCAL_NODES]; // The remote nodes
+int localNodeCount = SG_LOCAL_NODES; // Nodes in use
+int localSequenceCheck = 1;         // Log receiver seqnos out of order
+int localNextNode = 0;              // Node of the next created block
+SG_Block_ID localNextBlock = 1;     // Next block ID
+
+LocalBlock **localBuckets = NULL;   // Block hash table
+uint64_t localBucketMask = 0;       // Number of buckets - 1 (power of two)
+uint64_t localBlockCount = 0;       // Blocks stored
+
+LocalRequest *localPending = NULL;  // Submitted, oldest first
+LocalRequest *localPendingTail = NULL;
+LocalRequest *localFreeRequests = NULL; // Recycled request records
+int localInFlight = 0;              // Submitted, not yet reaped
+
+//
+// Functional Prototypes
+
+int localServiceProcess( char *packet, size_t len, char *rpacket, size_t *rlen ); // Answer a packet
+int localServiceBatch( char *packet, size_t len, char *rpacket, size_t *rlen ); // Answer a batched packet
+LocalBlock *localFindBlock( SG_Block_ID blk ); // Find a stored block
+int localGrowBuckets( void ); // Double the block hash table
+uint64_t localDueTime( size_t bytes ); // Completion time of a request (ns)
+uint64_t localNow( void ); // Monotonic time (ns)
+void localSleepUntil( uint64_t due ); // Sleep until a time (ns)
+int localPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ); // Post flattened
+int localSubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ); // Submit flattened
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : initSGLocalService
+// Description  : Start the stand-in service
+//
+// Inputs       : latency - the latency of each request (usec)
+//                bandwidth - the bandwidth of the link (MB/s), 0 for none
+//                jitter - the most latency added at random (usec)
+// Outputs      : 0 if successful, -1 if failure
+
+int initSGLocalService( uint32_t latency, uint32_t bandwidth, uint32_t jitter ) {
+
+    if ( localServiceUp ) {
+        closeSGLocalService();
+    }
+
+    localBucketMask = 1023;
+    localBuckets = (LocalBlock **) calloc(localBucketMask + 1, sizeof(LocalBlock *));
+    if ( localBuckets == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "initSGLocalService: out of memory." );
+        return( -1 );
+    }
+
+    // Node IDs are arbitrary, seqnos start where the service starts them
+    setSGLocalServiceNodes( 0x5100, SG_LOCAL_NODES );
+
+    localLatency = latency;
+    localBandwidth = bandwidth;
+    localJitter = jitter;
+    localLinkFree = 0;
+    localEndpointId = 0;
+    localNextNode = 0;
+    localNextBlock = 1;
+    localBlockCount = 0;
+    localServiceUp = 1;
+
+    logMessage( SGServiceLevel, "Local service started, %d nodes, %u usec latency, %u MB/s, %u usec jitter.",
+                                    SG_LOCAL_NODES, latency, bandwidth, jitter );
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : setSGLocalServiceNodes
+// Description  : Choose the nodes of the stand-in, before any block is
+//                created
+//
+// Inputs       : first - the node ID of the first node, the others follow
+//                count - the number of nodes (1 to SG_LOCAL_NODES)
+// Outputs      : 0 if successful, -1 if failure
+
+int setSGLocalServiceNodes( SG_Node_ID first, int count ) {
+
+    if ( first == 0 || count < 1 || count > SG_LOCAL_NODES || localBlockCount > 0 ) {
+        return( -1 );
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        localNodes[i].nodeId = first + i;
+        localNodes[i].seqno = SG_INITIAL_SEQNO;
+    }
+    localNodeCount = count;
+    localNextNode = 0;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : setSGLocalServiceSequenceCheck
+// Description  : Turn the check of receiver sequence numbers on or off
+//
+// Inputs       : check - log requests out of order if set
+// Outputs      : none
+
+void setSGLocalServiceSequenceCheck( int check ) {
+
+    localSequenceCheck = check;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : openSGLocalService
+// Description  : Start the stand-in service with the link given by the
+//                environment (unset values are 0)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int openSGLocalService( void ) {
+
+    char *latency = getenv(SG_SERVICE_LATENCY_ENV);
+    char *bandwidth = getenv(SG_SERVICE_BANDWIDTH_ENV);
+    char *jitter = getenv(SG_SERVICE_JITTER_ENV);
+
+    return( initSGLocalService(latency != NULL ? atoi(latency) : 0,
+                               bandwidth != NULL ? atoi(bandwidth) : 0,
+                               jitter != NULL ? atoi(jitter) : 0) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : closeSGLocalService
+// Description  : Stop the stand-in service and free its blocks
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int closeSGLocalService( void ) {
+
+    if ( !localServiceUp ) {
+        return( -1 );
+    }
+
+    for ( uint64_t i = 0; i <= localBucketMask; i++ ) {
+        while ( localBuckets[i] != NULL ) {
+            LocalBlock *next = localBuckets[i]->pNext;
+            free(localBuckets[i]);
+            localBuckets[i] = next;
+        }
+    }
+    free(localBuckets);
+    localBuckets = NULL;
+
+    // Anything still in flight is dropped
+    localPendingTail = localPending;
+    while ( localPending != NULL ) {
+        LocalRequest *next = localPending->pNext;
+        free(localPending);
+        localPending = next;
+    }
+    while ( localFreeRequests != NULL ) {
+        LocalRequest *next = localFreeRequests->pNext;
+        free(localFreeRequests);
+        localFreeRequests = next;
+    }
+    localPendingTail = NULL;
+    localInFlight = 0;
+
+    logMessage( SGServiceLevel, "Local service stopped, %lu blocks.", localBlockCount );
+    localServiceUp = 0;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLocalServicePost
+// Description  : Post a packet and wait out the latency for the response
+//
+// Inputs       : packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response
+//                rlen - the size of the buffer, set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int sgLocalServicePost( char *packet, size_t *len, char *rpacket, size_t *rlen ) {
+
+    if ( localServiceProcess(packet, *len, rpacket, rlen) ) {
+        return( -1 );
+    }
+    localSleepUntil( localDueTime(*len + *rlen) );
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLocalServicePostBatch
+// Description  : Post packets back to back and wait for the last response,
+//                the latencies overlap and only the bytes queue on the link
+//
+// Inputs       : requests - the packets
+//                count - the number of packets
+// Outputs      : the number answered
+
+int sgLocalServicePostBatch( SGServiceRequest *requests, int count ) {
+
+    uint64_t last = 0, due;
+    int answered = 0;
+
+    for ( int i = 0; i < count; i++ ) {
+        SGServiceRequest *req = &requests[i];
+        req->result = localServiceProcess(req->packet, req->len, req->rpacket, &req->rlen);
+        if ( req->result == 0 ) {
+            if ( (due = localDueTime(req->len + req->rlen)) > last ) {
+                last = due;
+            }
+            answered++;
+        }
+    }
+
+    localSleepUntil( last );
+    return( answered );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLocalServiceSubmit
+// Description  : Post a packet without waiting, the response is written now
+//                and the tag completes once the latency has passed
+//
+// Inputs       : packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response (kept until reaped)
+//                rlen - the size of the buffer, set to the response length
+//                tag - returned by sgLocalServiceReap on completion
+// Outputs      : 0 if successful, -1 if failure
+
+int sgLocalServiceSubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ) {
+
+    LocalRequest *req = localFreeRequests;
+    if ( req != NULL ) {
+        localFreeRequests = req->pNext;
+    } else if ( (req = (LocalRequest *) malloc(sizeof(LocalRequest))) == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "sgLocalServiceSubmit: out of memory." );
+        return( -1 );
+    }
+
+    if ( localServiceProcess(packet, len, rpacket, rlen) ) {
+        req->pNext = localFreeRequests;
+        localFreeRequests = req;
+        return( -1 );
+    }
+
+    // Keep the pending list in due order, only jitter puts a request
+    // ahead of one posted earlier
+    req->tag = tag;
+    req->due = localDueTime(len + *rlen);
+    if ( localPendingTail == NULL || localPendingTail->due <= req->due ) {
+        req->pNext = NULL;
+        if ( localPendingTail != NULL ) {
+            localPendingTail->pNext = req;
+        } else {
+            localPending = req;
+        }
+        localPendingTail = req;
+    } else {
+        LocalRequest **link = &localPending;
+        while ( (*link)->due <= req->due ) {
+            link = &(*link)->pNext;
+        }
+        req->pNext = *link;
+        *link = req;
+    }
+    localInFlight++;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLocalServiceReap
+// Description  : Collect the tags of submissions whose latency has passed
+//
+// Inputs       : tags - place to put the tags
+//                max - the size of tags
+//                wait - if set and nothing is due, wait for the next one
+// Outputs      : number of tags collected
+
+int sgLocalServiceReap( SG_SeqNum *tags, int max, int wait ) {
+
+    int n = 0;
+
+    if ( wait && localPending != NULL ) {
+        localSleepUntil( localPending->due );
+    }
+
+    uint64_t now = localNow();
+    while ( n < max && localPending != NULL && localPending->due <= now ) {
+        LocalRequest *req = localPending;
+        localPending = req->pNext;
+        if ( localPending == NULL ) {
+            localPendingTail = NULL;
+        }
+        tags[n++] = req->tag;
+        req->pNext = localFreeRequests;
+        localFreeRequests = req;
+        localInFlight--;
+    }
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgLocalServiceInFlight
+// Description  : Count the submissions not yet reaped
+//
+// Inputs       : none
+// Outputs      : the number of submissions
+
+int sgLocalServiceInFlight( void ) {
+
+    return( localInFlight );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localServiceProcess
+// Description  : Answer a packet the way the ScatterGather service does
+//
+// Inputs       : packet - the packet received
+//                len - the length of the packet
+//                rpacket - buffer for the response
+//                rlen - the size of the buffer, set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int localServiceProcess( char *packet, size_t len, char *rpacket, size_t *rlen ) {
+
+    SG_Node_ID loc, rem;
+    SG_Block_ID blk;
+    SG_System_OP op;
+    SG_SeqNum sseq, rseq;
+    SGDataBlock data;
+    uint16_t start = 0, count = 0;
+    SG_Packet_Status ret;
+    LocalBlock *block = NULL;
+    LocalNode *node = NULL;
+    char *reply = NULL;
+
+    if ( !localServiceUp ) {
+        logMessage( LOG_ERROR_LEVEL, "localServiceProcess: service not started." );
+        return( -1 );
+    }
+
+    // Batched packets have a layout of their own
+    SG_Packet_Header header;
+    if ( len >= sizeof(SG_Packet_Header) ) {
+        memcpy(&header, packet, sizeof(SG_Packet_Header));
+        if ( header.operation >= SG_CREATE_BATCH && header.operation <= SG_OBTAIN_BATCH ) {
+            return( localServiceBatch(packet, len, rpacket, rlen) );
+        }
+    }
+
+    // Partial updates carry their range, the bytes land at its offset in data
+    if ( len >= sizeof(SG_Packet_Header) && header.operation == SG_UPDATE_RANGE ) {
+        op = SG_UPDATE_RANGE;
+        ret = deserialize_sg_range(&loc, &rem, &blk, &sseq, &rseq, &start, &count,
+                                   data, packet, len);
+    } else {
+        ret = deserialize_sg_packet(&loc, &rem, &blk, &op, &sseq,
+                                    &rseq, data, packet, len);
+    }
+    if ( ret != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "localServiceProcess: bad packet [%d].", ret );
+        return( -1 );
+    }
+
+    // Find the node and block addressed by block operations
+    if ( op == SG_UPDATE_BLOCK || op == SG_OBTAIN_BLOCK || op == SG_DELETE_BLOCK ||
+         op == SG_UPDATE_RANGE ) {
+        block = localFindBlock(blk);
+        if ( block == NULL || block->nodeId != rem ) {
+            logMessage( LOG_ERROR_LEVEL, "localServiceProcess: no block %lu on node %lu.", blk, rem );
+            return( -1 );
+        }
+        node = &localNodes[rem - localNodes[0].nodeId];
+
+        // Sequence numbers are checked like the service, logged not refused
+        SG_SeqNum expect = node->seqno + 1;
+        if ( expect == 0 ) {
+            expect = 1;
+        }
+        if ( localSequenceCheck && rseq != expect ) {
+            logMessage( LOG_ERROR_LEVEL, "localServiceProcess: out of sequence request on node %lu [%u != %u].",
+                                            rem, rseq, expect );
+        }
+        node->seqno = rseq;
+    }
+
+    switch ( op ) {
+    case SG_INIT_ENDPOINT: // Give the driver its node ID, and ours
+        localEndpointId = 0x5000;
+        loc = localEndpointId;
+        rem = localNodes[0].nodeId;
+        break;
+
+    case SG_STOP_ENDPOINT: // Nothing to do
+        break;
+
+    case SG_CREATE_BLOCK: // Store the block on the next node
+        if ( localBlockCount > localBucketMask && localGrowBuckets() ) {
+            return( -1 );
+        }
+        if ( (block = (LocalBlock *) malloc(sizeof(LocalBlock))) == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "localServiceProcess: out of memory." );
+            return( -1 );
+        }
+        node = &localNodes[localNextNode];
+        localNextNode = (localNextNode + 1) % localNodeCount;
+        if ( ++node->seqno == 0 ) {
+            node->seqno = 1;
+        }
+
+        block->blockId = localNextBlock++;
+        block->nodeId = node->nodeId;
+        memcpy(block->data, data, SG_BLOCK_SIZE);
+        block->pNext = localBuckets[block->blockId & localBucketMask];
+        localBuckets[block->blockId & localBucketMask] = block;
+        localBlockCount++;
+
+        rem = node->nodeId;
+        blk = block->blockId;
+        rseq = node->seqno;
+        break;
+
+    case SG_UPDATE_BLOCK: // Replace the block
+        memcpy(block->data, data, SG_BLOCK_SIZE);
+        break;
+
+    case SG_UPDATE_RANGE: // Replace the range, the rest of the block stays
+        memcpy(&block->data[start], &data[start], count);
+        break;
+
+    case SG_OBTAIN_BLOCK: // Return the block
+        reply = block->data;
+        break;
+
+    case SG_DELETE_BLOCK: // Unlink and free the block
+        {
+            LocalBlock **prev = &localBuckets[blk & localBucketMask];
+            while ( *prev != block ) {
+                prev = &(*prev)->pNext;
+            }
+            *prev = block->pNext;
+            free(block);
+            localBlockCount--;
+        }
+        break;
+
+    default:
+        logMessage( LOG_ERROR_LEVEL, "localServiceProcess: bad operation [%d].", op );
+        return( -1 );
+    }
+
+    // Build the response
+    if ( *rlen < (reply != NULL ? SG_DATA_PACKET_SIZE : SG_BASE_PACKET_SIZE) ) {
+        logMessage( LOG_ERROR_LEVEL, "localServiceProcess: response buffer too small." );
+        return( -1 );
+    }
+    if ( op == SG_UPDATE_RANGE ) {
+        ret = serialize_sg_range(loc, rem, blk, sseq, rseq, start, 0, NULL, rpacket, rlen);
+    } else {
+        ret = serialize_sg_packet(loc, rem, blk, op, sseq, rseq, reply, rpacket, rlen);
+    }
+    if ( ret != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "localServiceProcess: failed response [%d].", ret );
+        return( -1 );
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localServiceBatch
+// Description  : Answer a batched packet, all of its blocks or none: a
+//                creation stores every block on the next node, the other
+//                operations need every block on the node addressed
+//
+// Inputs       : packet - the packet received
+//                len - the length of the packet
+//                rpacket - buffer for the response
+//                rlen - the size of the buffer, set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int localServiceBatch( char *packet, size_t len, char *rpacket, size_t *rlen ) {
+
+    SG_Node_ID loc, rem;
+    SG_Block_ID blks[SG_BATCH_MAX_BLOCKS];
+    SG_System_OP op;
+    SG_SeqNum sseq, rseq;
+    SGDataBlock data[SG_BATCH_MAX_BLOCKS];
+    char *blocks[SG_BATCH_MAX_BLOCKS];
+    LocalBlock *found[SG_BATCH_MAX_BLOCKS];
+    SG_Packet_Status ret;
+    LocalNode *node;
+    int count = SG_BATCH_MAX_BLOCKS, i;
+
+    for ( i = 0; i < SG_BATCH_MAX_BLOCKS; i++ ) {
+        blocks[i] = data[i];
+    }
+    if ( (ret = deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count,
+                                     blks, blocks, packet, len)) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "localServiceBatch: bad packet [%d].", ret );
+        return( -1 );
+    }
+
+    if ( op == SG_CREATE_BATCH ) {
+
+        // Store the blocks on the next node, taking one receiver seqno
+        while ( localBlockCount + count > localBucketMask + 1 ) {
+            if ( localGrowBuckets() ) {
+                return( -1 );
+            }
+        }
+        for ( i = 0; i < count; i++ ) {
+            if ( (found[i] = (LocalBlock *) malloc(sizeof(LocalBlock))) == NULL ) {
+                logMessage( LOG_ERROR_LEVEL, "localServiceBatch: out of memory." );
+                while ( i-- > 0 ) {
+                    free(found[i]);
+                }
+                return( -1 );
+            }
+        }
+        node = &localNodes[localNextNode];
+        localNextNode = (localNextNode + 1) % localNodeCount;
+        if ( ++node->seqno == 0 ) {
+            node->seqno = 1;
+        }
+
+        for ( i = 0; i < count; i++ ) {
+            LocalBlock *block = found[i];
+            block->blockId = localNextBlock++;
+            block->nodeId = node->nodeId;
+            memcpy(block->data, data[i], SG_BLOCK_SIZE);
+            block->pNext = localBuckets[block->blockId & localBucketMask];
+            localBuckets[block->blockId & localBucketMask] = block;
+            localBlockCount++;
+            blks[i] = block->blockId;
+        }
+        rem = node->nodeId;
+        rseq = node->seqno;
+
+    } else {
+
+        // Every block must be on the node, one receiver seqno for the batch
+        for ( i = 0; i < count; i++ ) {
+            found[i] = localFindBlock(blks[i]);
+            if ( found[i] == NULL || found[i]->nodeId != rem ) {
+                logMessage( LOG_ERROR_LEVEL, "localServiceBatch: no block %lu on node %lu.", blks[i], rem );
+                return( -1 );
+            }
+        }
+        node = &localNodes[rem - localNodes[0].nodeId];
+
+        SG_SeqNum expect = node->seqno + 1;
+        if ( expect == 0 ) {
+            expect = 1;
+        }
+        if ( localSequenceCheck && rseq != expect ) {
+            logMessage( LOG_ERROR_LEVEL, "localServiceBatch: out of sequence request on node %lu [%u != %u].",
+                                            rem, rseq, expect );
+        }
+        node->seqno = rseq;
+
+        for ( i = 0; i < count; i++ ) {
+            if ( op == SG_UPDATE_BATCH ) {
+                memcpy(found[i]->data, data[i], SG_BLOCK_SIZE);
+            } else {
+                blocks[i] = found[i]->data;
+            }
+        }
+    }
+
+    // Build the response, the blocks only for an obtain
+    if ( *rlen < SG_BASE_PACKET_SIZE + count * (sizeof(SG_Block_ID) +
+                                                (op == SG_OBTAIN_BATCH ? SG_BLOCK_SIZE : 0)) ) {
+        logMessage( LOG_ERROR_LEVEL, "localServiceBatch: response buffer too small." );
+        return( -1 );
+    }
+    if ( (ret = serialize_sg_batch(loc, rem, op, sseq, rseq, count, blks,
+                                   (op == SG_OBTAIN_BATCH) ? blocks : NULL, rpacket, rlen)) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "localServiceBatch: failed response [%d].", ret );
+        return( -1 );
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localFindBlock
+// Description  : Find a stored block
+//
+// Inputs       : blk - the block ID
+// Outputs      : the block, NULL if not stored
+
+LocalBlock *localFindBlock( SG_Block_ID blk ) {
+
+    LocalBlock *block = localBuckets[blk & localBucketMask];
+    while ( block != NULL && block->blockId != blk ) {
+        block = block->pNext;
+    }
+    return( block );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localGrowBuckets
+// Description  : Double the block hash table
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int localGrowBuckets( void ) {
+
+    uint64_t mask = localBucketMask * 2 + 1;
+    LocalBlock **buckets = (LocalBlock **) calloc(mask + 1, sizeof(LocalBlock *));
+    if ( buckets == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "localGrowBuckets: out of memory." );
+        return( -1 );
+    }
+
+    for ( uint64_t i = 0; i <= localBucketMask; i++ ) {
+        while ( localBuckets[i] != NULL ) {
+            LocalBlock *block = localBuckets[i];
+            localBuckets[i] = block->pNext;
+            block->pNext = buckets[block->blockId & mask];
+            buckets[block->blockId & mask] = block;
+        }
+    }
+
+    free(localBuckets);
+    localBuckets = buckets;
+    localBucketMask = mask;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localDueTime
+// Description  : Work out when a request posted now completes, sending its
+//                bytes over the link after everything posted before it
+//
+// Inputs       : bytes - the bytes of the packet and its response
+// Outputs      : the completion time (ns)
+
+uint64_t localDueTime( size_t bytes ) {
+
+    uint64_t now = localNow(), sent = now;
+
+    if ( localBandwidth > 0 ) {
+        sent = (localLinkFree > now) ? localLinkFree : now;
+        sent += (uint64_t) bytes * 1000 / localBandwidth;
+        localLinkFree = sent;
+    }
+
+    uint64_t latency = (uint64_t) localLatency * 1000;
+    if ( localJitter > 0 ) {
+        localRandState ^= localRandState << 13;
+        localRandState ^= localRandState >> 7;
+        localRandState ^= localRandState << 17;
+        latency += localRandState % ((uint64_t) localJitter * 1000 + 1);
+    }
+
+    return( sent + latency );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localNow
+// Description  : Read the monotonic clock
+//
+// Inputs       : none
+// Outputs      : the current time (ns)
+
+uint64_t localNow( void ) {
+
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localSleepUntil
+// Description  : Sleep until a time has passed
+//
+// Inputs       : due - the time (ns)
+// Outputs      : none
+
+void localSleepUntil( uint64_t due ) {
+
+    uint64_t now = localNow();
+    if ( due > now ) {
+        struct timespec ts;
+        ts.tv_sec = (due - now) / 1000000000ULL;
+        ts.tv_nsec = (due - now) % 1000000000ULL;
+        nanosleep( &ts, NULL );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localPostv
+// Description  : Post a packet in pieces to the stand-in
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int localPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ) {
+
+    return( sgFlatPostv(sgLocalServicePost, packet, response, rlen) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : localSubmitv
+// Description  : Submit a packet in pieces to the stand-in, it is answered
+//                at once and only the tag waits for the latency
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+//                tag - returned by sgLocalServiceReap
+// Outputs      : 0 if successful, -1 if failure
+
+int localSubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ) {
+
+    return( sgFlatSubmitv(sgLocalServiceSubmit, packet, response, rlen, tag) );
+}
+
+//
+// The stand-in as a transport of the driver
+const SGServiceTransport sgLocalTransport = {
+    "local", openSGLocalService, closeSGLocalService, sgLocalServicePost, sgLocalServicePostBatch,
+    sgLocalServiceSubmit, sgLocalServiceReap, sgLocalServiceInFlight, localPostv, localSubmitv,
+    SG_BATCH_MAX_BLOCKS, 1, 1
+};
@@ -0,0 +1,65 @@
+#ifndef SG_LOCAL_SERVICE_INCLUDED
+#define SG_LOCAL_SERVICE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_local_service.h
+//  Description    : This is the interface to the local stand-in for the
+//                   ScatterGather service.  It keeps the blocks of a set of
+//                   remote nodes in memory and answers packets like the
+//                   service does, after a configurable latency, link
+//                   bandwidth and jitter.  Posts may be synchronous, batched
+//                   or submitted and reaped later, so the overlap of
+//                   requests in flight can be measured.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Includes
+#include <sg_service.h>
+
+//
+// Defines
+#define SG_SERVICE_LATENCY_ENV "SG_SERVICE_LATENCY"     // Environment latency (usec)
+#define SG_SERVICE_BANDWIDTH_ENV "SG_SERVICE_BANDWIDTH" // Environment bandwidth (MB/s)
+#define SG_SERVICE_JITTER_ENV "SG_SERVICE_JITTER"       // Environment jitter (usec)
+#define SG_LOCAL_NODES 16 // Remote nodes of the stand-in
+
+//
+// Service functions
+
+int initSGLocalService( uint32_t latency, uint32_t bandwidth, uint32_t jitter );
+    // Start the stand-in, each request completes latency usec (plus up to
+    // jitter usec) after its bytes cross a link of bandwidth MB/s (0 for
+    // no limit)
+
+int openSGLocalService( void );
+    // Start the stand-in configured from the environment
+
+int setSGLocalServiceNodes( SG_Node_ID first, int count );
+    // Serve count nodes numbered from first (before any block is created)
+
+void setSGLocalServiceSequenceCheck( int check );
+    // Log requests whose receiver sequence number is out of order (default on)
+
+int closeSGLocalService( void );
+    // Stop the stand-in, free the blocks
+
+int sgLocalServicePost( char *packet, size_t *len, char *rpacket, size_t *rlen );
+    // Post a packet and wait for the response (as sgServicePost)
+
+int sgLocalServicePostBatch( SGServiceRequest *requests, int count );
+    // Post packets back to back and wait for the last response
+
+int sgLocalServiceSubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag );
+    // Post a packet without waiting, the response lands in rpacket and the
+    // tag is returned by sgLocalServiceReap once the latency has passed
+
+int sgLocalServiceReap( SG_SeqNum *tags, int max, int wait );
+    // Collect the tags of completed submissions (wait for one if wait is set)
+
+int sgLocalServiceInFlight( void );
+    // Number of submissions not yet reaped
+
+#endif
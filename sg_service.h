@@ -4,8 +4,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  File           : sg_service.h
-//  Description    : This is the declaration of the interface to the 
-//                   base functions for the ScatterGather service.
+//  Description    : This is the declaration of the interface to the
+//                   base functions for the ScatterGather service, and of
+//                   the transports the driver reaches it through.
 //
 //   Author        : Patrick McDaniel
 //   Last Modified : Thu 03 Sep 2020 06:23:05 PM EDT
@@ -14,13 +15,75 @@
 // Includes
 #include <sg_defs.h>
 
-// Defines 
+// Defines
+#define SG_SERVICE_ENV "SG_SERVICE" // Environment transport ("library", "local", "socket", "shm")
 
 // Type definitions
 
+// A packet posted with others by postBatch
+typedef struct {
+    char *packet;  // The packet to send
+    size_t len;    // The length of the packet
+    char *rpacket; // Buffer for the response
+    size_t rlen;   // The size of the buffer, set to the response length
+    int result;    // 0 if answered, -1 if failed
+} SGServiceRequest;
+
+// A transport to the ScatterGather service, the caller serializes the calls
+typedef struct {
+    const char *name;
+    int (*open)( void );
+        // Start the transport (configured from the environment)
+    int (*close)( void );
+        // Stop the transport, dropping anything in flight
+    int (*post)( char *packet, size_t *len, char *rpacket, size_t *rlen );
+        // Post a packet and wait for the response
+    int (*postBatch)( SGServiceRequest *requests, int count );
+        // Post packets together and wait for every response, in order (the
+        // number answered, each request has its own result)
+    int (*submit)( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag );
+        // Post a packet without waiting, the response lands in rpacket (kept
+        // until reaped) and the tag is returned by reap once it is answered
+    int (*reap)( SG_SeqNum *tags, int max, int wait );
+        // Collect the tags of answered submissions (wait for one if wait is set)
+    int (*inFlight)( void );
+        // Number of submissions not yet reaped
+    int (*postv)( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen );
+        // As post with packets in pieces, the response block lands in
+        // response->data and rlen is set to the response length
+    int (*submitv)( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag );
+        // As submit with packets in pieces, the packet is sent before the
+        // call returns and the response (and its block) is kept until reaped
+    int batchBlocks;
+        // Most blocks of a batched packet (SG_CREATE_BATCH, SG_UPDATE_BATCH,
+        // SG_OBTAIN_BATCH) the service answers, 0 if it takes none
+    int rangeUpdates;
+        // The service answers partial updates (SG_UPDATE_RANGE)
+    int compressedBlocks;
+        // The service takes compressed blocks (SG_DATA_COMPRESSED)
+} SGServiceTransport;
+
+// The transports
+extern const SGServiceTransport sgLibraryTransport; // The ScatterGather library
+extern const SGServiceTransport sgLocalTransport;   // The in-memory stand-in
+extern const SGServiceTransport sgSocketTransport;  // sg_blockd servers
+extern const SGServiceTransport sgShmTransport;     // sg_blockd servers on this host
+
 // Global interface definitions
 
 int sgServicePost( char *packet, size_t *len, char *rpacket, size_t *rlen );
     // Post a packet to the ScatterGather service
 
-#endif
\ No newline at end of file
+int sgFlatPostv( int (*post)( char *packet, size_t *len, char *rpacket, size_t *rlen ),
+                 SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen );
+    // Post packets in pieces through a transport of flat packets
+
+int sgFlatSubmitv( int (*submit)( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ),
+                   SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag );
+    // Submit packets in pieces through a transport of flat packets that
+    // answers before returning
+
+const SGServiceTransport *getSGServiceTransport( const char *name );
+    // Find a transport by name (NULL for the library), NULL if unknown
+
+#endif
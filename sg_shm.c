@@ -0,0 +1,876 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_shm.c
+//  Description    : This is the shared-memory transport of the driver, for
+//                   sg_blockd servers on the same host, and the server side
+//                   of its rings.  Packets are copied into a request slot
+//                   and the server serializes its response straight into
+//                   the matching response slot, so a round trip costs two
+//                   packet copies and, while both sides are busy, no system
+//                   call at all.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include <sg_shm.h>
+#include <sg_socket.h>
+#include <sg_driver.h>
+
+//
+// Defines
+#define SHM_PENDING 1 // Result of a posted packet not yet answered
+
+//
+// Type definitions
+
+// A packet in a request slot, waiting for its response
+typedef struct {
+    SG_SeqNum tag;  // Returned by reap (submitted packets)
+    char *rpacket;  // Buffer for the response
+    SG_Packet_Vec *vec; // Or the response in pieces, the block to vec->data
+    size_t *rlen;   // The size of the buffer, set to the response length
+    int *result;    // Set to 0 if answered, -1 if failed (NULL if submitted)
+} ShmRequest;
+
+// A server on this host, one remote node
+typedef struct {
+    SG_Node_ID nodeId;
+    int sock;             // Unix socket to the server, closed to detach
+    int doorbell;         // Wakes the server
+    int wake;             // Wakes the driver
+    SGShmRegion *region;  // The rings, NULL once the server is gone
+    uint32_t sent;        // Requests written
+    uint32_t answered;    // Responses read
+    ShmRequest pending[SG_SHM_SLOTS]; // By request index
+} ShmNode;
+
+//
+// Global data
+
+ShmNode *shmNodes = NULL;     // The servers
+int shmNodeCount = 0;         // Number of servers
+uint64_t shmNextCreate = 0;   // Creations sent, spread over the servers
+SG_SeqNum *shmReady = NULL;   // Tags of answered submissions (ring)
+uint32_t shmReadyHead = 0;    // Oldest tag
+uint32_t shmReadyCount = 0;   // Tags not yet reaped
+int shmInFlight = 0;          // Submitted, not yet reaped
+
+//
+// Functional Prototypes
+
+int shmOpen( void ); // Attach to the servers
+int shmClose( void ); // Detach
+int shmPost( char *packet, size_t *len, char *rpacket, size_t *rlen ); // Post and wait
+int shmPostBatch( SGServiceRequest *requests, int count ); // Fill the ring and wait
+int shmSubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ); // Post
+int shmReap( SG_SeqNum *tags, int max, int wait ); // Collect answered tags
+int shmInFlightCount( void ); // Tags not yet reaped
+int shmPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ); // Post in pieces and wait
+int shmSubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ); // Post in pieces
+int shmAttach( ShmNode *node, const char *address ); // Share a region with a server
+ShmNode *shmRoute( char *packet, size_t len ); // Server of a packet
+ShmNode *shmRouteTo( SG_Node_ID rem, SG_System_OP op ); // Server of a block
+int shmSend( ShmNode *node, struct iovec *iov, int iovcnt, char *rpacket, SG_Packet_Vec *vec,
+             size_t *rlen, int *result ); // Send
+int shmReceive( ShmNode *node ); // Read the responses written
+int shmWait( ShmNode *only ); // Wait for a response
+void shmFail( ShmNode *node ); // Fail everything sent to a server gone
+
+//
+// Driver functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmOpen
+// Description  : Attach to the servers listed in SG_SERVICE_ADDRESS, which
+//                must be Unix sockets on this host
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int shmOpen( void ) {
+
+    char *list = getenv(SG_SERVICE_ADDRESS_ENV);
+    char *copy, *address, *save;
+
+    if ( list == NULL || (copy = strdup(list)) == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "shmOpen: no server address (%s).", SG_SERVICE_ADDRESS_ENV );
+        return( -1 );
+    }
+    shmNodes = (ShmNode *) calloc(SG_SOCKET_MAX_NODES, sizeof(ShmNode));
+    shmReady = (SG_SeqNum *) malloc(sizeof(SG_SeqNum) * SG_SOCKET_MAX_NODES * SG_SHM_SLOTS);
+    if ( shmNodes == NULL || shmReady == NULL ) {
+        free(copy);
+        shmClose();
+        return( -1 );
+    }
+    shmNodeCount = 0;
+    shmNextCreate = 0;
+    shmReadyHead = 0;
+    shmReadyCount = 0;
+    shmInFlight = 0;
+
+    for ( address = strtok_r(copy, ",", &save); address != NULL; address = strtok_r(NULL, ",", &save) ) {
+
+        if ( shmNodeCount == SG_SOCKET_MAX_NODES ) {
+            logMessage( LOG_ERROR_LEVEL, "shmOpen: more than %d servers.", SG_SOCKET_MAX_NODES );
+            break;
+        }
+
+        ShmNode *node = &shmNodes[shmNodeCount++];
+        if ( shmAttach(node, address) ) {
+            free(copy);
+            shmClose();
+            return( -1 );
+        }
+        for ( int i = 0; i < shmNodeCount - 1; i++ ) {
+            if ( shmNodes[i].nodeId == node->nodeId ) {
+                logMessage( LOG_ERROR_LEVEL, "shmOpen: node %lu at [%s] is already attached.",
+                                                node->nodeId, address );
+                free(copy);
+                shmClose();
+                return( -1 );
+            }
+        }
+        logMessage( SGServiceLevel, "Attached to node %lu at [%s], %d slots.",
+                                        node->nodeId, address, SG_SHM_SLOTS );
+    }
+    free(copy);
+
+    if ( shmNodeCount == 0 ) {
+        shmClose();
+        return( -1 );
+    }
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmClose
+// Description  : Detach from the servers, anything in flight is dropped
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int shmClose( void ) {
+
+    for ( int i = 0; shmNodes != NULL && i < shmNodeCount; i++ ) {
+        ShmNode *node = &shmNodes[i];
+        if ( node->region != NULL ) {
+            munmap(node->region, sizeof(SGShmRegion));
+        }
+        if ( node->sock != -1 ) {
+            close(node->sock);
+        }
+        if ( node->doorbell != -1 ) {
+            close(node->doorbell);
+        }
+        if ( node->wake != -1 ) {
+            close(node->wake);
+        }
+    }
+    free(shmNodes);
+    free(shmReady);
+    shmNodes = NULL;
+    shmReady = NULL;
+    shmNodeCount = 0;
+    shmReadyCount = 0;
+    shmInFlight = 0;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmPost
+// Description  : Send a packet and wait for its response
+//
+// Inputs       : packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response
+//                rlen - the size of the buffer, set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int shmPost( char *packet, size_t *len, char *rpacket, size_t *rlen ) {
+
+    ShmNode *node = shmRoute(packet, *len);
+    struct iovec iov = { packet, *len };
+    int result = SHM_PENDING;
+
+    if ( node == NULL || shmSend(node, &iov, 1, rpacket, NULL, rlen, &result) ) {
+        return( -1 );
+    }
+    while ( result == SHM_PENDING ) {
+        shmWait(node);
+    }
+
+    return( result );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmPostBatch
+// Description  : Write every packet before waiting for any response, the
+//                server answers what it finds in one pass
+//
+// Inputs       : requests - the packets
+//                count - the number of packets
+// Outputs      : the number answered
+
+int shmPostBatch( SGServiceRequest *requests, int count ) {
+
+    ShmNode **nodes = (ShmNode **) calloc(count > 0 ? count : 1, sizeof(ShmNode *));
+    int answered = 0;
+
+    if ( nodes == NULL ) {
+        return( 0 );
+    }
+
+    // A full ring makes shmSend take the responses already written
+    for ( int i = 0; i < count; i++ ) {
+        struct iovec iov = { requests[i].packet, requests[i].len };
+        requests[i].result = SHM_PENDING;
+        if ( (nodes[i] = shmRoute(requests[i].packet, requests[i].len)) == NULL ||
+             shmSend(nodes[i], &iov, 1, requests[i].rpacket, NULL,
+                     &requests[i].rlen, &requests[i].result) ) {
+            requests[i].result = -1;
+        }
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        while ( requests[i].result == SHM_PENDING ) {
+            shmWait(nodes[i]);
+        }
+        if ( requests[i].result == 0 ) {
+            answered++;
+        }
+    }
+
+    free(nodes);
+    return( answered );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmSubmit
+// Description  : Send a packet without waiting, the tag is reaped once the
+//                response has been written
+//
+// Inputs       : packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response (kept until reaped)
+//                rlen - the size of the buffer, set to the response length
+//                tag - returned by shmReap
+// Outputs      : 0 if successful, -1 if failure
+
+int shmSubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ) {
+
+    ShmNode *node = shmRoute(packet, len);
+    struct iovec iov = { packet, len };
+
+    if ( node == NULL || shmSend(node, &iov, 1, rpacket, NULL, rlen, NULL) ) {
+        return( -1 );
+    }
+    node->pending[(node->sent - 1) & (SG_SHM_SLOTS - 1)].tag = tag;
+    shmInFlight++;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmPostv
+// Description  : Send a packet in pieces and wait for its response, the
+//                pieces are gathered straight into the request slot
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int shmPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ) {
+
+    struct iovec iov[SG_PACKET_IOV];
+    int iovcnt = sgPacketIov(packet, iov);
+    ShmNode *node = shmRouteTo(packet->header.remNodeId, packet->header.operation);
+    int result = SHM_PENDING;
+
+    if ( node == NULL || shmSend(node, iov, iovcnt, NULL, response, rlen, &result) ) {
+        return( -1 );
+    }
+    while ( result == SHM_PENDING ) {
+        shmWait(node);
+    }
+
+    return( result );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmSubmitv
+// Description  : Send a packet in pieces without waiting, the tag is reaped
+//                once the response slot has been split into response
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                           (kept until reaped)
+//                rlen - set to the response length
+//                tag - returned by shmReap
+// Outputs      : 0 if successful, -1 if failure
+
+int shmSubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ) {
+
+    struct iovec iov[SG_PACKET_IOV];
+    int iovcnt = sgPacketIov(packet, iov);
+    ShmNode *node = shmRouteTo(packet->header.remNodeId, packet->header.operation);
+
+    if ( node == NULL || shmSend(node, iov, iovcnt, NULL, response, rlen, NULL) ) {
+        return( -1 );
+    }
+    node->pending[(node->sent - 1) & (SG_SHM_SLOTS - 1)].tag = tag;
+    shmInFlight++;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmReap
+// Description  : Collect the tags of submitted packets that were answered
+//
+// Inputs       : tags - place to put the tags
+//                max - the size of tags
+//                wait - if set and nothing is answered, wait for a response
+// Outputs      : number of tags collected
+
+int shmReap( SG_SeqNum *tags, int max, int wait ) {
+
+    uint32_t size = SG_SOCKET_MAX_NODES * SG_SHM_SLOTS;
+    int n = 0;
+
+    for ( int i = 0; i < shmNodeCount; i++ ) {
+        shmReceive(&shmNodes[i]);
+    }
+    while ( shmReadyCount == 0 && wait && shmInFlight > 0 ) {
+        if ( shmWait(NULL) ) {
+            break;
+        }
+    }
+
+    while ( n < max && shmReadyCount > 0 ) {
+        tags[n++] = shmReady[shmReadyHead];
+        shmReadyHead = (shmReadyHead + 1) % size;
+        shmReadyCount--;
+        shmInFlight--;
+    }
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmInFlightCount
+// Description  : Count the submissions not yet reaped
+//
+// Inputs       : none
+// Outputs      : the number of submissions
+
+int shmInFlightCount( void ) {
+
+    return( shmInFlight );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmAttach
+// Description  : Create the rings of a server, pass them over its socket and
+//                ask it for its node ID through them
+//
+// Inputs       : node - the server
+//                address - its Unix socket, "unix:<path>"
+// Outputs      : 0 if successful, -1 if failure
+
+int shmAttach( ShmNode *node, const char *address ) {
+
+    SG_Packet_Vec packet, response;
+    struct iovec iov[SG_PACKET_IOV];
+    size_t len, rlen, pos = 0, flen;
+    SGSocketBuffer *ack = NULL;
+    SG_Node_ID loc, rem;
+    SG_Block_ID blk;
+    SG_System_OP op;
+    SG_SeqNum sseq, rseq;
+    int fds[SG_SHM_FDS], memfd = -1, result = -1;
+
+    node->sock = node->doorbell = node->wake = -1;
+    if ( strncmp(address, "unix:", 5) != 0 ) {
+        logMessage( LOG_ERROR_LEVEL, "shmAttach: [%s] is not a Unix socket.", address );
+        return( -1 );
+    }
+
+    // The region and the two eventfds go to the server in one frame
+    if ( (node->sock = sgSocketConnect(address)) == -1 ||
+         (memfd = memfd_create("sg_shm", MFD_CLOEXEC)) == -1 ||
+         ftruncate(memfd, sizeof(SGShmRegion)) == -1 ||
+         (node->region = (SGShmRegion *) mmap(NULL, sizeof(SGShmRegion), PROT_READ | PROT_WRITE,
+                                              MAP_SHARED, memfd, 0)) == MAP_FAILED ||
+         (node->doorbell = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 ||
+         (node->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 ) {
+        if ( node->region == MAP_FAILED ) {
+            node->region = NULL;
+        }
+        logMessage( LOG_ERROR_LEVEL, "shmAttach: cannot set up [%s] [%s].", address, strerror(errno) );
+        if ( memfd != -1 ) {
+            close(memfd);
+        }
+        return( -1 );
+    }
+    node->region->magic = SG_SHM_MAGIC;
+    node->region->slots = SG_SHM_SLOTS;
+    node->region->requests.idle = 1; // Asleep until the first request
+    node->sent = node->answered = 0;
+
+    fds[0] = memfd;
+    fds[1] = node->doorbell;
+    fds[2] = node->wake;
+    if ( sgSocketSendFds(node->sock, fds, SG_SHM_FDS) == 0 &&
+         (ack = (SGSocketBuffer *) malloc(sizeof(SGSocketBuffer))) != NULL ) {
+
+        // The server acknowledges with an empty frame, or hangs up
+        ack->used = 0;
+        while ( sgSocketNextFrame(ack, &pos, &flen) == NULL ) {
+            if ( sgSocketFill(node->sock, ack, 1) ) {
+                break;
+            }
+        }
+        result = (pos > 0 && flen == 0) ? 0 : -1;
+    }
+    close(memfd);
+    free(ack);
+    if ( result ) {
+        logMessage( LOG_ERROR_LEVEL, "shmAttach: server at [%s] refused the rings.", address );
+        return( -1 );
+    }
+
+    // The first packet through the rings learns the node ID
+    result = SHM_PENDING;
+    response.data = NULL;
+    if ( serialize_sg_packetv(SG_NODE_UNKNOWN, SG_NODE_UNKNOWN, SG_BLOCK_UNKNOWN, SG_INIT_ENDPOINT,
+                              1, SG_SEQNO_UNKNOWN, NULL, &packet, &len) != SG_PACKT_OK ||
+         shmSend(node, iov, sgPacketIov(&packet, iov), NULL, &response, &rlen, &result) ) {
+        return( -1 );
+    }
+    while ( result == SHM_PENDING ) {
+        shmWait(node);
+    }
+    if ( result || deserialize_sg_packetv(&loc, &rem, &blk, &op, &sseq, &rseq,
+                                          &response, rlen) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "shmAttach: bad response from [%s].", address );
+        return( -1 );
+    }
+
+    node->nodeId = rem;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmRoute
+// Description  : Choose the server of a serialized packet
+//
+// Inputs       : packet - the packet
+//                len - the length of the packet
+// Outputs      : the server, NULL if the node is unknown
+
+ShmNode *shmRoute( char *packet, size_t len ) {
+
+    SG_Node_ID rem;
+    SG_Block_ID blk;
+    SG_System_OP op;
+
+    if ( sgSocketPacketRoute(packet, len, &rem, &blk, &op) ) {
+        return( NULL );
+    }
+    return( shmRouteTo(rem, op) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmRouteTo
+// Description  : Choose the server of a packet: the block's node for block
+//                operations, the next node for a creation and the first
+//                for the endpoint operations
+//
+// Inputs       : rem - the remote node ID of the packet
+//                op - its operation
+// Outputs      : the server, NULL if the node is unknown
+
+ShmNode *shmRouteTo( SG_Node_ID rem, SG_System_OP op ) {
+
+    if ( shmNodes == NULL ) {
+        return( NULL );
+    }
+
+    if ( op == SG_CREATE_BLOCK ) {
+        return( &shmNodes[shmNextCreate++ % shmNodeCount] );
+    }
+    if ( op == SG_INIT_ENDPOINT || op == SG_STOP_ENDPOINT ) {
+        return( &shmNodes[0] );
+    }
+    for ( int i = 0; i < shmNodeCount; i++ ) {
+        if ( shmNodes[i].nodeId == rem ) {
+            return( &shmNodes[i] );
+        }
+    }
+
+    logMessage( LOG_ERROR_LEVEL, "shmRoute: no server for node %lu.", rem );
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmSend
+// Description  : Write a packet into the next request slot, ringing the
+//                server only if it sleeps
+//
+// Inputs       : node - the server
+//                iov - the pieces of the packet to send
+//                iovcnt - the number of pieces
+//                rpacket - buffer for the response, or NULL
+//                vec - the response in pieces if rpacket is NULL
+//                rlen - the size of the buffer, set to the response length
+//                result - set when answered, NULL for a submitted packet
+// Outputs      : 0 if successful, -1 if failure
+
+int shmSend( ShmNode *node, struct iovec *iov, int iovcnt, char *rpacket, SG_Packet_Vec *vec,
+             size_t *rlen, int *result ) {
+
+    uint64_t one = 1;
+    size_t len = 0;
+
+    for ( int i = 0; i < iovcnt; i++ ) {
+        len += iov[i].iov_len;
+    }
+
+    // A full ring waits for the oldest response
+    while ( node->region != NULL && node->sent - node->answered == SG_SHM_SLOTS ) {
+        shmWait(node);
+    }
+    if ( node->region == NULL || len > SG_DATA_PACKET_SIZE ) {
+        return( -1 );
+    }
+
+    uint32_t index = node->sent & (SG_SHM_SLOTS - 1);
+    SGShmSlot *slot = &node->region->requests.slots[index];
+    ShmRequest *req = &node->pending[index];
+    for ( int i = 0, offset = 0; i < iovcnt; offset += iov[i++].iov_len ) {
+        memcpy(&slot->packet[offset], iov[i].iov_base, iov[i].iov_len);
+    }
+    slot->len = (uint32_t) len;
+    req->rpacket = rpacket;
+    req->vec = vec;
+    req->rlen = rlen;
+    req->result = result;
+
+    // Publish, then look for the idle mark (the server sets it, then looks
+    // at the tail, so one of the two sees the other)
+    __atomic_store_n(&node->region->requests.tail, ++node->sent, __ATOMIC_SEQ_CST);
+    if ( __atomic_exchange_n(&node->region->requests.idle, 0, __ATOMIC_SEQ_CST) ) {
+        if ( write(node->doorbell, &one, sizeof(one)) == -1 && errno != EAGAIN ) {
+            logMessage( LOG_ERROR_LEVEL, "shmSend: cannot wake the server [%s].", strerror(errno) );
+        }
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmReceive
+// Description  : Read the responses the server has written, handing each to
+//                its request
+//
+// Inputs       : node - the server
+// Outputs      : the number read
+
+int shmReceive( ShmNode *node ) {
+
+    SGShmRing *ring;
+    uint32_t tail;
+    int n = 0;
+
+    if ( node->region == NULL ) {
+        return( 0 );
+    }
+    ring = &node->region->responses;
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    // Never past what was sent, whatever the server wrote
+    if ( tail - node->answered > node->sent - node->answered ) {
+        tail = node->sent;
+    }
+    while ( node->answered != tail ) {
+
+        uint32_t index = node->answered & (SG_SHM_SLOTS - 1);
+        SGShmSlot *slot = &ring->slots[index];
+        ShmRequest *req = &node->pending[index];
+        uint32_t len = slot->len;
+        int result = -1;
+
+        // A response in pieces is split straight from the slot
+        if ( req->vec != NULL ) {
+            if ( len > 0 && len <= SG_DATA_PACKET_SIZE &&
+                 sgPacketScatter(req->vec, slot->packet, len) == SG_PACKT_OK ) {
+                *req->rlen = len;
+                result = 0;
+            } else {
+                *req->rlen = 0;
+            }
+        } else if ( len > 0 && len <= *req->rlen ) {
+            memcpy(req->rpacket, slot->packet, len);
+            *req->rlen = len;
+            result = 0;
+        } else {
+            *req->rlen = 0;
+        }
+
+        if ( req->result != NULL ) {
+            *req->result = result;
+        } else {
+            shmReady[(shmReadyHead + shmReadyCount++) % (SG_SOCKET_MAX_NODES * SG_SHM_SLOTS)] = req->tag;
+        }
+        node->answered++;
+        n++;
+    }
+    __atomic_store_n(&ring->head, node->answered, __ATOMIC_RELEASE);
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmWait
+// Description  : Wait for responses, polling the rings for a while before
+//                sleeping until a server wakes the driver (or goes away)
+//
+// Inputs       : only - the server to wait for, NULL for any
+// Outputs      : 0 if successful, -1 if nothing is in flight
+
+int shmWait( ShmNode *only ) {
+
+    struct pollfd fds[SG_SOCKET_MAX_NODES * 2];
+    ShmNode *polled[SG_SOCKET_MAX_NODES];
+    uint64_t value;
+    int count = 0, got = 0;
+
+    for ( int spin = 0; spin < SG_SHM_SPIN; spin++ ) {
+        for ( int i = 0; i < shmNodeCount; i++ ) {
+            if ( only == NULL || only == &shmNodes[i] ) {
+                got += shmReceive(&shmNodes[i]);
+            }
+        }
+        if ( got > 0 ) {
+            return( 0 );
+        }
+        sched_yield();
+    }
+
+    // Mark every ring waited on idle, then look once more
+    for ( int i = 0; i < shmNodeCount; i++ ) {
+        ShmNode *node = &shmNodes[i];
+        if ( (only == NULL || only == node) && node->region != NULL && node->sent != node->answered ) {
+            __atomic_store_n(&node->region->responses.idle, 1, __ATOMIC_SEQ_CST);
+            fds[count * 2].fd = node->wake;
+            fds[count * 2].events = POLLIN;
+            fds[count * 2 + 1].fd = node->sock;
+            fds[count * 2 + 1].events = POLLIN;
+            polled[count++] = node;
+        }
+    }
+    if ( count == 0 ) {
+        return( -1 );
+    }
+    for ( int i = 0; i < count; i++ ) {
+        got += shmReceive(polled[i]);
+    }
+    if ( got == 0 ) {
+        poll(fds, count * 2, -1);
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        __atomic_store_n(&polled[i]->region->responses.idle, 0, __ATOMIC_SEQ_CST);
+        if ( read(polled[i]->wake, &value, sizeof(value)) == -1 && errno != EAGAIN ) {
+            logMessage( LOG_ERROR_LEVEL, "shmWait: cannot read wakeup [%s].", strerror(errno) );
+        }
+        shmReceive(polled[i]);
+
+        // The server only writes to the socket by hanging up
+        if ( got == 0 && (fds[i * 2 + 1].revents != 0) ) {
+            logMessage( LOG_ERROR_LEVEL, "shmWait: server of node %lu went away.", polled[i]->nodeId );
+            shmFail(polled[i]);
+        }
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : shmFail
+// Description  : Drop the rings of a server gone, failing every request
+//                still waiting on it
+//
+// Inputs       : node - the server
+// Outputs      : none
+
+void shmFail( ShmNode *node ) {
+
+    while ( node->answered != node->sent ) {
+        ShmRequest *req = &node->pending[node->answered & (SG_SHM_SLOTS - 1)];
+        *req->rlen = 0;
+        if ( req->result != NULL ) {
+            *req->result = -1;
+        } else {
+            shmReady[(shmReadyHead + shmReadyCount++) % (SG_SOCKET_MAX_NODES * SG_SHM_SLOTS)] = req->tag;
+        }
+        node->answered++;
+    }
+    munmap(node->region, sizeof(SGShmRegion));
+    node->region = NULL;
+}
+
+//
+// Server functions, used by sg_blockd
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgShmAttach
+// Description  : Map the region a driver passed, checking it is one
+//
+// Inputs       : memfd - the region, closed here
+// Outputs      : the region, NULL if failure
+
+SGShmRegion *sgShmAttach( int memfd ) {
+
+    struct stat st;
+    SGShmRegion *region;
+
+    if ( fstat(memfd, &st) == -1 || st.st_size != sizeof(SGShmRegion) ) {
+        close(memfd);
+        return( NULL );
+    }
+    region = (SGShmRegion *) mmap(NULL, sizeof(SGShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    close(memfd);
+    if ( region == MAP_FAILED ) {
+        return( NULL );
+    }
+    if ( region->magic != SG_SHM_MAGIC || region->slots != SG_SHM_SLOTS ) {
+        munmap(region, sizeof(SGShmRegion));
+        return( NULL );
+    }
+
+    return( region );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgShmDetach
+// Description  : Unmap the region of a driver
+//
+// Inputs       : region - the region
+// Outputs      : none
+
+void sgShmDetach( SGShmRegion *region ) {
+
+    munmap(region, sizeof(SGShmRegion));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgShmServe
+// Description  : Answer the requests written to a region, each response
+//                built in the slot matching its request
+//
+// Inputs       : region - the region
+//                wake - signalled if the driver sleeps
+//                answer - answers a packet (as sgServicePost)
+// Outputs      : the number answered
+
+int sgShmServe( SGShmRegion *region, int wake,
+                int (*answer)( char *packet, size_t *len, char *rpacket, size_t *rlen ) ) {
+
+    uint32_t head = region->requests.head;
+    uint32_t tail = __atomic_load_n(&region->requests.tail, __ATOMIC_ACQUIRE);
+    uint64_t one = 1;
+    int n = 0;
+
+    // At most a ring's worth, the driver could write any tail
+    while ( head != tail && n < SG_SHM_SLOTS ) {
+
+        uint32_t index = head & (SG_SHM_SLOTS - 1);
+        SGShmSlot *request = &region->requests.slots[index];
+        SGShmSlot *response = &region->responses.slots[index];
+        size_t len = request->len, rlen = SG_DATA_PACKET_SIZE;
+
+        if ( len > SG_DATA_PACKET_SIZE || answer(request->packet, &len, response->packet, &rlen) ) {
+            rlen = 0;
+        }
+        response->len = (uint32_t) rlen;
+
+        head++;
+        __atomic_store_n(&region->requests.head, head, __ATOMIC_RELEASE);
+        __atomic_store_n(&region->responses.tail, head, __ATOMIC_SEQ_CST);
+        n++;
+    }
+
+    // Ring the driver only if it sleeps
+    if ( n > 0 && __atomic_exchange_n(&region->responses.idle, 0, __ATOMIC_SEQ_CST) ) {
+        if ( write(wake, &one, sizeof(one)) == -1 && errno != EAGAIN ) {
+            logMessage( LOG_ERROR_LEVEL, "sgShmServe: cannot wake the driver [%s].", strerror(errno) );
+        }
+    }
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgShmSleep
+// Description  : Mark the server idle, so the driver rings the doorbell for
+//                its next request
+//
+// Inputs       : region - the region
+// Outputs      : 1 if a request is waiting after all, 0 if the server may sleep
+
+int sgShmSleep( SGShmRegion *region ) {
+
+    __atomic_store_n(&region->requests.idle, 1, __ATOMIC_SEQ_CST);
+    if ( __atomic_load_n(&region->requests.tail, __ATOMIC_SEQ_CST) != region->requests.head ) {
+        __atomic_store_n(&region->requests.idle, 0, __ATOMIC_SEQ_CST);
+        return( 1 );
+    }
+
+    return( 0 );
+}
+
+//
+// The shared-memory transport of the driver
+const SGServiceTransport sgShmTransport = {
+    "shm", shmOpen, shmClose, shmPost, shmPostBatch,
+    shmSubmit, shmReap, shmInFlightCount, shmPostv, shmSubmitv, 0, 1, 1
+};
@@ -0,0 +1,75 @@
+#ifndef SG_SHM_INCLUDED
+#define SG_SHM_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_shm.h
+//  Description    : This is the interface to the shared-memory transport of
+//                   the ScatterGather driver, for sg_blockd servers on the
+//                   same host.  The driver maps a region holding a request
+//                   ring and a response ring, each written by one side and
+//                   read by the other without locks, and hands it to the
+//                   server over its Unix socket.  A side that finds its
+//                   ring empty polls it for a while, then marks itself idle
+//                   and sleeps on an eventfd that the other side only
+//                   signals when it sees the idle mark.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Includes
+#include <sg_service.h>
+
+//
+// Defines
+#define SG_SHM_MAGIC 0x5347524e // Marks a region ("SGRN")
+#define SG_SHM_SLOTS 64         // Packets in flight per ring (power of two)
+#define SG_SHM_SPIN 1000        // Polls of an empty ring before sleeping
+#define SG_SHM_FDS 3            // Descriptors of an attach: region, doorbell, wake
+
+//
+// Type definitions
+
+// A packet in a ring, the length is 0 for a refused packet
+typedef struct {
+    uint32_t len;
+    char packet[SG_DATA_PACKET_SIZE];
+} __attribute__((aligned(64))) SGShmSlot;
+
+// A single-producer, single-consumer ring, the indexes only grow
+typedef struct {
+    uint32_t tail __attribute__((aligned(64))); // Next slot written (producer)
+    uint32_t head __attribute__((aligned(64))); // Next slot read (consumer)
+    uint32_t idle __attribute__((aligned(64))); // The consumer sleeps, ring it
+    SGShmSlot slots[SG_SHM_SLOTS];
+} SGShmRing;
+
+// The region shared by a driver and a server, response i answers request i
+typedef struct {
+    uint32_t magic;
+    uint32_t slots;
+    SGShmRing requests;  // Driver to server
+    SGShmRing responses; // Server to driver
+} SGShmRegion;
+
+//
+// Server functions
+
+SGShmRegion *sgShmAttach( int memfd );
+    // Map a region received from a driver (the descriptor is closed), NULL
+    // if it is not one
+
+void sgShmDetach( SGShmRegion *region );
+    // Unmap a region
+
+int sgShmServe( SGShmRegion *region, int wake,
+                int (*answer)( char *packet, size_t *len, char *rpacket, size_t *rlen ) );
+    // Answer the requests in the ring in place, signalling wake if the driver
+    // sleeps, the number answered
+
+int sgShmSleep( SGShmRegion *region );
+    // Mark the server idle before it sleeps, 1 if a request slipped in (and
+    // the mark was taken back)
+
+#endif
@@ -20,6 +20,7 @@
 // Project Includes 
 #include <sg_defs.h>
 #include <sg_driver.h>
+#include <sg_compress.h>
 
 // Defines
 #define SG_ARGUMENTS "hvul:"
@@ -49,6 +50,11 @@ unsigned long SGSimulatorLevel; // Simulation log level
 int simulateScatterGather( char *wload ); // ScatterGather simulation
 int sg_unit_test( void ); // The program unit tests
 extern int packetUnitTest( void ); // External function (packet processing)
+int sgPacketvUnitTest( void ); // Test the packets in pieces (and compressed)
+int sgBatchUnitTest( void ); // Test the batched packets
+int sgRangeUnitTest( void ); // Test the partial update packets
+int sgCompressUnitTest( void ); // Test the block compressor
+void sgFillTestBlock( char *block, int seed ); // Fill a block with compressible bytes
 
 //
 // Functions
@@ -354,7 +360,8 @@ int sg_unit_test( void ) {
     logMessage( LOG_INFO_LEVEL, "ScatterGather: beginning unit tests ..." );
 
     // Do the UNIT tests
-    if ( packetUnitTest() ) {
+    if ( packetUnitTest() || sgPacketvUnitTest() || sgBatchUnitTest() ||
+         sgRangeUnitTest() || sgCompressUnitTest() ) {
         logMessage( LOG_ERROR_LEVEL, "ScatterGather: unit tests failed." );
         return( -1 );
     }
@@ -363,3 +370,423 @@ int sg_unit_test( void ) {
     logMessage( LOG_INFO_LEVEL, "ScatterGather: exiting unit tests." );
     return( 0 );
 }
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgPacketvUnitTest
+// Description  : Round trip packets in pieces through a flat buffer, plain
+//                and compressed, and check truncated or corrupt compressed
+//                packets are refused
+//
+// Inputs       : none
+// Outputs      : 0 if successful test, -1 if failure
+
+int sgPacketvUnitTest( void ) {
+
+    SG_Packet_Vec pv, out;
+    SG_Node_ID loc, rem;
+    SG_Block_ID blk;
+    SG_System_OP op;
+    SG_SeqNum sseq, rseq;
+    char block[SG_BLOCK_SIZE], back[SG_BLOCK_SIZE], packet[SG_DATA_PACKET_SIZE];
+    char body[] = { 0x1f, 'x', 0x01, 0x00, (char) 0xff, (char) 0xff, (char) 0xff, (char) 0xef };
+    uint32_t magic = SG_MAGIC_VALUE;
+    size_t plen, len;
+
+    // A plain block goes whole, header, block and trailer
+    sgFillTestBlock( block, 1 );
+    if ( serialize_sg_packetv(11, 22, 33, SG_UPDATE_BLOCK, 44, 55, block, &pv, &plen) != SG_PACKT_OK ||
+         plen != SG_DATA_PACKET_SIZE || (len = sgPacketGather(&pv, packet)) != plen ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: plain packet not gathered." );
+        return( -1 );
+    }
+    out.data = back;
+    if ( sgPacketScatter(&out, packet, len) != SG_PACKT_OK ||
+         deserialize_sg_packetv(&loc, &rem, &blk, &op, &sseq, &rseq, &out, len) != SG_PACKT_OK ||
+         loc != 11 || rem != 22 || blk != 33 || op != SG_UPDATE_BLOCK || sseq != 44 || rseq != 55 ||
+         out.trailer != SG_MAGIC_VALUE || memcmp(block, back, SG_BLOCK_SIZE) ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: plain packet did not round trip." );
+        return( -1 );
+    }
+
+    // A short plain packet, or one without a place for its block
+    if ( sgPacketScatter(&out, packet, len - 1) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: short plain packet taken." );
+        return( -1 );
+    }
+    out.data = NULL;
+    if ( sgPacketScatter(&out, packet, len) != SG_PACKT_BLKDT_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: block taken without a place for it." );
+        return( -1 );
+    }
+
+    // A packet without a block is just the header and trailer
+    if ( serialize_sg_packetv(11, 22, 33, SG_OBTAIN_BLOCK, 44, 55, NULL, &pv, &plen) != SG_PACKT_OK ||
+         plen != SG_BASE_PACKET_SIZE || (len = sgPacketGather(&pv, packet)) != plen ||
+         sgPacketScatter(&out, packet, len) != SG_PACKT_OK ||
+         deserialize_sg_packetv(&loc, &rem, &blk, &op, &sseq, &rseq, &out, len) != SG_PACKT_OK ||
+         op != SG_OBTAIN_BLOCK || out.trailer != SG_MAGIC_VALUE ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: packet without a block did not round trip." );
+        return( -1 );
+    }
+
+    // Compressed, a block that shrinks goes as SG_DATA_COMPRESSED
+    setSGPacketCompression( 1 );
+    serialize_sg_packetv(11, 22, 33, SG_UPDATE_BLOCK, 44, 55, block, &pv, &plen);
+    len = sgPacketGather(&pv, packet);
+    setSGPacketCompression( 0 );
+    if ( len >= SG_DATA_PACKET_SIZE || len > SG_BASE_PACKET_SIZE + SG_COMPRESS_LIMIT ||
+         ((SG_Packet_Header *) packet)->dataIndicator != SG_DATA_COMPRESSED ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: block not sent compressed." );
+        return( -1 );
+    }
+    memset( back, 0, SG_BLOCK_SIZE );
+    out.data = back;
+    if ( sgPacketScatter(&out, packet, len) != SG_PACKT_OK ||
+         deserialize_sg_packetv(&loc, &rem, &blk, &op, &sseq, &rseq, &out, len) != SG_PACKT_OK ||
+         blk != 33 || out.trailer != SG_MAGIC_VALUE || memcmp(block, back, SG_BLOCK_SIZE) ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: compressed packet did not round trip." );
+        return( -1 );
+    }
+
+    // Truncated compressed packets expand short or not at all
+    for ( size_t cut = 1; cut < len - SG_BASE_PACKET_SIZE; cut++ ) {
+        if ( sgPacketScatter(&out, packet, len - cut) == SG_PACKT_OK ) {
+            logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: truncated compressed packet taken (cut %lu).",
+                        (unsigned long) cut );
+            return( -1 );
+        }
+    }
+    if ( sgPacketScatter(&out, packet, SG_BASE_PACKET_SIZE) != SG_PACKT_BLKLN_BAD ||
+         sgPacketScatter(&out, packet, SG_BASE_PACKET_SIZE + SG_COMPRESS_LIMIT + 1) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: compressed length out of range taken." );
+        return( -1 );
+    }
+
+    // One literal then a match repeating it to the end of the block, taken
+    // only while the match reaches back into the block
+    memcpy( &packet[sizeof(SG_Packet_Header)], body, sizeof(body) );
+    memcpy( &packet[sizeof(SG_Packet_Header) + sizeof(body)], &magic, sizeof(uint32_t) );
+    len = SG_BASE_PACKET_SIZE + sizeof(body);
+    memset( block, 'x', SG_BLOCK_SIZE );
+    if ( sgPacketScatter(&out, packet, len) != SG_PACKT_OK || memcmp(block, back, SG_BLOCK_SIZE) ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: hand built compressed packet refused." );
+        return( -1 );
+    }
+    packet[sizeof(SG_Packet_Header) + 2] = (char) 0xff;
+    packet[sizeof(SG_Packet_Header) + 3] = 0x7f;
+    if ( sgPacketScatter(&out, packet, len) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgPacketvUnitTest: corrupt compressed packet taken." );
+        return( -1 );
+    }
+
+    // Return successfully
+    logMessage( LOG_INFO_LEVEL, "sgPacketvUnitTest: packets in pieces tested." );
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgBatchUnitTest
+// Description  : Round trip batched packets, and check counts and lengths
+//                that do not agree are refused
+//
+// Inputs       : none
+// Outputs      : 0 if successful test, -1 if failure
+
+int sgBatchUnitTest( void ) {
+
+    static char packet[SG_BATCH_PACKET_SIZE];
+    char blocks[3][SG_BLOCK_SIZE], backs[3][SG_BLOCK_SIZE];
+    char *data[3] = { blocks[0], blocks[1], blocks[2] };
+    char *backData[3] = { backs[0], backs[1], backs[2] };
+    SG_Block_ID blks[SG_BATCH_MAX_BLOCKS + 1], backBlks[SG_BATCH_MAX_BLOCKS];
+    SG_Node_ID loc, rem;
+    SG_System_OP op;
+    SG_SeqNum sseq, rseq;
+    SG_Packet_Header *header = (SG_Packet_Header *) packet;
+    size_t plen;
+    int count, i;
+
+    for ( i = 0; i <= SG_BATCH_MAX_BLOCKS; i++ ) {
+        blks[i] = 100 + i;
+    }
+    for ( i = 0; i < 3; i++ ) {
+        sgFillTestBlock( blocks[i], i + 2 );
+    }
+
+    // Three blocks, the IDs then the blocks
+    if ( serialize_sg_batch(11, 22, SG_UPDATE_BATCH, 44, 55, 3, blks, data, packet, &plen) != SG_PACKT_OK ||
+         plen != SG_BASE_PACKET_SIZE + 3 * (sizeof(SG_Block_ID) + SG_BLOCK_SIZE) ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: batch not serialized." );
+        return( -1 );
+    }
+    count = 3;
+    if ( deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count, backBlks, backData,
+                              packet, plen) != SG_PACKT_OK ||
+         loc != 11 || rem != 22 || op != SG_UPDATE_BATCH || sseq != 44 || rseq != 55 || count != 3 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: batch not deserialized." );
+        return( -1 );
+    }
+    for ( i = 0; i < 3; i++ ) {
+        if ( backBlks[i] != blks[i] || memcmp(blocks[i], backs[i], SG_BLOCK_SIZE) ) {
+            logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: block %d did not round trip.", i );
+            return( -1 );
+        }
+    }
+
+    // The length must match the count exactly
+    count = 3;
+    if ( deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count, backBlks, backData,
+                              packet, plen - 1) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: short batch taken." );
+        return( -1 );
+    }
+    count = 3;
+    if ( deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count, backBlks, backData,
+                              packet, plen - SG_BLOCK_SIZE) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: batch missing a block taken." );
+        return( -1 );
+    }
+
+    // More blocks than there is room for, or none
+    count = 2;
+    if ( deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count, backBlks, backData,
+                              packet, plen) != SG_PACKT_BLKLN_BAD || count != 0 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: batch larger than the room taken." );
+        return( -1 );
+    }
+    header->blockID = 0;
+    count = 3;
+    if ( deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count, backBlks, backData,
+                              packet, plen) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: empty batch taken." );
+        return( -1 );
+    }
+    header->blockID = SG_BATCH_MAX_BLOCKS + 1;
+    count = SG_BATCH_MAX_BLOCKS;
+    if ( deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count, backBlks, backData,
+                              packet, plen) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: oversized batch count taken." );
+        return( -1 );
+    }
+
+    // Nor can one be sent
+    if ( serialize_sg_batch(11, 22, SG_OBTAIN_BATCH, 44, 55, 0, blks, NULL, packet, &plen) != SG_PACKT_BLKLN_BAD ||
+         serialize_sg_batch(11, 22, SG_OBTAIN_BATCH, 44, 55, SG_BATCH_MAX_BLOCKS + 1, blks, NULL,
+                            packet, &plen) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: bad batch count serialized." );
+        return( -1 );
+    }
+
+    // A full batch without blocks is just the IDs
+    count = SG_BATCH_MAX_BLOCKS;
+    if ( serialize_sg_batch(11, 22, SG_OBTAIN_BATCH, 44, 55, SG_BATCH_MAX_BLOCKS, blks, NULL,
+                            packet, &plen) != SG_PACKT_OK ||
+         plen != SG_BASE_PACKET_SIZE + SG_BATCH_MAX_BLOCKS * sizeof(SG_Block_ID) ||
+         deserialize_sg_batch(&loc, &rem, &op, &sseq, &rseq, &count, backBlks, NULL,
+                              packet, plen) != SG_PACKT_OK ||
+         count != SG_BATCH_MAX_BLOCKS || op != SG_OBTAIN_BATCH ||
+         memcmp(blks, backBlks, SG_BATCH_MAX_BLOCKS * sizeof(SG_Block_ID)) ) {
+        logMessage( LOG_ERROR_LEVEL, "sgBatchUnitTest: batch without blocks did not round trip." );
+        return( -1 );
+    }
+
+    // Return successfully
+    logMessage( LOG_INFO_LEVEL, "sgBatchUnitTest: batched packets tested." );
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgRangeUnitTest
+// Description  : Round trip partial updates, and check ranges past the block
+//                or lengths that do not agree are refused
+//
+// Inputs       : none
+// Outputs      : 0 if successful test, -1 if failure
+
+int sgRangeUnitTest( void ) {
+
+    char bytes[SG_BLOCK_SIZE], block[SG_BLOCK_SIZE], packet[SG_DATA_PACKET_SIZE];
+    SG_Node_ID loc, rem;
+    SG_Block_ID blk;
+    SG_SeqNum sseq, rseq;
+    uint16_t start, len, bad;
+    size_t plen;
+    int i;
+
+    // The bytes land at their place in the block, the rest is left alone
+    sgFillTestBlock( bytes, 5 );
+    memset( block, 0, SG_BLOCK_SIZE );
+    if ( serialize_sg_range(11, 22, 33, 44, 55, 100, 200, bytes, packet, &plen) != SG_PACKT_OK ||
+         plen != SG_BASE_PACKET_SIZE + 2 * sizeof(uint16_t) + 200 ||
+         deserialize_sg_range(&loc, &rem, &blk, &sseq, &rseq, &start, &len, block,
+                              packet, plen) != SG_PACKT_OK ||
+         loc != 11 || rem != 22 || blk != 33 || sseq != 44 || rseq != 55 ||
+         start != 100 || len != 200 || memcmp(&block[100], bytes, 200) ) {
+        logMessage( LOG_ERROR_LEVEL, "sgRangeUnitTest: range did not round trip." );
+        return( -1 );
+    }
+    for ( i = 0; i < SG_BLOCK_SIZE; i++ ) {
+        if ( (i < 100 || i >= 300) && block[i] != 0 ) {
+            logMessage( LOG_ERROR_LEVEL, "sgRangeUnitTest: byte %d outside the range changed.", i );
+            return( -1 );
+        }
+    }
+
+    // The length must match the range exactly
+    if ( deserialize_sg_range(&loc, &rem, &blk, &sseq, &rseq, &start, &len, block,
+                              packet, plen - 1) != SG_PACKT_BLKLN_BAD ||
+         deserialize_sg_range(&loc, &rem, &blk, &sseq, &rseq, &start, &len, block,
+                              packet, plen + 1) != SG_PACKT_BLKLN_BAD ||
+         deserialize_sg_range(&loc, &rem, &blk, &sseq, &rseq, &start, &len, block,
+                              packet, SG_BASE_PACKET_SIZE) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgRangeUnitTest: range of the wrong length taken." );
+        return( -1 );
+    }
+
+    // A range running past the block
+    bad = SG_BLOCK_SIZE - 100;
+    memcpy( &packet[sizeof(SG_Packet_Header)], &bad, sizeof(uint16_t) );
+    if ( deserialize_sg_range(&loc, &rem, &blk, &sseq, &rseq, &start, &len, block,
+                              packet, plen) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgRangeUnitTest: range past the block taken." );
+        return( -1 );
+    }
+    if ( serialize_sg_range(11, 22, 33, 44, 55, SG_BLOCK_SIZE - 100, 200, bytes,
+                            packet, &plen) != SG_PACKT_BLKLN_BAD ||
+         serialize_sg_range(11, 22, 33, 44, 55, 0, SG_RANGE_MAX_LENGTH + 1, bytes,
+                            packet, &plen) != SG_PACKT_BLKLN_BAD ) {
+        logMessage( LOG_ERROR_LEVEL, "sgRangeUnitTest: range past the block serialized." );
+        return( -1 );
+    }
+
+    // The answer carries no bytes
+    if ( serialize_sg_range(11, 22, 33, 44, 55, 0, 0, NULL, packet, &plen) != SG_PACKT_OK ||
+         plen != SG_BASE_PACKET_SIZE + 2 * sizeof(uint16_t) ||
+         deserialize_sg_range(&loc, &rem, &blk, &sseq, &rseq, &start, &len, NULL,
+                              packet, plen) != SG_PACKT_OK || len != 0 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgRangeUnitTest: empty range did not round trip." );
+        return( -1 );
+    }
+
+    // Return successfully
+    logMessage( LOG_INFO_LEVEL, "sgRangeUnitTest: partial update packets tested." );
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgCompressUnitTest
+// Description  : Round trip blocks through the compressor, and check the
+//                decoder stays in bounds on truncated or corrupt input
+//
+// Inputs       : none
+// Outputs      : 0 if successful test, -1 if failure
+
+int sgCompressUnitTest( void ) {
+
+    char block[SG_BLOCK_SIZE], back[SG_BLOCK_SIZE + 16], packed[SG_BLOCK_SIZE];
+    char bad[8];
+    int len, cut, i, got;
+
+    // Compressible blocks round trip, the output exactly the block
+    for ( i = 0; i < 4; i++ ) {
+        if ( i == 0 ) {
+            memset( block, 0, SG_BLOCK_SIZE );
+        } else {
+            sgFillTestBlock( block, i );
+        }
+        if ( (len = sgCompress(block, SG_BLOCK_SIZE, packed, SG_COMPRESS_LIMIT)) <= 0 ||
+             sgDecompress(packed, len, back, SG_BLOCK_SIZE) != SG_BLOCK_SIZE ||
+             memcmp(block, back, SG_BLOCK_SIZE) ) {
+            logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: block %d did not round trip.", i );
+            return( -1 );
+        }
+    }
+
+    // A block that does not shrink is left alone
+    srand( 311 );
+    for ( i = 0; i < SG_BLOCK_SIZE; i++ ) {
+        block[i] = (char) (rand() & 0xff);
+    }
+    if ( sgCompress(block, SG_BLOCK_SIZE, packed, SG_COMPRESS_LIMIT) != 0 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: random block compressed." );
+        return( -1 );
+    }
+
+    // Truncated input never expands to the whole block, nor past the room
+    sgFillTestBlock( block, 7 );
+    len = sgCompress( block, SG_BLOCK_SIZE, packed, SG_COMPRESS_LIMIT );
+    for ( cut = 1; cut < len; cut++ ) {
+        got = sgDecompress( packed, len - cut, back, SG_BLOCK_SIZE );
+        if ( got == SG_BLOCK_SIZE || got > SG_BLOCK_SIZE ) {
+            logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: truncated input expanded (cut %d).", cut );
+            return( -1 );
+        }
+    }
+
+    // Nor into less room than the block needs
+    if ( sgDecompress(packed, len, back, SG_BLOCK_SIZE - 1) != -1 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: block expanded past the room." );
+        return( -1 );
+    }
+
+    // A match at offset 0, or before the output, is corrupt
+    bad[0] = 0x10; bad[1] = 'x'; bad[2] = 0; bad[3] = 0; bad[4] = 0;
+    if ( sgDecompress(bad, 5, back, SG_BLOCK_SIZE) != -1 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: zero match offset taken." );
+        return( -1 );
+    }
+    bad[2] = 2;
+    if ( sgDecompress(bad, 5, back, SG_BLOCK_SIZE) != -1 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: match before the output taken." );
+        return( -1 );
+    }
+
+    // Literals running past the input, or a length that never ends
+    bad[0] = (char) 0x50; bad[1] = 'a'; bad[2] = 'b';
+    if ( sgDecompress(bad, 3, back, SG_BLOCK_SIZE) != -1 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: literals past the input taken." );
+        return( -1 );
+    }
+    bad[0] = (char) 0xf0; bad[1] = (char) 255; bad[2] = (char) 255;
+    if ( sgDecompress(bad, 3, back, SG_BLOCK_SIZE) != -1 ) {
+        logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: unterminated length taken." );
+        return( -1 );
+    }
+
+    // Garbage never writes past the room
+    for ( i = 0; i < 1000; i++ ) {
+        for ( cut = 0; cut < SG_COMPRESS_LIMIT; cut++ ) {
+            packed[cut] = (char) (rand() & 0xff);
+        }
+        memset( &back[SG_BLOCK_SIZE], 0x5a, 16 );
+        got = sgDecompress( packed, 1 + rand() % SG_COMPRESS_LIMIT, back, SG_BLOCK_SIZE );
+        if ( got > SG_BLOCK_SIZE || back[SG_BLOCK_SIZE] != 0x5a ) {
+            logMessage( LOG_ERROR_LEVEL, "sgCompressUnitTest: corrupt input expanded past the room." );
+            return( -1 );
+        }
+    }
+
+    // Return successfully
+    logMessage( LOG_INFO_LEVEL, "sgCompressUnitTest: block compressor tested." );
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgFillTestBlock
+// Description  : Fill a block with text-like bytes that compress well
+//
+// Inputs       : block - the block (SG_BLOCK_SIZE)
+//                seed - varies the bytes
+// Outputs      : none
+
+void sgFillTestBlock( char *block, int seed ) {
+
+    for ( int i = 0; i < SG_BLOCK_SIZE; i++ ) {
+        block[i] = "scatter gather block "[(i + seed) % 21] + (char) ((i / 64) % 3);
+    }
+}
@@ -0,0 +1,1217 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_socket.c
+//  Description    : This is the socket transport of the driver, talking to
+//                   sg_blockd servers over TCP or Unix domain sockets, and
+//                   the framing both sides use.  Each server is a node; the
+//                   transport keeps a pool of connections to it and sends
+//                   the packets of a block down the same one, so a block's
+//                   requests are answered in order while requests for
+//                   other blocks are pipelined alongside.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include <sg_socket.h>
+#include <sg_driver.h>
+
+//
+// Defines
+#define SG_SOCKET_REM_OFFSET (sizeof(uint32_t) + sizeof(SG_Node_ID)) // Remote ID in a packet
+#define SG_SOCKET_BLK_OFFSET (SG_SOCKET_REM_OFFSET + sizeof(SG_Node_ID)) // Block ID
+#define SG_SOCKET_OP_OFFSET (SG_SOCKET_BLK_OFFSET + sizeof(SG_Block_ID)) // Operation
+
+//
+// Type definitions
+
+// A packet sent, waiting for its response
+typedef struct socket_request {
+    SG_SeqNum tag;  // Returned by reap (submitted packets)
+    char *rpacket;  // Buffer for the response
+    SG_Packet_Vec *vec; // Or the response in pieces, the block to vec->data
+    size_t *rlen;   // The size of the buffer, set to the response length
+    int async;      // Submitted, reaped by tag
+    int done;       // Answered (posted packets)
+    int result;     // 0 if answered, -1 if failed
+    struct socket_request *pNext;
+} SocketRequest;
+
+// A connection to a server
+typedef struct {
+    int fd;
+    SGSocketBuffer in;     // Responses received, not yet matched
+    SocketRequest *head;   // Requests sent, oldest first
+    SocketRequest *tail;
+    int pending;           // Requests sent, not yet answered
+} SocketConn;
+
+// A server, one remote node
+typedef struct {
+    SG_Node_ID nodeId;
+    SocketConn conns[SG_SOCKET_MAX_CONNECTIONS];
+} SocketNode;
+
+//
+// Global data
+
+SocketNode *socketNodes = NULL;  // The servers
+int socketNodeCount = 0;         // Number of servers
+int socketConnCount = 1;         // Connections to each server
+uint64_t socketNextCreate = 0;   // Creations sent, spread over the servers
+
+SocketRequest *socketReady = NULL; // Submitted and answered, oldest first
+SocketRequest *socketReadyTail = NULL;
+SocketRequest *socketFree = NULL;  // Recycled requests
+int socketInFlight = 0;            // Submitted, not yet reaped
+
+//
+// Functional Prototypes
+
+int socketOpen( void ); // Connect to the servers
+int socketClose( void ); // Disconnect
+int socketPost( char *packet, size_t *len, char *rpacket, size_t *rlen ); // Post and wait
+int socketPostBatch( SGServiceRequest *requests, int count ); // Pipeline and wait
+int socketSubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ); // Pipeline
+int socketReap( SG_SeqNum *tags, int max, int wait ); // Collect answered tags
+int socketInFlightCount( void ); // Tags not yet reaped
+int socketPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ); // Post in pieces and wait
+int socketSubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ); // Pipeline in pieces
+int socketHello( SocketNode *node ); // Learn a server's node ID
+SocketConn *socketRoute( char *packet, size_t len ); // Connection for a packet
+SocketConn *socketRouteTo( SG_Node_ID rem, SG_Block_ID blk, SG_System_OP op ); // Connection for a block
+SocketRequest *socketSend( SocketConn *conn, struct iovec *iov, int iovcnt,
+                           char *rpacket, SG_Packet_Vec *vec, size_t *rlen ); // Send
+int socketReceive( SocketConn *conn, int wait ); // Match responses to requests
+void socketFail( SocketConn *conn ); // Fail everything sent on a connection
+void socketRelease( SocketRequest *req ); // Recycle a request
+int socketAddress( const char *address, struct sockaddr_storage *sa, socklen_t *salen ); // Resolve
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketOpen
+// Description  : Connect to the servers listed in SG_SERVICE_ADDRESS, with
+//                SG_SERVICE_CONNECTIONS connections to each
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int socketOpen( void ) {
+
+    char *list = getenv(SG_SERVICE_ADDRESS_ENV);
+    char *connections = getenv(SG_SERVICE_CONNECTIONS_ENV);
+    char *copy, *address, *save;
+
+    if ( list == NULL || (copy = strdup(list)) == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "socketOpen: no server address (%s).", SG_SERVICE_ADDRESS_ENV );
+        return( -1 );
+    }
+    socketConnCount = (connections != NULL) ? atoi(connections) : 1;
+    if ( socketConnCount < 1 || socketConnCount > SG_SOCKET_MAX_CONNECTIONS ) {
+        socketConnCount = 1;
+    }
+    if ( (socketNodes = (SocketNode *) calloc(SG_SOCKET_MAX_NODES, sizeof(SocketNode))) == NULL ) {
+        free(copy);
+        return( -1 );
+    }
+    socketNodeCount = 0;
+    socketNextCreate = 0;
+
+    for ( address = strtok_r(copy, ",", &save); address != NULL; address = strtok_r(NULL, ",", &save) ) {
+
+        if ( socketNodeCount == SG_SOCKET_MAX_NODES ) {
+            logMessage( LOG_ERROR_LEVEL, "socketOpen: more than %d servers.", SG_SOCKET_MAX_NODES );
+            break;
+        }
+
+        SocketNode *node = &socketNodes[socketNodeCount++];
+        for ( int i = 0; i < SG_SOCKET_MAX_CONNECTIONS; i++ ) {
+            node->conns[i].fd = -1;
+        }
+        for ( int i = 0; i < socketConnCount; i++ ) {
+            if ( (node->conns[i].fd = sgSocketConnect(address)) == -1 ) {
+                logMessage( LOG_ERROR_LEVEL, "socketOpen: cannot connect to [%s].", address );
+                free(copy);
+                socketClose();
+                return( -1 );
+            }
+        }
+        if ( socketHello(node) ) {
+            free(copy);
+            socketClose();
+            return( -1 );
+        }
+        for ( int i = 0; i < socketNodeCount - 1; i++ ) {
+            if ( socketNodes[i].nodeId == node->nodeId ) {
+                logMessage( LOG_ERROR_LEVEL, "socketOpen: node %lu at [%s] is already connected.",
+                                                node->nodeId, address );
+                free(copy);
+                socketClose();
+                return( -1 );
+            }
+        }
+        logMessage( SGServiceLevel, "Connected to node %lu at [%s], %d connections.",
+                                        node->nodeId, address, socketConnCount );
+    }
+    free(copy);
+
+    if ( socketNodeCount == 0 ) {
+        socketClose();
+        return( -1 );
+    }
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketClose
+// Description  : Close every connection, anything in flight is dropped
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int socketClose( void ) {
+
+    SocketRequest *req;
+
+    for ( int i = 0; socketNodes != NULL && i < socketNodeCount; i++ ) {
+        for ( int j = 0; j < SG_SOCKET_MAX_CONNECTIONS; j++ ) {
+            SocketConn *conn = &socketNodes[i].conns[j];
+            while ( (req = conn->head) != NULL ) {
+                conn->head = req->pNext;
+                free(req);
+            }
+            if ( conn->fd != -1 ) {
+                close(conn->fd);
+            }
+        }
+    }
+    free(socketNodes);
+    socketNodes = NULL;
+    socketNodeCount = 0;
+
+    while ( (req = socketReady) != NULL ) {
+        socketReady = req->pNext;
+        free(req);
+    }
+    while ( (req = socketFree) != NULL ) {
+        socketFree = req->pNext;
+        free(req);
+    }
+    socketReadyTail = NULL;
+    socketInFlight = 0;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketPost
+// Description  : Send a packet and wait for its response (answering the
+//                requests pipelined before it on the way)
+//
+// Inputs       : packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response
+//                rlen - the size of the buffer, set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int socketPost( char *packet, size_t *len, char *rpacket, size_t *rlen ) {
+
+    SocketConn *conn = socketRoute(packet, *len);
+    SocketRequest *req;
+
+    struct iovec iov = { packet, *len };
+    if ( conn == NULL || (req = socketSend(conn, &iov, 1, rpacket, NULL, rlen)) == NULL ) {
+        return( -1 );
+    }
+    while ( !req->done ) {
+        socketReceive(conn, 1);
+    }
+
+    int result = req->result;
+    socketRelease(req);
+    return( result );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketPostBatch
+// Description  : Send every packet before waiting for any response, so the
+//                round trips overlap
+//
+// Inputs       : requests - the packets
+//                count - the number of packets
+// Outputs      : the number answered
+
+int socketPostBatch( SGServiceRequest *requests, int count ) {
+
+    SocketRequest **sent = (SocketRequest **) calloc(count > 0 ? count : 1, sizeof(SocketRequest *));
+    SocketConn **conns = (SocketConn **) calloc(count > 0 ? count : 1, sizeof(SocketConn *));
+    int answered = 0;
+
+    if ( sent == NULL || conns == NULL ) {
+        free(sent);
+        free(conns);
+        return( 0 );
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        requests[i].result = -1;
+        struct iovec iov = { requests[i].packet, requests[i].len };
+        if ( (conns[i] = socketRoute(requests[i].packet, requests[i].len)) != NULL ) {
+            sent[i] = socketSend(conns[i], &iov, 1, requests[i].rpacket, NULL, &requests[i].rlen);
+        }
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        if ( sent[i] == NULL ) {
+            continue;
+        }
+        while ( !sent[i]->done ) {
+            socketReceive(conns[i], 1);
+        }
+        if ( (requests[i].result = sent[i]->result) == 0 ) {
+            answered++;
+        }
+        socketRelease(sent[i]);
+    }
+
+    free(sent);
+    free(conns);
+    return( answered );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketSubmit
+// Description  : Send a packet without waiting, the tag is reaped once the
+//                response has arrived
+//
+// Inputs       : packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response (kept until reaped)
+//                rlen - the size of the buffer, set to the response length
+//                tag - returned by socketReap
+// Outputs      : 0 if successful, -1 if failure
+
+int socketSubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ) {
+
+    SocketConn *conn = socketRoute(packet, len);
+    SocketRequest *req;
+
+    struct iovec iov = { packet, len };
+    if ( conn == NULL || (req = socketSend(conn, &iov, 1, rpacket, NULL, rlen)) == NULL ) {
+        return( -1 );
+    }
+    req->async = 1;
+    req->tag = tag;
+    socketInFlight++;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketPostv
+// Description  : Post a packet in pieces and wait for its response, the
+//                block goes from the caller's buffer straight to the socket
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int socketPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ) {
+
+    struct iovec iov[SG_PACKET_IOV];
+    int iovcnt = sgPacketIov(packet, iov);
+    SocketConn *conn = socketRouteTo(packet->header.remNodeId, packet->header.blockID,
+                                     packet->header.operation);
+    SocketRequest *req;
+
+    if ( conn == NULL || (req = socketSend(conn, iov, iovcnt, NULL, response, rlen)) == NULL ) {
+        return( -1 );
+    }
+    while ( !req->done ) {
+        socketReceive(conn, 1);
+    }
+
+    int result = req->result;
+    socketRelease(req);
+    return( result );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketSubmitv
+// Description  : Send a packet in pieces without waiting, the tag is reaped
+//                once the response has been split into response
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                           (kept until reaped)
+//                rlen - set to the response length
+//                tag - returned by socketReap
+// Outputs      : 0 if successful, -1 if failure
+
+int socketSubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ) {
+
+    struct iovec iov[SG_PACKET_IOV];
+    int iovcnt = sgPacketIov(packet, iov);
+    SocketConn *conn = socketRouteTo(packet->header.remNodeId, packet->header.blockID,
+                                     packet->header.operation);
+    SocketRequest *req;
+
+    if ( conn == NULL || (req = socketSend(conn, iov, iovcnt, NULL, response, rlen)) == NULL ) {
+        return( -1 );
+    }
+    req->async = 1;
+    req->tag = tag;
+    socketInFlight++;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketReap
+// Description  : Collect the tags of submitted packets that were answered
+//
+// Inputs       : tags - place to put the tags
+//                max - the size of tags
+//                wait - if set and nothing is answered, wait for a response
+// Outputs      : number of tags collected
+
+int socketReap( SG_SeqNum *tags, int max, int wait ) {
+
+    struct pollfd fds[SG_SOCKET_MAX_NODES * SG_SOCKET_MAX_CONNECTIONS];
+    SocketConn *polled[SG_SOCKET_MAX_NODES * SG_SOCKET_MAX_CONNECTIONS];
+    int n = 0, count;
+
+    do {
+        // Take whatever has arrived on the busy connections
+        count = 0;
+        for ( int i = 0; i < socketNodeCount; i++ ) {
+            for ( int j = 0; j < socketConnCount; j++ ) {
+                SocketConn *conn = &socketNodes[i].conns[j];
+                if ( conn->pending > 0 ) {
+                    socketReceive(conn, 0);
+                }
+                if ( conn->pending > 0 ) {
+                    fds[count].fd = conn->fd;
+                    fds[count].events = POLLIN;
+                    polled[count++] = conn;
+                }
+            }
+        }
+
+        // Nothing answered yet, sleep until a connection has data
+        if ( socketReady == NULL && wait && count > 0 ) {
+            if ( poll(fds, count, -1) > 0 ) {
+                for ( int i = 0; i < count; i++ ) {
+                    if ( fds[i].revents != 0 ) {
+                        socketReceive(polled[i], 0);
+                    }
+                }
+            }
+        }
+    } while ( socketReady == NULL && wait && count > 0 );
+
+    while ( n < max && socketReady != NULL ) {
+        SocketRequest *req = socketReady;
+        socketReady = req->pNext;
+        if ( socketReady == NULL ) {
+            socketReadyTail = NULL;
+        }
+        tags[n++] = req->tag;
+        socketRelease(req);
+        socketInFlight--;
+    }
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketInFlightCount
+// Description  : Count the submissions not yet reaped
+//
+// Inputs       : none
+// Outputs      : the number of submissions
+
+int socketInFlightCount( void ) {
+
+    return( socketInFlight );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketHello
+// Description  : Ask a server for its node ID, with an SG_INIT_ENDPOINT
+//                packet of the transport's own
+//
+// Inputs       : node - the server, connected
+// Outputs      : 0 if successful, -1 if failure
+
+int socketHello( SocketNode *node ) {
+
+    SG_Packet_Vec packet, response;
+    struct iovec iov[SG_PACKET_IOV];
+    size_t len, rlen;
+    SG_Node_ID loc, rem;
+    SG_Block_ID blk;
+    SG_System_OP op;
+    SG_SeqNum sseq, rseq;
+    SocketRequest *req;
+
+    response.data = NULL;
+    if ( serialize_sg_packetv(SG_NODE_UNKNOWN, SG_NODE_UNKNOWN, SG_BLOCK_UNKNOWN, SG_INIT_ENDPOINT,
+                              1, SG_SEQNO_UNKNOWN, NULL, &packet, &len) != SG_PACKT_OK ||
+         (req = socketSend(&node->conns[0], iov, sgPacketIov(&packet, iov), NULL, &response, &rlen)) == NULL ) {
+        return( -1 );
+    }
+    while ( !req->done ) {
+        socketReceive(&node->conns[0], 1);
+    }
+    int result = req->result;
+    socketRelease(req);
+
+    if ( result || deserialize_sg_packetv(&loc, &rem, &blk, &op, &sseq, &rseq,
+                                          &response, rlen) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "socketHello: bad response from server." );
+        return( -1 );
+    }
+
+    node->nodeId = rem;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketRoute
+// Description  : Choose the connection of a serialized packet
+//
+// Inputs       : packet - the packet
+//                len - the length of the packet
+// Outputs      : the connection, NULL if the node is unknown
+
+SocketConn *socketRoute( char *packet, size_t len ) {
+
+    SG_Node_ID rem;
+    SG_Block_ID blk;
+    SG_System_OP op;
+
+    if ( sgSocketPacketRoute(packet, len, &rem, &blk, &op) ) {
+        return( NULL );
+    }
+    return( socketRouteTo(rem, blk, op) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketRouteTo
+// Description  : Choose the connection of a packet: the block's node for
+//                block operations, the next node for a creation and the
+//                first for the endpoint operations
+//
+// Inputs       : rem - the remote node ID of the packet
+//                blk - its block ID
+//                op - its operation
+// Outputs      : the connection, NULL if the node is unknown
+
+SocketConn *socketRouteTo( SG_Node_ID rem, SG_Block_ID blk, SG_System_OP op ) {
+
+    SocketNode *node = NULL;
+
+    if ( socketNodes == NULL ) {
+        return( NULL );
+    }
+
+    if ( op == SG_CREATE_BLOCK || op == SG_CREATE_BATCH ) {
+        node = &socketNodes[socketNextCreate % socketNodeCount];
+        blk = socketNextCreate++ / socketNodeCount;
+    } else if ( op == SG_INIT_ENDPOINT || op == SG_STOP_ENDPOINT ) {
+        node = &socketNodes[0];
+        blk = 0;
+    } else {
+        for ( int i = 0; i < socketNodeCount && node == NULL; i++ ) {
+            if ( socketNodes[i].nodeId == rem ) {
+                node = &socketNodes[i];
+            }
+        }
+    }
+
+    if ( node == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "socketRoute: no server for node %lu.", rem );
+        return( NULL );
+    }
+    return( &node->conns[blk % socketConnCount] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketSend
+// Description  : Send a packet on a connection, first taking responses when
+//                the window is full so neither side blocks on the other
+//
+// Inputs       : conn - the connection
+//                iov - the pieces of the packet to send
+//                iovcnt - the number of pieces
+//                rpacket - buffer for the response, or NULL
+//                vec - the response in pieces if rpacket is NULL
+//                rlen - the size of the buffer, set to the response length
+// Outputs      : the request sent, NULL if failure
+
+SocketRequest *socketSend( SocketConn *conn, struct iovec *iov, int iovcnt,
+                           char *rpacket, SG_Packet_Vec *vec, size_t *rlen ) {
+
+    SocketRequest *req = socketFree;
+
+    while ( conn->pending >= SG_SOCKET_WINDOW && conn->fd != -1 ) {
+        socketReceive(conn, 1);
+    }
+    if ( conn->fd == -1 ) {
+        return( NULL );
+    }
+
+    if ( req != NULL ) {
+        socketFree = req->pNext;
+    } else if ( (req = (SocketRequest *) malloc(sizeof(SocketRequest))) == NULL ) {
+        logMessage( LOG_ERROR_LEVEL, "socketSend: out of memory." );
+        return( NULL );
+    }
+    memset(req, 0, sizeof(SocketRequest));
+    req->rpacket = rpacket;
+    req->vec = vec;
+    req->rlen = rlen;
+    req->result = -1;
+
+    if ( sgSocketWriteFramev(conn->fd, iov, iovcnt) ) {
+        logMessage( LOG_ERROR_LEVEL, "socketSend: write failed, closing connection." );
+        socketRelease(req);
+        socketFail(conn);
+        return( NULL );
+    }
+
+    if ( conn->tail != NULL ) {
+        conn->tail->pNext = req;
+    } else {
+        conn->head = req;
+    }
+    conn->tail = req;
+    conn->pending++;
+
+    return( req );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketReceive
+// Description  : Read the responses that have arrived on a connection and
+//                hand each to the oldest request waiting on it
+//
+// Inputs       : conn - the connection
+//                wait - block until something arrives
+// Outputs      : 0 if successful, -1 if the connection failed
+
+int socketReceive( SocketConn *conn, int wait ) {
+
+    size_t pos = 0, len;
+    char *frame;
+
+    if ( conn->fd == -1 ) {
+        return( -1 );
+    }
+    if ( sgSocketFill(conn->fd, &conn->in, wait) == -1 ) {
+        logMessage( LOG_ERROR_LEVEL, "socketReceive: connection closed by the server." );
+        socketFail(conn);
+        return( -1 );
+    }
+
+    while ( conn->head != NULL && (frame = sgSocketNextFrame(&conn->in, &pos, &len)) != NULL ) {
+
+        SocketRequest *req = conn->head;
+        conn->head = req->pNext;
+        if ( conn->head == NULL ) {
+            conn->tail = NULL;
+        }
+        conn->pending--;
+
+        // An empty frame is a refused packet, one in pieces is split
+        // straight into the caller's buffers
+        if ( req->vec != NULL ) {
+            if ( len > 0 && len <= SG_DATA_PACKET_SIZE &&
+                 sgPacketScatter(req->vec, frame, len) == SG_PACKT_OK ) {
+                *req->rlen = len;
+                req->result = 0;
+            } else {
+                *req->rlen = 0;
+            }
+        } else if ( len > 0 && len <= *req->rlen ) {
+            memcpy(req->rpacket, frame, len);
+            *req->rlen = len;
+            req->result = 0;
+        } else {
+            *req->rlen = 0;
+        }
+
+        if ( req->async ) {
+            req->pNext = NULL;
+            if ( socketReadyTail != NULL ) {
+                socketReadyTail->pNext = req;
+            } else {
+                socketReady = req;
+            }
+            socketReadyTail = req;
+        } else {
+            req->done = 1;
+        }
+    }
+    sgSocketCompact(&conn->in, pos);
+
+    // A frame larger than the buffer can never complete
+    if ( conn->in.used == sizeof(conn->in.data) ) {
+        logMessage( LOG_ERROR_LEVEL, "socketReceive: oversized frame from the server." );
+        socketFail(conn);
+        return( -1 );
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketFail
+// Description  : Close a broken connection, failing every request on it
+//
+// Inputs       : conn - the connection
+// Outputs      : none
+
+void socketFail( SocketConn *conn ) {
+
+    SocketRequest *req;
+
+    close(conn->fd);
+    conn->fd = -1;
+    while ( (req = conn->head) != NULL ) {
+        conn->head = req->pNext;
+        req->result = -1;
+        *req->rlen = 0;
+        if ( req->async ) {
+            req->pNext = NULL;
+            if ( socketReadyTail != NULL ) {
+                socketReadyTail->pNext = req;
+            } else {
+                socketReady = req;
+            }
+            socketReadyTail = req;
+        } else {
+            req->done = 1;
+        }
+    }
+    conn->tail = NULL;
+    conn->pending = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketRelease
+// Description  : Put a finished request back for reuse
+//
+// Inputs       : req - the request
+// Outputs      : none
+
+void socketRelease( SocketRequest *req ) {
+
+    req->pNext = socketFree;
+    socketFree = req;
+}
+
+//
+// Sockets and framing, shared with sg_blockd
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketPacketRoute
+// Description  : Read the fields that route a serialized packet, without
+//                deserializing it
+//
+// Inputs       : packet - the packet
+//                len - the length of the packet
+//                rem - set to the remote node ID
+//                blk - set to the block ID
+//                op - set to the operation
+// Outputs      : 0 if successful, -1 if the packet is too short
+
+int sgSocketPacketRoute( char *packet, size_t len, SG_Node_ID *rem, SG_Block_ID *blk, SG_System_OP *op ) {
+
+    if ( len < SG_BASE_PACKET_SIZE ) {
+        return( -1 );
+    }
+    memcpy(rem, &packet[SG_SOCKET_REM_OFFSET], sizeof(SG_Node_ID));
+    memcpy(blk, &packet[SG_SOCKET_BLK_OFFSET], sizeof(SG_Block_ID));
+    memcpy(op, &packet[SG_SOCKET_OP_OFFSET], sizeof(SG_System_OP));
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : socketAddress
+// Description  : Resolve "unix:<path>" or "<host>:<port>"
+//
+// Inputs       : address - the address
+//                sa - the socket address to fill in
+//                salen - set to its length
+// Outputs      : 0 if successful, -1 if failure
+
+int socketAddress( const char *address, struct sockaddr_storage *sa, socklen_t *salen ) {
+
+    memset(sa, 0, sizeof(struct sockaddr_storage));
+
+    if ( strncmp(address, "unix:", 5) == 0 ) {
+        struct sockaddr_un *un = (struct sockaddr_un *) sa;
+        if ( strlen(address + 5) >= sizeof(un->sun_path) ) {
+            return( -1 );
+        }
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, address + 5);
+        *salen = sizeof(struct sockaddr_un);
+        return( 0 );
+    }
+
+    // The port follows the last colon
+    char host[256];
+    const char *colon = strrchr(address, ':');
+    struct addrinfo hints, *res;
+    if ( colon == NULL || colon - address >= (long) sizeof(host) ) {
+        return( -1 );
+    }
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if ( getaddrinfo(host[0] != '\0' ? host : NULL, colon + 1, &hints, &res) != 0 ) {
+        return( -1 );
+    }
+    memcpy(sa, res->ai_addr, res->ai_addrlen);
+    *salen = res->ai_addrlen;
+    freeaddrinfo(res);
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketConnect
+// Description  : Connect to a server, small frames are sent at once
+//
+// Inputs       : address - "unix:<path>" or "<host>:<port>"
+// Outputs      : the descriptor, -1 if failure
+
+int sgSocketConnect( const char *address ) {
+
+    struct sockaddr_storage sa;
+    socklen_t salen;
+    int fd, one = 1;
+
+    if ( socketAddress(address, &sa, &salen) ||
+         (fd = socket(sa.ss_family, SOCK_STREAM, 0)) == -1 ) {
+        return( -1 );
+    }
+    if ( connect(fd, (struct sockaddr *) &sa, salen) == -1 ) {
+        close(fd);
+        return( -1 );
+    }
+    if ( sa.ss_family != AF_UNIX ) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    return( fd );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketListen
+// Description  : Listen for connections, replacing a stale Unix socket
+//
+// Inputs       : address - "unix:<path>" or "<host>:<port>"
+// Outputs      : the descriptor, -1 if failure
+
+int sgSocketListen( const char *address ) {
+
+    struct sockaddr_storage sa;
+    socklen_t salen;
+    int fd, one = 1;
+
+    if ( socketAddress(address, &sa, &salen) ||
+         (fd = socket(sa.ss_family, SOCK_STREAM, 0)) == -1 ) {
+        return( -1 );
+    }
+    if ( sa.ss_family == AF_UNIX ) {
+        unlink(((struct sockaddr_un *) &sa)->sun_path);
+    } else {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if ( bind(fd, (struct sockaddr *) &sa, salen) == -1 || listen(fd, 64) == -1 ) {
+        close(fd);
+        return( -1 );
+    }
+
+    return( fd );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketAccept
+// Description  : Accept a connection, small frames are sent at once
+//
+// Inputs       : fd - the listening socket
+// Outputs      : the descriptor, -1 if failure
+
+int sgSocketAccept( int fd ) {
+
+    struct sockaddr_storage sa;
+    socklen_t salen = sizeof(sa);
+    int conn, one = 1;
+
+    if ( (conn = accept(fd, (struct sockaddr *) &sa, &salen)) == -1 ) {
+        return( -1 );
+    }
+    if ( sa.ss_family != AF_UNIX ) {
+        setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    return( conn );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketFill
+// Description  : Read the bytes that have arrived into a buffer
+//
+// Inputs       : fd - the socket
+//                buf - the buffer
+//                wait - block until something arrives
+// Outputs      : 0 if successful (even if nothing arrived), -1 if closed
+
+int sgSocketFill( int fd, SGSocketBuffer *buf, int wait ) {
+
+    return( sgSocketFillFds(fd, buf, wait, NULL, NULL) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketFillFds
+// Description  : Read the bytes that have arrived into a buffer, with the
+//                descriptors passed along with them (Unix sockets)
+//
+// Inputs       : fd - the socket
+//                buf - the buffer
+//                wait - block until something arrives
+//                fds - place for the descriptors, NULL to close them
+//                nfds - the size of fds, set to the number received
+// Outputs      : 0 if successful (even if nothing arrived), -1 if closed
+
+int sgSocketFillFds( int fd, SGSocketBuffer *buf, int wait, int *fds, int *nfds ) {
+
+    char control[CMSG_SPACE(sizeof(int) * SG_SOCKET_MAX_FDS)];
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t got;
+    int max = (nfds != NULL) ? *nfds : 0;
+
+    if ( nfds != NULL ) {
+        *nfds = 0;
+    }
+    if ( buf->used == sizeof(buf->data) ) {
+        return( 0 );
+    }
+
+    iov.iov_base = &buf->data[buf->used];
+    iov.iov_len = sizeof(buf->data) - buf->used;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    do {
+        got = recvmsg(fd, &msg, wait ? 0 : MSG_DONTWAIT);
+    } while ( got == -1 && errno == EINTR );
+
+    if ( got == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+        return( 0 );
+    }
+    if ( got <= 0 ) {
+        return( -1 );
+    }
+
+    // Keep the descriptors asked for, close the rest
+    for ( cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg) ) {
+        if ( cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ) {
+            continue;
+        }
+        int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for ( int i = 0; i < count; i++ ) {
+            int passed;
+            memcpy(&passed, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if ( nfds != NULL && *nfds < max ) {
+                fds[(*nfds)++] = passed;
+            } else {
+                close(passed);
+            }
+        }
+    }
+
+    buf->used += got;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketSendFds
+// Description  : Send an empty frame carrying descriptors (Unix sockets)
+//
+// Inputs       : fd - the socket
+//                fds - the descriptors
+//                nfds - the number of descriptors
+// Outputs      : 0 if successful, -1 if failure
+
+int sgSocketSendFds( int fd, int *fds, int nfds ) {
+
+    char control[CMSG_SPACE(sizeof(int) * SG_SOCKET_MAX_FDS)];
+    uint32_t size = 0;
+    struct iovec iov = { &size, sizeof(uint32_t) };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t n;
+
+    if ( nfds < 1 || nfds > SG_SOCKET_MAX_FDS ) {
+        return( -1 );
+    }
+    memset(control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+
+    // The frame is 4 bytes, it goes out whole or not at all
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while ( n == -1 && errno == EINTR );
+
+    return( (n == sizeof(uint32_t)) ? 0 : -1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketNextFrame
+// Description  : Find the next whole frame in a buffer
+//
+// Inputs       : buf - the buffer
+//                pos - the offset to start at, advanced past the frame
+//                len - set to the length of the packet in the frame
+// Outputs      : the packet, NULL if no whole frame is buffered
+
+char *sgSocketNextFrame( SGSocketBuffer *buf, size_t *pos, size_t *len ) {
+
+    uint32_t size;
+
+    if ( buf->used - *pos < sizeof(uint32_t) ) {
+        return( NULL );
+    }
+    memcpy(&size, &buf->data[*pos], sizeof(uint32_t));
+    size = ntohl(size);
+    if ( buf->used - *pos - sizeof(uint32_t) < size ) {
+        return( NULL );
+    }
+
+    char *packet = &buf->data[*pos + sizeof(uint32_t)];
+    *len = size;
+    *pos += sizeof(uint32_t) + size;
+    return( packet );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketCompact
+// Description  : Drop the frames that have been handled from a buffer
+//
+// Inputs       : buf - the buffer
+//                pos - the offset of the first byte to keep
+// Outputs      : none
+
+void sgSocketCompact( SGSocketBuffer *buf, size_t pos ) {
+
+    if ( pos > 0 ) {
+        memmove(buf->data, &buf->data[pos], buf->used - pos);
+        buf->used -= pos;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketAppendFrame
+// Description  : Add a frame to a buffer of frames to send
+//
+// Inputs       : buf - the buffer
+//                packet - the packet (NULL with len 0 for an empty frame)
+//                len - the length of the packet
+// Outputs      : 0 if successful, -1 if it does not fit
+
+int sgSocketAppendFrame( SGSocketBuffer *buf, char *packet, size_t len ) {
+
+    uint32_t size = htonl((uint32_t) len);
+
+    if ( sizeof(buf->data) - buf->used < sizeof(uint32_t) + len ) {
+        return( -1 );
+    }
+    memcpy(&buf->data[buf->used], &size, sizeof(uint32_t));
+    if ( len > 0 ) {
+        memcpy(&buf->data[buf->used + sizeof(uint32_t)], packet, len);
+    }
+    buf->used += sizeof(uint32_t) + len;
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketFlush
+// Description  : Send the frames in a buffer and empty it
+//
+// Inputs       : fd - the socket
+//                buf - the buffer
+// Outputs      : 0 if successful, -1 if failure
+
+int sgSocketFlush( int fd, SGSocketBuffer *buf ) {
+
+    size_t sent = 0;
+
+    while ( sent < buf->used ) {
+        ssize_t n = send(fd, &buf->data[sent], buf->used - sent, MSG_NOSIGNAL);
+        if ( n == -1 && errno == EINTR ) {
+            continue;
+        }
+        if ( n <= 0 ) {
+            return( -1 );
+        }
+        sent += n;
+    }
+
+    buf->used = 0;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketWriteFrame
+// Description  : Send one frame, the length and the packet in one call
+//
+// Inputs       : fd - the socket
+//                packet - the packet
+//                len - the length of the packet
+// Outputs      : 0 if successful, -1 if failure
+
+int sgSocketWriteFrame( int fd, char *packet, size_t len ) {
+
+    struct iovec iov = { packet, len };
+    return( sgSocketWriteFramev(fd, &iov, 1) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgSocketWriteFramev
+// Description  : Send one frame of a packet in pieces, the length and the
+//                pieces gathered by the kernel in one call
+//
+// Inputs       : fd - the socket
+//                packet - the pieces of the packet
+//                count - the number of pieces (at most SG_SOCKET_MAX_IOV)
+// Outputs      : 0 if successful, -1 if failure
+
+int sgSocketWriteFramev( int fd, struct iovec *packet, int count ) {
+
+    struct iovec iov[SG_SOCKET_MAX_IOV + 1];
+    struct msghdr msg;
+    uint32_t size;
+    size_t left = 0;
+
+    if ( count > SG_SOCKET_MAX_IOV ) {
+        return( -1 );
+    }
+    for ( int i = 0; i < count; i++ ) {
+        iov[i + 1] = packet[i];
+        left += packet[i].iov_len;
+    }
+    size = htonl((uint32_t) left);
+    iov[0].iov_base = &size;
+    iov[0].iov_len = sizeof(uint32_t);
+    left += sizeof(uint32_t);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count + 1;
+
+    while ( left > 0 ) {
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if ( n == -1 && errno == EINTR ) {
+            continue;
+        }
+        if ( n <= 0 ) {
+            return( -1 );
+        }
+
+        // Skip what went out, a partial send leaves part of an iovec
+        left -= n;
+        while ( n > 0 && msg.msg_iovlen > 0 ) {
+            if ( (size_t) n >= msg.msg_iov->iov_len ) {
+                n -= msg.msg_iov->iov_len;
+                msg.msg_iov++;
+                msg.msg_iovlen--;
+            } else {
+                msg.msg_iov->iov_base = (char *) msg.msg_iov->iov_base + n;
+                msg.msg_iov->iov_len -= n;
+                n = 0;
+            }
+        }
+    }
+
+    return( 0 );
+}
+
+//
+// The socket transport of the driver
+const SGServiceTransport sgSocketTransport = {
+    "socket", socketOpen, socketClose, socketPost, socketPostBatch,
+    socketSubmit, socketReap, socketInFlightCount, socketPostv, socketSubmitv,
+    SG_BATCH_MAX_BLOCKS, 1, 1
+};
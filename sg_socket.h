@@ -0,0 +1,83 @@
+#ifndef SG_SOCKET_INCLUDED
+#define SG_SOCKET_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_socket.h
+//  Description    : This is the interface to the socket transport of the
+//                   ScatterGather driver and its block server (sg_blockd).
+//                   Packets travel as frames, a 32-bit length in network
+//                   order followed by the packet from serialize_sg_packet;
+//                   an empty frame answers a packet the server refused.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Includes
+#include <sys/uio.h>
+#include <sg_service.h>
+
+//
+// Defines
+#define SG_SERVICE_ADDRESS_ENV "SG_SERVICE_ADDRESS" // Environment servers, comma separated
+#define SG_SERVICE_CONNECTIONS_ENV "SG_SERVICE_CONNECTIONS" // Environment connections per node
+#define SG_SOCKET_MAX_NODES 64       // Most servers of the transport
+#define SG_SOCKET_MAX_CONNECTIONS 16 // Most connections to a server
+#define SG_SOCKET_WINDOW 32          // Most requests in flight on a connection
+#define SG_SOCKET_BUFFER 65536       // Bytes of frames buffered per connection
+#define SG_SOCKET_MAX_FDS 4          // Most descriptors passed with a frame
+#define SG_SOCKET_MAX_IOV 4          // Most pieces of a packet sent as a frame
+
+//
+// Type definitions
+
+// Frames received, or to send, on a connection
+typedef struct {
+    char data[SG_SOCKET_BUFFER];
+    size_t used;
+} SGSocketBuffer;
+
+//
+// Socket functions
+
+int sgSocketPacketRoute( char *packet, size_t len, SG_Node_ID *rem, SG_Block_ID *blk, SG_System_OP *op );
+    // Read the node, block and operation of a serialized packet, -1 if short
+
+int sgSocketConnect( const char *address );
+    // Connect to "unix:<path>" or "<host>:<port>", the descriptor or -1
+
+int sgSocketListen( const char *address );
+    // Listen on "unix:<path>" or "<host>:<port>", the descriptor or -1
+
+int sgSocketAccept( int fd );
+    // Accept a connection on a listening socket, the descriptor or -1
+
+int sgSocketFill( int fd, SGSocketBuffer *buf, int wait );
+    // Read what has arrived (wait for something if set), -1 if closed
+
+int sgSocketFillFds( int fd, SGSocketBuffer *buf, int wait, int *fds, int *nfds );
+    // As sgSocketFill, keeping up to *nfds descriptors passed (set to the count)
+
+int sgSocketSendFds( int fd, int *fds, int nfds );
+    // Send an empty frame carrying descriptors over a Unix socket, -1 if failure
+
+char *sgSocketNextFrame( SGSocketBuffer *buf, size_t *pos, size_t *len );
+    // The next whole frame at or after pos (advanced past it), NULL if none
+
+void sgSocketCompact( SGSocketBuffer *buf, size_t pos );
+    // Drop the frames before pos
+
+int sgSocketAppendFrame( SGSocketBuffer *buf, char *packet, size_t len );
+    // Add a frame to send, -1 if it does not fit
+
+int sgSocketFlush( int fd, SGSocketBuffer *buf );
+    // Send the frames added, -1 if failure
+
+int sgSocketWriteFrame( int fd, char *packet, size_t len );
+    // Send one frame, -1 if failure
+
+int sgSocketWriteFramev( int fd, struct iovec *packet, int count );
+    // Send one frame of a packet in pieces, -1 if failure
+
+#endif
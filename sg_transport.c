@@ -0,0 +1,307 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : sg_transport.c
+//  Description    : This is the transport of the driver to the ScatterGather
+//                   library, and the lookup of the transports by name.  The
+//                   library answers every post before returning, so a
+//                   submitted packet is posted at once and only its tag
+//                   waits to be reaped.  Transports of flat packets post
+//                   packets in pieces by flattening them here.
+//
+//   Author        : Hanfei He
+//   Last Modified : 10/17/2026
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include <sg_service.h>
+#include <sg_driver.h>
+
+//
+// Global data
+
+SG_SeqNum *libraryAnswered = NULL; // Tags of answered submissions (ring)
+int libraryAnsweredSize = 0;       // Size of the ring (power of two)
+int libraryAnsweredHead = 0;       // Oldest tag
+int libraryInFlight = 0;           // Tags not yet reaped
+
+//
+// Functional Prototypes
+
+int libraryOpen( void ); // Start the library transport
+int libraryClose( void ); // Stop the library transport
+int libraryPostBatch( SGServiceRequest *requests, int count ); // Post in turn
+int librarySubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ); // Post now
+int libraryReap( SG_SeqNum *tags, int max, int wait ); // Hand out answered tags
+int libraryInFlightCount( void ); // Tags not yet reaped
+int libraryPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ); // Post flattened
+int librarySubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ); // Post now, flattened
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : getSGServiceTransport
+// Description  : Find a transport by name
+//
+// Inputs       : name - "library", "local", "socket" or "shm", NULL for the
+//                       library
+// Outputs      : the transport, NULL if unknown
+
+const SGServiceTransport *getSGServiceTransport( const char *name ) {
+
+    if ( name == NULL || strcmp(name, sgLibraryTransport.name) == 0 ) {
+        return( &sgLibraryTransport );
+    }
+    if ( strcmp(name, sgLocalTransport.name) == 0 ) {
+        return( &sgLocalTransport );
+    }
+    if ( strcmp(name, sgSocketTransport.name) == 0 ) {
+        return( &sgSocketTransport );
+    }
+    if ( strcmp(name, sgShmTransport.name) == 0 ) {
+        return( &sgShmTransport );
+    }
+
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgFlatPostv
+// Description  : Post a packet in pieces through a transport of flat
+//                packets, flattening it and splitting the response
+//
+// Inputs       : post - the flat post of the transport
+//                packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int sgFlatPostv( int (*post)( char *packet, size_t *len, char *rpacket, size_t *rlen ),
+                 SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ) {
+
+    char flat[SG_DATA_PACKET_SIZE], rflat[SG_DATA_PACKET_SIZE];
+    size_t len = sgPacketGather(packet, flat);
+
+    *rlen = SG_DATA_PACKET_SIZE;
+    if ( post(flat, &len, rflat, rlen) ) {
+        return( -1 );
+    }
+    if ( sgPacketScatter(response, rflat, *rlen) != SG_PACKT_OK ) {
+        logMessage( LOG_ERROR_LEVEL, "sgFlatPostv: bad response packet [%lu]", *rlen );
+        return( -1 );
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sgFlatSubmitv
+// Description  : Submit a packet in pieces through a transport of flat
+//                packets, which answers before returning so the response
+//                is split at once
+//
+// Inputs       : submit - the flat submit of the transport
+//                packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+//                tag - returned by the reap of the transport
+// Outputs      : 0 if successful, -1 if failure
+
+int sgFlatSubmitv( int (*submit)( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ),
+                   SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ) {
+
+    char flat[SG_DATA_PACKET_SIZE], rflat[SG_DATA_PACKET_SIZE];
+    size_t len = sgPacketGather(packet, flat);
+
+    *rlen = SG_DATA_PACKET_SIZE;
+    if ( submit(flat, len, rflat, rlen, tag) ) {
+        return( -1 );
+    }
+    if ( sgPacketScatter(response, rflat, *rlen) != SG_PACKT_OK ) {
+        // The tag is already queued, leave the driver a response it rejects
+        logMessage( LOG_ERROR_LEVEL, "sgFlatSubmitv: bad response packet [%lu]", *rlen );
+        *rlen = 0;
+    }
+
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : libraryOpen
+// Description  : Start the library transport, the library needs no setup
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int libraryOpen( void ) {
+
+    libraryAnsweredHead = 0;
+    libraryInFlight = 0;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : libraryClose
+// Description  : Stop the library transport, unreaped tags are dropped
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int libraryClose( void ) {
+
+    free(libraryAnswered);
+    libraryAnswered = NULL;
+    libraryAnsweredSize = 0;
+    libraryAnsweredHead = 0;
+    libraryInFlight = 0;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : libraryPostBatch
+// Description  : Post packets to the library one after the other
+//
+// Inputs       : requests - the packets
+//                count - the number of packets
+// Outputs      : the number answered
+
+int libraryPostBatch( SGServiceRequest *requests, int count ) {
+
+    int answered = 0;
+
+    for ( int i = 0; i < count; i++ ) {
+        SGServiceRequest *req = &requests[i];
+        req->result = sgServicePost(req->packet, &req->len, req->rpacket, &req->rlen);
+        if ( req->result == 0 ) {
+            answered++;
+        }
+    }
+
+    return( answered );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : librarySubmit
+// Description  : Post a packet to the library, the tag is ready to reap
+//
+// Inputs       : packet - the packet to send
+//                len - the length of the packet
+//                rpacket - buffer for the response
+//                rlen - the size of the buffer, set to the response length
+//                tag - returned by libraryReap
+// Outputs      : 0 if successful, -1 if failure
+
+int librarySubmit( char *packet, size_t len, char *rpacket, size_t *rlen, SG_SeqNum tag ) {
+
+    // Double the ring when it is full, unwrapping the tags
+    if ( libraryInFlight == libraryAnsweredSize ) {
+        int size = (libraryAnsweredSize > 0) ? libraryAnsweredSize * 2 : 64;
+        SG_SeqNum *ring = (SG_SeqNum *) malloc(sizeof(SG_SeqNum) * size);
+        if ( ring == NULL ) {
+            logMessage( LOG_ERROR_LEVEL, "librarySubmit: out of memory." );
+            return( -1 );
+        }
+        for ( int i = 0; i < libraryInFlight; i++ ) {
+            ring[i] = libraryAnswered[(libraryAnsweredHead + i) & (libraryAnsweredSize - 1)];
+        }
+        free(libraryAnswered);
+        libraryAnswered = ring;
+        libraryAnsweredSize = size;
+        libraryAnsweredHead = 0;
+    }
+
+    if ( sgServicePost(packet, &len, rpacket, rlen) ) {
+        return( -1 );
+    }
+
+    libraryAnswered[(libraryAnsweredHead + libraryInFlight) & (libraryAnsweredSize - 1)] = tag;
+    libraryInFlight++;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : libraryReap
+// Description  : Hand out the tags of submitted packets, all answered
+//
+// Inputs       : tags - place to put the tags
+//                max - the size of tags
+//                wait - unused, nothing is ever outstanding
+// Outputs      : number of tags collected
+
+int libraryReap( SG_SeqNum *tags, int max, int wait ) {
+
+    int n = 0;
+
+    while ( n < max && libraryInFlight > 0 ) {
+        tags[n++] = libraryAnswered[libraryAnsweredHead];
+        libraryAnsweredHead = (libraryAnsweredHead + 1) & (libraryAnsweredSize - 1);
+        libraryInFlight--;
+    }
+
+    return( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : libraryInFlightCount
+// Description  : Count the submissions not yet reaped
+//
+// Inputs       : none
+// Outputs      : the number of submissions
+
+int libraryInFlightCount( void ) {
+
+    return( libraryInFlight );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : libraryPostv
+// Description  : Post a packet in pieces to the library
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+// Outputs      : 0 if successful, -1 if failure
+
+int libraryPostv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen ) {
+
+    return( sgFlatPostv(sgServicePost, packet, response, rlen) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : librarySubmitv
+// Description  : Post a packet in pieces to the library, the tag is ready
+//                to reap
+//
+// Inputs       : packet - the packet to send
+//                response - the response, data set to where a block goes
+//                rlen - set to the response length
+//                tag - returned by libraryReap
+// Outputs      : 0 if successful, -1 if failure
+
+int librarySubmitv( SG_Packet_Vec *packet, SG_Packet_Vec *response, size_t *rlen, SG_SeqNum tag ) {
+
+    return( sgFlatSubmitv(librarySubmit, packet, response, rlen, tag) );
+}
+
+//
+// The library as a transport of the driver
+const SGServiceTransport sgLibraryTransport = {
+    "library", libraryOpen, libraryClose, sgServicePost, libraryPostBatch,
+    librarySubmit, libraryReap, libraryInFlightCount, libraryPostv, librarySubmitv, 0, 0, 0
+};